@@ -34,7 +34,8 @@
 // Previously squircle class from QT Squircle example
 
 #include "QTRenderGL.hpp"
-//#include "VideoFilter.h"
+
+#include "graphics/GLStateCache.h"
 
 #include <QtQuick/qquickwindow.h>
 #include <QtGui/QOpenGLShaderProgram>
@@ -78,6 +79,35 @@ void main()
     gl_FragColor = vec4(coords * .5 + .5, i, i);
 });
 
+// (((((( UNDERLAY ))))))
+const char *vshaderUnderlaySrc = STRINGIFY(
+
+#if GATHERER_OPENGL_ES
+precision mediump float;
+#endif
+
+attribute vec4 vertices;
+attribute vec2 texcoords;
+varying vec2 coords;
+void main()
+{
+    gl_Position = vertices;
+    coords = texcoords;
+});
+
+const char *fshaderUnderlaySrc = STRINGIFY(
+
+#if GATHERER_OPENGL_ES
+precision mediump float;
+#endif
+
+uniform sampler2D frame;
+varying vec2 coords;
+void main()
+{
+    gl_FragColor = texture2D(frame, coords);
+});
+
 QTRenderGL::QTRenderGL()
     : m_t(0)
     , m_renderer(0)
@@ -95,10 +125,31 @@ void QTRenderGL::setT(qreal t)
         window()->update();
 }
 
+void QTRenderGL::setSource(VideoFilter *source)
+{
+    if (source == m_source)
+        return;
+    m_source = source;
+    emit sourceChanged();
+    if (window())
+        window()->update();
+}
+
+void QTRenderGL::setOrientation(int orientation)
+{
+    if (orientation == m_orientation)
+        return;
+    m_orientation = orientation;
+    emit orientationChanged();
+    if (window())
+        window()->update();
+}
+
 void QTRenderGL::handleWindowChanged(QQuickWindow *win)
 {
     if (win) {
-        connect(win, SIGNAL(beforeSynchronizing()), this, SLOT(sync()), Qt::DirectConnection);
+        // After synchronizing, so the VideoOutput filters have run for this frame
+        connect(win, SIGNAL(afterSynchronizing()), this, SLOT(sync()), Qt::DirectConnection);
         connect(win, SIGNAL(sceneGraphInvalidated()), this, SLOT(cleanup()), Qt::DirectConnection);
         // If we allow QML to do the clearing, they would clear what we paint
         // and nothing would show.
@@ -116,7 +167,9 @@ void QTRenderGL::cleanup()
 
 QTRenderGLRenderer::~QTRenderGLRenderer()
 {
+    m_vertices.destroy();
     delete m_program;
+    delete m_underlayProgram;
 }
 
 void QTRenderGL::sync()
@@ -127,10 +180,22 @@ void QTRenderGL::sync()
     }
     m_renderer->setViewportSize(window()->size() * window()->devicePixelRatio());
     m_renderer->setT(m_t);
+    m_renderer->setOrientation(m_orientation);
+
+    // The GUI thread is blocked here and the filter has presented this frame:
+    // snapshot the filter state for the render thread
+    const bool underlay = m_source && m_source->isActive() && m_source->underlay();
+    m_renderer->setUnderlay(underlay ? m_source->presentedTexture() : 0, underlay ? m_source->presentedSize() : QSize());
 }
 
 void QTRenderGLRenderer::paint()
 {
+    // Filter output replaces the demo squircle; QML items are composited on top
+    if (m_underlayTexture) {
+        paintUnderlay(m_underlayTexture, m_frameSize);
+        return;
+    }
+
     if (!m_program) {
         initializeOpenGLFunctions();
 
@@ -139,20 +204,26 @@ void QTRenderGLRenderer::paint()
         m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, fshaderSrc);
         m_program->bindAttributeLocation("vertices", 0);
         m_program->link();
+        m_tLocation = m_program->uniformLocation("t");
 
+        static const float values[] = {
+            -1, -1,
+            1, -1,
+            -1, 1,
+            1, 1
+        };
+        m_vertices.create();
+        m_vertices.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        m_vertices.bind();
+        m_vertices.allocate(values, sizeof(values));
+        m_vertices.release();
     }
     m_program->bind();
 
+    m_vertices.bind();
     m_program->enableAttributeArray(0);
-
-    float values[] = {
-        -1, -1,
-        1, -1,
-        -1, 1,
-        1, 1
-    };
-    m_program->setAttributeArray(0, GL_FLOAT, values, 2);
-    m_program->setUniformValue("t", (float) m_t);
+    m_program->setAttributeBuffer(0, GL_FLOAT, 0, 2);
+    m_program->setUniformValue(m_tLocation, (float) m_t);
 
     glViewport(0, 0, m_viewportSize.width(), m_viewportSize.height());
 
@@ -167,6 +238,74 @@ void QTRenderGLRenderer::paint()
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
     m_program->disableAttributeArray(0);
+    m_vertices.release();
     m_program->release();
+
+    // Tell the gatherer draw paths that their cached GL state is stale
+    gatherer::graphics::GLStateCache::get().invalidate();
 }
 
+void QTRenderGLRenderer::paintUnderlay(GLuint texture, const QSize &frameSize)
+{
+    if (m_viewportSize.isEmpty() || frameSize.isEmpty())
+        return; // the fit below would divide by zero
+
+    if (!m_underlayProgram) {
+        initializeOpenGLFunctions();
+
+        m_underlayProgram = new QOpenGLShaderProgram();
+        m_underlayProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, vshaderUnderlaySrc);
+        m_underlayProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, fshaderUnderlaySrc);
+        m_underlayProgram->bindAttributeLocation("vertices", 0);
+        m_underlayProgram->bindAttributeLocation("texcoords", 1);
+        m_underlayProgram->link();
+    }
+
+    // Fit the rotated frame to the viewport (VideoOutput's PreserveAspectFit)
+    const int turns = ((m_orientation / 90) % 4 + 4) % 4;
+    const QSizeF rotated = (turns % 2) ? QSizeF(frameSize.height(), frameSize.width()) : QSizeF(frameSize);
+    const qreal scale = qMin(m_viewportSize.width() / rotated.width(), m_viewportSize.height() / rotated.height());
+    const float ex = float(rotated.width() * scale / m_viewportSize.width());
+    const float ey = float(rotated.height() * scale / m_viewportSize.height());
+
+    // Corners counter clockwise from bottom left; texture row 0 is the top of the frame.
+    // A counter clockwise turn shows frame corner j - 1 at screen corner j.
+    static const float corners[4][2] = { { 0, 1 }, { 1, 1 }, { 1, 0 }, { 0, 0 } };
+    static const int strip[4] = { 0, 1, 3, 2 }; // BL, BR, TL, TR
+    GLfloat vertices[8], texcoords[8];
+    for (int i = 0; i < 4; i++) {
+        const int j = strip[i];
+        vertices[i * 2 + 0] = (j == 0 || j == 3) ? -ex : ex;
+        vertices[i * 2 + 1] = (j < 2) ? -ey : ey;
+        texcoords[i * 2 + 0] = corners[(j - turns + 4) % 4][0];
+        texcoords[i * 2 + 1] = corners[(j - turns + 4) % 4][1];
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0); // client side arrays
+    m_underlayProgram->bind();
+    m_underlayProgram->enableAttributeArray(0);
+    m_underlayProgram->enableAttributeArray(1);
+    m_underlayProgram->setAttributeArray(0, GL_FLOAT, vertices, 2);
+    m_underlayProgram->setAttributeArray(1, GL_FLOAT, texcoords, 2);
+    m_underlayProgram->setUniformValue("frame", 0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glViewport(0, 0, m_viewportSize.width(), m_viewportSize.height());
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    // Letterbox bars; the scene graph doesn't clear (setClearBeforeRendering(false))
+    glClearColor(0, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    m_underlayProgram->disableAttributeArray(0);
+    m_underlayProgram->disableAttributeArray(1);
+    m_underlayProgram->release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    gatherer::graphics::GLStateCache::get().invalidate();
+}
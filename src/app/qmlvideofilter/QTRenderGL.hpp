@@ -41,30 +41,50 @@
 #include <QtQuick/QQuickItem>
 #include <QtGui/QOpenGLShaderProgram>
 #include <QtGui/QOpenGLFunctions>
+#include <QtGui/QOpenGLBuffer>
+#include <QtCore/QPointer>
+
+#include "VideoFilter.hpp" // complete type for the source property
 
 class QTRenderGLRenderer : public QObject, protected QOpenGLFunctions
 {
     Q_OBJECT
 public:
-    QTRenderGLRenderer() : m_t(0), m_program(0) { }
+    QTRenderGLRenderer() : m_t(0), m_program(0), m_vertices(QOpenGLBuffer::VertexBuffer), m_tLocation(-1) { }
     ~QTRenderGLRenderer();
 
     void setT(qreal t) { m_t = t; }
     void setViewportSize(const QSize &size) { m_viewportSize = size; }
+    void setOrientation(int orientation) { m_orientation = orientation; }
+
+    // Frame to draw instead of the squircle (0 for none), copied from the
+    // source filter in sync() so paint() never touches the filter
+    void setUnderlay(GLuint texture, const QSize &frameSize) { m_underlayTexture = texture; m_frameSize = frameSize; }
 
 public slots:
     void paint();
 
 private:
+    void paintUnderlay(GLuint texture, const QSize &frameSize);
+
     QSize m_viewportSize;
     qreal m_t;
     QOpenGLShaderProgram *m_program;
+    QOpenGLBuffer m_vertices; // static full screen quad
+    int m_tLocation;
+
+    GLuint m_underlayTexture = 0;
+    QSize m_frameSize;
+    int m_orientation = 0;
+    QOpenGLShaderProgram *m_underlayProgram = nullptr;
 };
 
 class QTRenderGL : public QQuickItem
 {
     Q_OBJECT
     Q_PROPERTY(qreal t READ t WRITE setT NOTIFY tChanged)
+    Q_PROPERTY(VideoFilter *source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(int orientation READ orientation WRITE setOrientation NOTIFY orientationChanged)
 
 public:
     QTRenderGL();
@@ -72,8 +92,19 @@ public:
     qreal t() const { return m_t; }
     void setT(qreal t);
 
+    // While the source filter is active in underlay mode its output is drawn
+    // here, fit to the window and rotated by orientation (degrees, counter
+    // clockwise, a multiple of 90 as VideoOutput.orientation)
+    VideoFilter *source() const { return m_source; }
+    void setSource(VideoFilter *source);
+
+    int orientation() const { return m_orientation; }
+    void setOrientation(int orientation);
+
 signals:
     void tChanged();
+    void sourceChanged();
+    void orientationChanged();
 
 public slots:
     void sync();
@@ -85,6 +116,9 @@ private slots:
 private:
     qreal m_t;
     QTRenderGLRenderer *m_renderer;
+
+    QPointer<VideoFilter> m_source;
+    int m_orientation = 0;
 };
 
 #endif // QTRENDERGL_H
@@ -0,0 +1,69 @@
+#include "TextureBuffer.hpp"
+
+#include <graphics/GLStateCache.h>
+
+#include <QOpenGLContext>
+
+void TextureBufferSlot::release() {
+  // Buffers are released on the render thread, after the scene graph
+  // queued its draws; without a context nothing of ours can be pending
+  if (QOpenGLContext::currentContext()) {
+    released.signal();
+  }
+  in_use = false;
+}
+
+std::shared_ptr<TextureBufferSlot> TextureBufferRing::acquire(const QSize& size) {
+  // Prefer a free slot whose last reader has finished, then any free slot
+  // (the GPU waits for its reader), then grow
+  const int count = slotCount();
+  int index = -1, pending = -1;
+  for (int i = 0; i < count && index < 0; i++) {
+    const int k = (next_ + i) % count;
+    if (!slots_[k]->in_use) {
+      if (slots_[k]->released.isSignaled()) {
+        index = k;
+      } else if (pending < 0) {
+        pending = k;
+      }
+    }
+  }
+
+  if (index < 0 && (count < size_ || pending < 0)) {
+    index = count;
+    slots_.push_back(std::make_shared<TextureBufferSlot>());
+  } else if (index < 0) {
+    index = pending;
+    slots_[index]->released.wait();
+  }
+  next_ = (index + 1) % slotCount();
+
+  std::shared_ptr<TextureBufferSlot> slot = slots_[index];
+  const bool resized = slot->copy && (
+      static_cast<int>(slot->copy->getWidth()) != size.width() ||
+      static_cast<int>(slot->copy->getHeight()) != size.height()
+  );
+  if (!slot->copy || resized) {
+    slot->copy.reset(new gatherer::graphics::RenderTextureCopy(size.width(), size.height()));
+  }
+
+  slot->in_use = true;
+  return slot;
+}
+
+QVideoFrame TextureBufferRing::createVideoFrame(uint textureId, const QSize& size) {
+  GLint viewport[4], framebuffer = 0;
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+  std::shared_ptr<TextureBufferSlot> slot = acquire(size);
+  slot->copy->SetTextureUnit(0, textureId);
+  slot->copy->render();
+
+  // RenderTexture returns to framebuffer 0, which isn't the default one on iOS
+  gatherer::graphics::GLStateCache& gl = gatherer::graphics::GLStateCache::get();
+  gl.bindFramebuffer(framebuffer);
+  gl.viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+  return QVideoFrame(new TextureBuffer(slot), size, TextureBuffer::qtTextureFormat());
+}
@@ -36,6 +36,26 @@
 #define TEXTURE_BUFFER_HPP_
 
 #include <QAbstractVideoBuffer>
+#include <QVideoFrame>
+
+#include <graphics/RenderTextureCopy.h>
+#include <graphics/GLFence.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Output texture of a TextureBufferRing, held by the frames that show it
+struct TextureBufferSlot {
+  std::unique_ptr<gatherer::graphics::RenderTextureCopy> copy;
+  std::atomic<bool> in_use{false};
+
+  // Signaled when the last frame showing the slot is released: draws the
+  // scene graph queued to sample it complete before the slot is rewritten
+  gatherer::graphics::GLFence released;
+
+  void release();
+};
 
 class TextureBuffer: public QAbstractVideoBuffer {
  public:
@@ -43,6 +63,18 @@ class TextureBuffer: public QAbstractVideoBuffer {
     assert(id != 0);
   }
 
+  TextureBuffer(std::shared_ptr<TextureBufferSlot> slot):
+      QAbstractVideoBuffer(GLTextureHandle),
+      id_(slot->copy->getTexture()),
+      slot_(slot) {
+  }
+
+  ~TextureBuffer() {
+    if (slot_) {
+      slot_->release();
+    }
+  }
+
   static QVideoFrame::PixelFormat qtTextureFormat() {
 #if defined(Q_OS_IOS)
     return QVideoFrame::Format_BGRA32;
@@ -90,6 +122,37 @@ class TextureBuffer: public QAbstractVideoBuffer {
 
  private:
   GLuint id_;
+  std::shared_ptr<TextureBufferSlot> slot_;
+};
+
+/*
+  N buffered output textures for the frames returned by a filter.
+
+  Wrapping the output texture of a proc with createVideoFrame() means the
+  next frame renders into a texture the scene graph may still sample, an
+  implicit sync between filter and compositor.  Instead each frame gets a
+  copy in a slot of its own, which stays in use until Qt releases the last
+  QVideoFrame referencing it.  Slots are reused round robin once their
+  release fence has passed, and the ring grows if Qt holds all of them.
+  Needs the filter's GL context to be current.
+*/
+class TextureBufferRing {
+ public:
+  explicit TextureBufferRing(int size = 3): size_(size) {
+  }
+
+  QVideoFrame createVideoFrame(uint textureId, const QSize& size);
+
+  int slotCount() const {
+    return static_cast<int>(slots_.size());
+  }
+
+ private:
+  std::shared_ptr<TextureBufferSlot> acquire(const QSize& size);
+
+  std::vector<std::shared_ptr<TextureBufferSlot>> slots_;
+  int size_;
+  int next_ = 0;
 };
 
 #endif // TEXTURE_BUFFER_HPP_
@@ -46,6 +46,13 @@ void VideoFilter::setFactor(qreal v) {
   }
 }
 
+void VideoFilter::setUnderlay(bool v) {
+  if (m_underlay != v) {
+    m_underlay = v;
+    emit underlayChanged();
+  }
+}
+
 void VideoFilter::setOutputString(QString newOutput) {
   if (m_outputString == newOutput) {
     return;
@@ -36,6 +36,7 @@
 #define VIDEO_FILTER_HPP_
 
 #include <QAbstractVideoFilter>
+#include <QOpenGLFunctions> // GLuint
 
 
 class VideoFilter: public QAbstractVideoFilter {
@@ -45,6 +46,7 @@ class VideoFilter: public QAbstractVideoFilter {
   Q_PROPERTY(QPoint rectanglePosition READ rectanglePosition NOTIFY rectangleChanged)
   Q_PROPERTY(QSize rectangleSize READ rectangleSize NOTIFY rectangleChanged)
   Q_PROPERTY(bool rectangleVisible READ rectangleVisible NOTIFY rectangleChanged)
+  Q_PROPERTY(bool underlay READ underlay WRITE setUnderlay NOTIFY underlayChanged)
 
  public:
   VideoFilter() : m_factor(1), m_outputString("Filter output") {
@@ -60,12 +62,27 @@ class VideoFilter: public QAbstractVideoFilter {
   QSize rectangleSize() const { return m_rectangleSize; }
   bool rectangleVisible() const { return m_rectangleVisible; }
 
+  // Underlay presentation: the runnable leaves the input frame to VideoOutput
+  // and publishes its output texture, which a QTRenderGL item with this
+  // filter as source draws before the scene graph renders
+  bool underlay() const { return m_underlay; }
+  void setUnderlay(bool v);
+
+  // Render thread: texture of the last processed frame (0 if none)
+  void present(GLuint texture, const QSize& size) {
+    m_presentedTexture = texture;
+    m_presentedSize = size;
+  }
+  GLuint presentedTexture() const { return m_presentedTexture; }
+  QSize presentedSize() const { return m_presentedSize; }
+
   QVideoFilterRunnable *createFilterRunnable() Q_DECL_OVERRIDE;
 
  signals:
   void factorChanged();
   void outputStringChanged();
   void rectangleChanged();
+  void underlayChanged();
 
   void updateOutputString(QString newOutput);
   void updateRectangle(QPoint position, QSize size, bool visible);
@@ -81,6 +98,10 @@ class VideoFilter: public QAbstractVideoFilter {
   QPoint m_rectanglePosition;
   QSize m_rectangleSize;
   bool m_rectangleVisible;
+
+  bool m_underlay = false;
+  GLuint m_presentedTexture = 0;
+  QSize m_presentedSize;
 };
 
 #endif // VIDEO_FILTER_HPP_
@@ -39,6 +39,7 @@
 #include <cassert> // assert
 
 #include <graphics/GLExtra.h> // GATHERER_OPENGL_DEBUG
+#include <graphics/GLStateCache.h>
 
 #include "VideoFilter.hpp"
 #include "TextureBuffer.hpp"
@@ -77,6 +78,7 @@ struct VideoFilterRunnable::Impl
     GLuint operator()(const ogles_gpgpu::FrameInput &frame)
     {
         m_video(frame);
+        gatherer::graphics::GLStateCache::get().invalidate(); // ogles_gpgpu binds outside the cache
         return m_filter.getOutputTexId();
     }
     
@@ -102,7 +104,11 @@ m_lastInputTexture(0)
 }
 
 VideoFilterRunnable::~VideoFilterRunnable() {
-    
+    // Destroyed on the render thread when the scene graph is invalidated:
+    // the shared quad buffer goes away with the context
+    if (QOpenGLContext::currentContext()) {
+        gatherer::graphics::GLStateCache::get().release();
+    }
 }
 
 QVideoFrame VideoFilterRunnable::run(QVideoFrame *input, const QVideoSurfaceFormat &surfaceFormat, RunFlags flags)
@@ -125,7 +131,11 @@ QVideoFrame VideoFilterRunnable::run(QVideoFrame *input, const QVideoSurfaceForm
     {
         int orientation = FrameHandlerManager::get()->getOrientation();
         m_pImpl = std::make_shared<Impl>(glContext, orientation);
+        m_outputRing = std::make_shared<TextureBufferRing>();
     }
+
+    // The scene graph has changed GL state since the last frame
+    gatherer::graphics::GLStateCache::get().beginFrame();
     
     // This example supports RGB data only, either in system memory (typical with
     // cameras on all platforms) or as an OpenGL texture (e.g. video playback on
@@ -143,7 +153,17 @@ QVideoFrame VideoFilterRunnable::run(QVideoFrame *input, const QVideoSurfaceForm
     }
 
     m_outTexture = createTextureForFrame(input);
-    return TextureBuffer::createVideoFrame(m_outTexture, input->size());
+    
+    // Underlay: QTRenderGL picks the output up in afterSynchronizing and draws
+    // it in beforeRendering of this frame, before the next frame can overwrite
+    // it, so no copy is needed
+    if (m_filter->underlay()) {
+        m_filter->present(m_outTexture, input->size());
+        return *input;
+    }
+    
+    m_filter->present(0, QSize());
+    return m_outputRing->createVideoFrame(m_outTexture, input->size());
 }
 
 bool VideoFilterRunnable::isFrameValid(const QVideoFrame& frame) {
@@ -41,6 +41,7 @@
 #include <QOpenGLFunctions> // introduce GLuint in cross-platform fashion
 
 class VideoFilter;
+class TextureBufferRing;
 
 //namespace gatherer { namespace graphics { class OEGLGPGPUTest; } }
 
@@ -74,6 +75,9 @@ private:
     //std::shared_ptr<gatherer::graphics::OEGLGPGPUTest> m_pipeline;
     
     std::shared_ptr<Impl> m_pImpl;
+    
+    // Frames returned by run() show copies in this ring, not the proc output
+    std::shared_ptr<TextureBufferRing> m_outputRing;
 };
 
 #endif // VIDEO_FILTER_RUNNABLE_HPP_
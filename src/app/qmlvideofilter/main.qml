@@ -52,8 +52,11 @@ Item {
     objectName: "CameraObject"
   }
 
+  // Draws the filter output under the QML items in underlay mode
   QTRenderGL {
     id: qtrendergl
+    source: videofilter
+    orientation: output.orientation
   }
 
   VideoOutput {
@@ -63,11 +66,15 @@ Item {
     filters: [ infofilter, videofilter ]
     anchors.fill: parent
     orientation: -camera.orientation
+
+    // Still runs the filters in underlay mode, but composites nothing
+    opacity: (videofilter.active && videofilter.underlay) ? 0 : 1
   }
 
   VideoFilter {
     id: videofilter
     active: true
+    underlay: false
   }
 
   InfoFilter {
@@ -88,6 +95,11 @@ Item {
       color: "green"
       text: "Transformed with VideoFilter on GPU\nClick to disable and enable the emboss filter"
     }
+    Text {
+      font.pointSize: 12
+      color: "green"
+      text: (videofilter.underlay ? "Underlay" : "VideoOutput") + " presentation, press and hold to switch"
+    }
     Text {
       font.pointSize: 12
       color: "green"
@@ -142,5 +154,6 @@ Item {
   MouseArea {
     anchors.fill: parent
     onClicked: videofilter.active = !videofilter.active
+    onPressAndHold: videofilter.underlay = !videofilter.underlay
   }
 }
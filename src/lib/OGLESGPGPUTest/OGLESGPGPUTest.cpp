@@ -1,6 +1,7 @@
 #include "OGLESGPGPUTest.h"
 
-#include "ogles_gpgpu/common/gl/memtransfer_optimized.h"
+#include "graphics/GLCapabilities.h"
+#include "graphics/GLStateCache.h"
 
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
@@ -9,24 +10,6 @@
 
 _GATHERER_GRAPHICS_BEGIN
 
-class MemTransferScopeLock
-{
-public:
-    MemTransferScopeLock(ogles_gpgpu::MemTransferOptimized *transfer) : transfer(transfer)
-    {
-        ptr = transfer->lockBufferAndGetPtr(ogles_gpgpu::BUF_TYPE_OUTPUT);
-    }
-    ~MemTransferScopeLock()
-    {
-        transfer->unlockBuffer(ogles_gpgpu::BUF_TYPE_OUTPUT);
-    }
-    const void *data() const { return ptr; }
-    operator const void *() const { return ptr; }
-protected:
-    const void *ptr = 0;
-    ogles_gpgpu::MemTransferOptimized *transfer = 0;
-};
-
 OEGLGPGPUTest::OEGLGPGPUTest(void *glContext, const float resolution, int type)
 : glContext(glContext)
 , resolution(resolution)
@@ -49,6 +32,15 @@ OEGLGPGPUTest::OEGLGPGPUTest(void *glContext, const cv::Size &screenSize, const
 
 OEGLGPGPUTest::~OEGLGPGPUTest()
 {
+    m_lumaTexture.reset();
+    if(m_readFbo)
+    {
+        glDeleteFramebuffers(1, &m_readFbo);
+    }
+    if(m_readBuffer)
+    {
+        glDeleteBuffers(1, &m_readBuffer);
+    }
     ogles_gpgpu::Core::destroy();
     gpgpuMngr = 0;
 }
@@ -79,7 +71,7 @@ void OEGLGPGPUTest::initOGLESGPGPU(void* glContext, int type)
     gpgpuMngr = ogles_gpgpu::Core::getInstance();
 
     // enable iOS optimizations (fast texture access)
-    ogles_gpgpu::Core::tryEnablePlatformOptimizations();
+    m_platformOptimizations = ogles_gpgpu::Core::tryEnablePlatformOptimizations();
 
     // do not use mipmaps (will not work with NPOT images)
     gpgpuMngr->setUseMipmaps(false);
@@ -107,6 +99,9 @@ void OEGLGPGPUTest::initGPUPipeline(int type)
 
     gpgpuMngr->addProcToPipeline(&grayscaleProc);
 
+    // Everything downstream of the grayscale conversion sees luminance only
+    m_lumaPipeline = true;
+
     if(m_doDisplay)
     {
         // create the display renderer with which we can directly render the output
@@ -153,6 +148,67 @@ void OEGLGPGPUTest::getOutputData(unsigned char *data) const
     gpgpuMngr->getOutputData(data);
 }
 
+OutputView OEGLGPGPUTest::lockOutput()
+{
+    OutputView view;
+    const cv::Size size = getOutputSize();
+
+    // iOS, Android: the output texture is backed by a buffer the CPU can lock
+    auto *transfer = m_platformOptimizations ? dynamic_cast<ogles_gpgpu::MemTransferOptimized *>(grayscaleProc.getMemTransferObj()) : nullptr;
+    if(transfer)
+    {
+        view.m_lock = make_unique<MemTransferScopeLock>(transfer);
+        if(view.m_lock->data())
+        {
+            view.m_image = cv::Mat(size, CV_8UC4, const_cast<void *>(view.m_lock->data()), view.m_lock->getBytesPerRow());
+            return view;
+        }
+        view.m_lock.reset();
+    }
+
+#if GATHERER_HAS_PIXEL_BUFFER_MAP
+    // GL 3.0, GLES 3.0: read into a pixel buffer and map it (pixelBuffers implies glMapBufferRange)
+    if(GLCapabilities::get().pixelBuffers)
+    {
+        const size_t bytes = size.area() * 4;
+        if(!m_readFbo)
+        {
+            glGenFramebuffers(1, &m_readFbo);
+            glGenBuffers(1, &m_readBuffer);
+        }
+
+        GLint fbo = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_readFbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, getLastShaderOutputTexture(), 0);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readBuffer);
+        if(bytes != m_readBufferSize)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(bytes), nullptr, GL_STREAM_READ);
+            m_readBufferSize = bytes;
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, size.width, size.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+        view.m_map = make_unique<PixelBufferScopeMap>(m_readBuffer, bytes);
+        if(view.m_map->data())
+        {
+            view.m_image = cv::Mat(size, CV_8UC4, const_cast<void *>(view.m_map->data()));
+            return view;
+        }
+        view.m_map.reset();
+    }
+#endif
+
+    // GLES 2.0 without platform buffers: copy
+    view.m_image.create(size, CV_8UC4);
+    getOutputData(view.m_image.ptr());
+    return view;
+}
+
 cv::Size OEGLGPGPUTest::getOutputSize() const
 {
     return cv::Size(gpgpuMngr->getOutputFrameW(), gpgpuMngr->getOutputFrameH());
@@ -168,13 +224,30 @@ void OEGLGPGPUTest::configurePipeline(const cv::Size &size, GLenum inputPixForma
     prepareForFrameOfSize(frameSize);
 
     outputDispRenderer->setOutputSize(screenSize.width, screenSize.height);
-        
-    // YUV:
-    if(inputPixFormat == 0)
+}
+
+void OEGLGPGPUTest::setLuminanceInput(bool flag)
+{
+    if(flag != m_lumaInput)
+    {
+        // The Y plane is already gray, the first stage only has to pass it through
+        grayscaleProc.setGrayscaleConvType(flag ? ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_NONE : ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_RGB);
+        m_lumaInput = flag;
+    }
+}
+
+void OEGLGPGPUTest::uploadLuminance(const void *pixelBuffer)
+{
+    // CV_8UC1 streams as R8 or GL_LUMINANCE (GLES 2.0), both sample as (Y, Y, Y, 1),
+    // and rows padded by the camera are skipped by the upload
+    if(!m_lumaTexture)
     {
-        yuv2RgbProc.init(frameSize.width, frameSize.height, 0, true); // TODO: NEW
-        yuv2RgbProc.createFBOTex(false);
+        m_lumaTexture = make_unique<GLTexture>(frameSize, CV_8UC1);
     }
+
+    // NV12: the Y plane comes first
+    const size_t step = m_lumaStride ? m_lumaStride : size_t(frameSize.width);
+    m_lumaTexture->load(cv::Mat(frameSize, CV_8UC1, const_cast<void *>(pixelBuffer), step));
 }
 
 void OEGLGPGPUTest::captureOutput(cv::Size size, void* pixelBuffer, bool useRawPixels, GLuint inputTexture, GLenum inputPixFormat)
@@ -187,15 +260,36 @@ void OEGLGPGPUTest::captureOutput(cv::Size size, void* pixelBuffer, bool useRawP
         firstFrame = false;
     }
 
+    // The caller and ogles_gpgpu have used GL since the last frame
+    GLStateCache::get().beginFrame();
+
     gpgpuInputHandler->setUseRawPixels(useRawPixels);
 
     // on each new frame, this will release the input buffers and textures, and prepare new ones
     // texture format must be GL_BGRA because this is one of the native camera formats (see initCam)
     if(pixelBuffer)
     {
-        if(inputPixFormat == 0)
+        // A platform buffer (useRawPixels == false) is a handle, not the Y plane
+        const bool yuv = (inputPixFormat == 0);
+        setLuminanceInput(yuv && useRawPixels && usesLuminanceInput());
+
+        if(m_lumaInput)
+        {
+            // YUV: luminance only, the chroma plane is never touched
+            uploadLuminance(pixelBuffer);
+            gpgpuInputHandler->prepareInput(frameSize.width, frameSize.height, GL_NONE, nullptr);
+            inputTexture = *m_lumaTexture;
+        }
+        else if(yuv)
         {
             // YUV: Special case NV12=>BGR
+            if(!m_yuv2RgbReady)
+            {
+                yuv2RgbProc.init(frameSize.width, frameSize.height, 0, true); // TODO: NEW
+                yuv2RgbProc.createFBOTex(false);
+                m_yuv2RgbReady = true;
+            }
+
             auto manager = yuv2RgbProc.getMemTransferObj();
             if (useRawPixels)
             {
@@ -204,8 +298,7 @@ void OEGLGPGPUTest::captureOutput(cv::Size size, void* pixelBuffer, bool useRawP
             manager->prepareInput(frameSize.width, frameSize.height, inputPixFormat, pixelBuffer);
 
             yuv2RgbProc.setTextures(manager->getLuminanceTexId(), manager->getChrominanceTexId());
-            yuv2RgbProc.render();
-            glFinish();
+            yuv2RgbProc.render(); // same context: the pipeline is ordered after it, no glFinish()
 
             gpgpuInputHandler->prepareInput(frameSize.width, frameSize.height, GL_NONE, nullptr);
             inputTexture = yuv2RgbProc.getOutputTexId(); 
@@ -223,6 +316,14 @@ void OEGLGPGPUTest::captureOutput(cv::Size size, void* pixelBuffer, bool useRawP
     
     // run processing pipeline
     gpgpuMngr->process();
+    GLStateCache::get().invalidate();
+
+    if(frameHandler)
+    {
+        // The handler sees the locked output buffer, it must clone() what it keeps
+        OutputView view = lockOutput();
+        frameHandler(view.getImage());
+    }
 
 #if !defined(NDEBUG)
     std::cerr << "Skipping render..." << std::endl;
@@ -232,6 +333,7 @@ void OEGLGPGPUTest::captureOutput(cv::Size size, void* pixelBuffer, bool useRawP
     {
         // update the GL view to display the output directly
         outputDispRenderer->render(0);
+        GLStateCache::get().invalidate();
     }
 }
 
@@ -2,6 +2,8 @@
 #define OGLESGPGPUTEST_H
 
 #include "graphics/gatherer_graphics.h"
+#include "graphics/GLTexture.h"
+#include "OutputView.h"
 
 #include "ogles_gpgpu/ogles_gpgpu.h"
 #include "ogles_gpgpu/common/gl/memtransfer.h"
@@ -50,20 +52,51 @@ public:
     
     void getInputData(unsigned char *data) const;
     void getOutputData(unsigned char *data) const;
+
+    /// Pipeline output without a copy into caller memory, locked until the view is destroyed
+    OutputView lockOutput();
     
+    /// Called after each frame with lockOutput() of the frame
     void setFrameHandler(FrameHandler &handler) { frameHandler = handler; }
 
     void setDoDisplay(bool flag) { m_doDisplay = flag; }
+
+    /*
+     * Raw NV12 input (useRawPixels) feeds only the Y plane to the pipeline
+     * when it consumes luminance (it starts with the grayscale conversion):
+     * one 8-bit upload and no chroma upload, YUV to RGB pass or color
+     * conversion.  Platform pixel buffers always take the YUV to RGB path.
+     * Takes effect with the next frame.
+     */
+    void setLuminanceFastPath(bool flag) { m_lumaFastPath = flag; }
+    bool usesLuminanceInput() const { return m_lumaFastPath && m_lumaPipeline; }
+
+    /// Bytes per row of the raw NV12 Y plane (0: the frame width)
+    void setLuminanceStride(size_t bytesPerRow) { m_lumaStride = bytesPerRow; }
     
 protected:
 
     void configurePipeline(const cv::Size &size, GLenum inputPixFormat);
+    void setLuminanceInput(bool flag);
+    void uploadLuminance(const void *pixelBuffer);
     
     void *glContext = 0;
     float resolution = 1.f;
     
     bool m_doDisplay = true;
 
+    bool m_lumaFastPath = true;
+    bool m_lumaPipeline = false;    // the pipeline only consumes luminance
+    bool m_lumaInput = false;       // the grayscale stage passes the Y plane through
+    size_t m_lumaStride = 0;
+    std::unique_ptr<GLTexture> m_lumaTexture;   // Y plane of NV12 input
+    bool m_yuv2RgbReady = false;    // yuv2RgbProc initialized for frameSize
+
+    bool m_platformOptimizations = false;
+    GLuint m_readFbo = 0;           // lockOutput() with pixel buffers
+    GLuint m_readBuffer = 0;
+    size_t m_readBufferSize = 0;
+
     unsigned int selectedProcType;  // selected processors
     bool showCamPreview;        // is YES if the camera preview is shown or NO if the processed frames are shown
     bool firstFrame;            // is YES when the current frame is the very first camera frame
@@ -0,0 +1,144 @@
+//
+//  OutputView.h
+//  gatherer
+//
+
+#ifndef __gatherer__OutputView__
+#define __gatherer__OutputView__
+
+#include "graphics/gatherer_graphics.h"
+
+#include "ogles_gpgpu/common/gl/memtransfer_optimized.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+
+// Mapped pack buffers need glMapBufferRange (GL 3.0 / GLES 3.0 headers), see GLCapabilities::pixelBuffers
+#if defined(GL_PIXEL_PACK_BUFFER) && defined(GL_MAP_READ_BIT)
+#  define GATHERER_HAS_PIXEL_BUFFER_MAP 1
+#else
+#  define GATHERER_HAS_PIXEL_BUFFER_MAP 0
+#endif
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class MemTransferScopeLock
+ *
+ * \brief Locks the output buffer of a platform memory transfer (iOS, Android) for CPU access
+ */
+
+class MemTransferScopeLock
+{
+public:
+    MemTransferScopeLock(ogles_gpgpu::MemTransferOptimized *transfer) : transfer(transfer)
+    {
+        ptr = transfer->lockBufferAndGetPtr(ogles_gpgpu::BUF_TYPE_OUTPUT);
+    }
+    ~MemTransferScopeLock()
+    {
+        transfer->unlockBuffer(ogles_gpgpu::BUF_TYPE_OUTPUT);
+    }
+    MemTransferScopeLock(const MemTransferScopeLock &) = delete;
+    MemTransferScopeLock & operator=(const MemTransferScopeLock &) = delete;
+
+    const void *data() const { return ptr; }
+    operator const void *() const { return ptr; }
+    size_t getBytesPerRow() const { return transfer->getBytesPerRow(); }
+protected:
+    const void *ptr = 0;
+    ogles_gpgpu::MemTransferOptimized *transfer = 0;
+};
+
+/**
+ * \class PixelBufferScopeMap
+ *
+ * \brief Maps a GL_PIXEL_PACK_BUFFER for reading (GL 3.0 / GLES 3.0, GL_ARB_map_buffer_range)
+ */
+
+#if GATHERER_HAS_PIXEL_BUFFER_MAP
+class PixelBufferScopeMap
+{
+public:
+    PixelBufferScopeMap(GLuint buffer, size_t bytes) : buffer(buffer)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(bytes), GL_MAP_READ_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    ~PixelBufferScopeMap()
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    PixelBufferScopeMap(const PixelBufferScopeMap &) = delete;
+    PixelBufferScopeMap & operator=(const PixelBufferScopeMap &) = delete;
+
+    const void *data() const { return ptr; }
+protected:
+    const void *ptr = 0;
+    GLuint buffer = 0;
+};
+#endif
+
+/**
+ * \class OutputView
+ *
+ * \brief Read only cv::Mat header over the pipeline output, valid while the view exists
+ *
+ * The image points into the locked platform buffer (iOS, Android) or into
+ * a mapped pixel buffer (GL 3.0, GLES 3.0), so no copy is made on the CPU.  The
+ * buffer is unlocked when the view is destroyed: clone() the image to keep
+ * it longer, and release the view before the next frame is processed.
+ *
+ * @code
+ *
+ * {
+ *     auto view = pipeline.lockOutput();
+ *     const cv::Mat &frame = view.getImage(); // CV_8UC4, possibly padded rows
+ *     ...
+ * } // unlocked
+ *
+ * @endcode
+ */
+
+class OutputView
+{
+public:
+
+    OutputView() {}
+    OutputView(OutputView &&) = default;
+    OutputView & operator=(OutputView &&) = default;
+
+    const cv::Mat & getImage() const { return m_image; }
+    operator const cv::Mat &() const { return m_image; }
+    bool empty() const { return m_image.empty(); }
+
+    /// False if the image is a copy (no platform buffer and no pixel buffers)
+    bool isZeroCopy() const;
+
+protected:
+
+    friend class OEGLGPGPUTest;
+
+    cv::Mat m_image; // header only, the guards own the buffer
+    std::unique_ptr<MemTransferScopeLock> m_lock;
+#if GATHERER_HAS_PIXEL_BUFFER_MAP
+    std::unique_ptr<PixelBufferScopeMap> m_map;
+#endif
+};
+
+inline bool OutputView::isZeroCopy() const
+{
+#if GATHERER_HAS_PIXEL_BUFFER_MAP
+    return m_lock || m_map;
+#else
+    return bool(m_lock);
+#endif
+}
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__OutputView__) */
@@ -0,0 +1,177 @@
+//
+//  CornerDetector.cpp
+//  gatherer
+//
+
+#include "cpu/CornerDetector.h"
+#include "cpu/Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+_GATHERER_CPU_BEGIN
+
+// Discrete taps of the 9 tap GaussProc kernel (924, 792, 495, 220, 66 / 4070)
+static const float kGauss[5] =
+{
+    924.f / 4070.f, 792.f / 4070.f, 495.f / 4070.f, 220.f / 4070.f, 66.f / 4070.f
+};
+
+static inline float saturate(float value)
+{
+    return std::min(std::max(value, 0.f), 1.f);
+}
+
+void CornerDetector::render(const cv::Mat &input, cv::Mat &output)
+{
+    CV_Assert(input.depth() == CV_8U);
+
+    output.release();
+    m_keypoints.clear();
+
+    const int width = input.cols;
+    const int height = input.rows;
+    const int channels = input.channels();
+    if(width < 1 || height < 1)
+    {
+        return;
+    }
+
+    const int r = 4;
+    const int taps = 2 * r + 1;
+    const float strength = m_edgeStrength / 255.f;
+    const float sensitivity = m_sensitivity;
+    const float threshold = m_threshold;
+
+    std::mutex mutex;
+    std::vector<std::pair<int, Keypoints>> bands;
+
+    parallelRows(height, m_options.parallel, [&](const cv::Range &range)
+    {
+        // 9 rows of horizontally blurred (xx, yy, xy) tensor, 3 rows of scores
+        std::vector<float> tensor(width * 3), padded((width + 2 * r) * 3), window(taps * width * 3), scores(3 * width);
+
+        auto tensorRow = [&](int y) { return window.data() + (y % taps) * width * 3; };
+        auto scoreRow = [&](int y) { return scores.data() + (y % 3) * width; };
+        auto clampY = [&](int y) { return std::min(std::max(y, 0), height - 1); };
+
+        // Stage 1+2a: Prewitt structure tensor followed by the horizontal blur
+        auto computeTensor = [&](int y)
+        {
+            const uint8_t *r0 = input.ptr<uint8_t>(clampY(y - 1));
+            const uint8_t *r1 = input.ptr<uint8_t>(y);
+            const uint8_t *r2 = input.ptr<uint8_t>(clampY(y + 1));
+            for(int x = 0; x < width; x++)
+            {
+                const int xl = std::max(x - 1, 0) * channels, xc = x * channels, xr = std::min(x + 1, width - 1) * channels;
+                const float dx = float(int(r0[xr]) + r1[xr] + r2[xr] - r0[xl] - r1[xl] - r2[xl]) * strength;
+                const float dy = float(int(r2[xl]) + r2[xc] + r2[xr] - r0[xl] - r0[xc] - r0[xr]) * strength;
+                float *t = padded.data() + (x + r) * 3;
+                t[0] = saturate(dx * dx);
+                t[1] = saturate(dy * dy);
+                t[2] = saturate((dx * dy + 1.f) * 0.5f);
+            }
+            for(int i = 1; i <= r; i++)
+            {
+                std::copy_n(padded.data() + r * 3, 3, padded.data() + (r - i) * 3);
+                std::copy_n(padded.data() + (width + r - 1) * 3, 3, padded.data() + (width + r - 1 + i) * 3);
+            }
+
+            float *dst = tensorRow(y);
+            const float *src = padded.data() + r * 3;
+            for(int i = 0; i < width * 3; i++)
+            {
+                float sum = kGauss[0] * src[i];
+                for(int k = 1; k <= r; k++)
+                {
+                    sum += kGauss[k] * (src[i - k * 3] + src[i + k * 3]);
+                }
+                dst[i] = sum;
+            }
+        };
+
+        // Stage 2b+3: vertical blur and Shi-Tomasi response
+        auto computeScore = [&](int y)
+        {
+            const float *rows[taps];
+            for(int k = 0; k < taps; k++)
+            {
+                rows[k] = tensorRow(clampY(y - r + k));
+            }
+            float *t = tensor.data();
+            for(int i = 0; i < width * 3; i++)
+            {
+                float sum = kGauss[0] * rows[r][i];
+                for(int k = 1; k <= r; k++)
+                {
+                    sum += kGauss[k] * (rows[r - k][i] + rows[r + k][i]);
+                }
+                t[i] = sum;
+            }
+
+            float *score = scoreRow(y);
+            for(int x = 0; x < width; x++, t += 3)
+            {
+                const float xx = t[0], yy = t[1], xy = t[2] * 2.f - 1.f;
+                const float d = xx - yy;
+                score[x] = saturate((xx + yy - std::sqrt(d * d + 4.f * xy * xy)) * sensitivity);
+            }
+        };
+
+        // Stage 4: thresholded 3x3 non-maximum suppression (ties go to the upper left pixel)
+        Keypoints keypoints;
+        auto suppress = [&](int y)
+        {
+            const float *s0 = scoreRow(clampY(y - 1));
+            const float *s1 = scoreRow(y);
+            const float *s2 = scoreRow(clampY(y + 1));
+            for(int x = 0; x < width; x++)
+            {
+                const float c = s1[x];
+                if(c <= 0.f || c < threshold)
+                {
+                    continue;
+                }
+                const int xl = std::max(x - 1, 0), xr = std::min(x + 1, width - 1);
+                if(s0[xl] < c && s0[x] < c && s1[xl] < c && s2[xl] < c &&
+                   s0[xr] <= c && s1[xr] <= c && s2[xr] <= c && s2[x] <= c)
+                {
+                    keypoints.push_back(float(x), float(y), c);
+                }
+            }
+        };
+
+        const int scoreBegin = std::max(range.start - 1, 0), scoreEnd = std::min(range.end + 1, height);
+        int nextTensor = std::max(scoreBegin - r, 0), nextRow = range.start;
+        for(int y = scoreBegin; y < scoreEnd; y++)
+        {
+            for(; nextTensor <= std::min(y + r, height - 1); nextTensor++)
+            {
+                computeTensor(nextTensor);
+            }
+            computeScore(y);
+            for(; nextRow < range.end && clampY(nextRow + 1) <= y; nextRow++)
+            {
+                suppress(nextRow);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        bands.emplace_back(range.start, std::move(keypoints));
+    });
+
+    // Merge the bands back into raster order
+    std::sort(bands.begin(), bands.end(), [](const std::pair<int, Keypoints> &a, const std::pair<int, Keypoints> &b)
+    {
+        return a.first < b.first;
+    });
+    for(const auto &band : bands)
+    {
+        m_keypoints.append(band.second);
+    }
+}
+
+_GATHERER_CPU_END
@@ -0,0 +1,74 @@
+//
+//  CornerDetector.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__CornerDetector__
+#define __gatherer__cpu__CornerDetector__
+
+#include "cpu/gatherer_cpu.h"
+#include "cpu/ProcBase.h"
+#include "cpu/Keypoints.h"
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \class CornerDetector
+ *
+ * \brief Fused CPU equivalent of TensorProc -> GaussProc -> ShiTomasiProc -> NmsProc
+ *
+ * The four shader stages are evaluated in a single streaming pass over row
+ * bands.  Each band keeps a 9 row ring of horizontally blurred structure
+ * tensor rows and a 3 row ring of corner scores, so no full-frame
+ * intermediate is ever allocated and the working set stays in cache.  The
+ * surviving maxima are returned directly as a keypoint list instead of a mask:
+ *
+ * @code
+ *
+ * gatherer::cpu::GrayscaleProc grayscaleProc;
+ * gatherer::cpu::CornerDetector cornerDetector;
+ * grayscaleProc.add(&cornerDetector);
+ * grayscaleProc.process(image);
+ * const auto &keypoints = cornerDetector.getKeypoints();
+ *
+ * @endcode
+ *
+ * Channel 0 of the input is used.  Intermediate values are clamped to [0,1]
+ * as they are when the shaders write to 8-bit textures.  This stage produces
+ * no image, so getResult() is empty.
+ */
+
+class CornerDetector : public ProcBase
+{
+public:
+
+    virtual const char *getProcName() const { return "CornerDetector"; }
+
+    /// Derivative scale, as ogles_gpgpu::TensorProc::setEdgeStrength()
+    void setEdgeStrength(float strength) { m_edgeStrength = strength; }
+    float getEdgeStrength() const { return m_edgeStrength; }
+
+    /// Corner response scale, as ogles_gpgpu::ShiTomasiProc::setSensitivity()
+    void setSensitivity(float sensitivity) { m_sensitivity = sensitivity; }
+    float getSensitivity() const { return m_sensitivity; }
+
+    /// Minimum response of a local maximum, as ogles_gpgpu::NmsProc::setThreshold()
+    void setThreshold(float threshold) { m_threshold = threshold; }
+    float getThreshold() const { return m_threshold; }
+
+    const Keypoints & getKeypoints() const { return m_keypoints; }
+
+protected:
+
+    virtual void render(const cv::Mat &input, cv::Mat &output);
+
+    float m_edgeStrength = 1.f;
+    float m_sensitivity = 1.f;
+    float m_threshold = 0.1f;
+
+    Keypoints m_keypoints;
+};
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__CornerDetector__) */
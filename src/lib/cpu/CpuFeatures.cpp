@@ -0,0 +1,115 @@
+//
+//  CpuFeatures.cpp
+//  gatherer
+//
+
+#include "cpu/CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <intrin.h>
+#  define GATHERER_CPU_CPUID 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  include <cpuid.h>
+#  define GATHERER_CPU_CPUID 1
+#else
+#  define GATHERER_CPU_CPUID 0
+#endif
+
+_GATHERER_CPU_BEGIN
+
+#if GATHERER_CPU_CPUID
+
+static void cpuid(int leaf, int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, leaf, subleaf);
+    for(int i = 0; i < 4; i++)
+    {
+        regs[i] = static_cast<unsigned int>(info[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// XCR0: which register states the OS saves on context switch
+static unsigned long long xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+static CpuFeatures detect()
+{
+    CpuFeatures features;
+
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    const unsigned int maxLeaf = regs[0];
+
+    cpuid(1, 0, regs);
+    const unsigned int ecx1 = regs[2], edx1 = regs[3];
+    features.sse2 = (edx1 >> 26) & 1;
+    features.ssse3 = (ecx1 >> 9) & 1;
+    features.sse41 = features.ssse3 && ((ecx1 >> 19) & 1);
+
+    const bool osxsave = (ecx1 >> 27) & 1;
+    const bool avx = (ecx1 >> 28) & 1;
+    if(osxsave && avx && maxLeaf >= 7)
+    {
+        const unsigned long long xcr0 = xgetbv0();
+        const bool ymm = (xcr0 & 0x6) == 0x6;     // SSE + AVX state
+        const bool zmm = (xcr0 & 0xe6) == 0xe6;   // + opmask, ZMM_Hi256, Hi16_ZMM state
+
+        cpuid(7, 0, regs);
+        const unsigned int ebx7 = regs[1];
+        features.avx2 = ymm && ((ebx7 >> 5) & 1);
+        features.avx512bw = zmm && features.avx2 && ((ebx7 >> 16) & 1) && ((ebx7 >> 30) & 1);
+    }
+
+    return features;
+}
+
+#else
+
+static CpuFeatures detect()
+{
+    CpuFeatures features;
+    features.neon = GATHERER_CPU_NEON;
+    return features;
+}
+
+#endif // GATHERER_CPU_CPUID
+
+const CpuFeatures & CpuFeatures::get()
+{
+    static const CpuFeatures features = detect();
+    return features;
+}
+
+std::string CpuFeatures::toString() const
+{
+    std::string result;
+    auto append = [&](bool enabled, const char *name)
+    {
+        if(enabled)
+        {
+            result += result.empty() ? name : (std::string(" ") + name);
+        }
+    };
+    append(sse2, "sse2");
+    append(ssse3, "ssse3");
+    append(sse41, "sse4.1");
+    append(avx2, "avx2");
+    append(avx512bw, "avx512bw");
+    append(neon, "neon");
+    return result;
+}
+
+_GATHERER_CPU_END
@@ -0,0 +1,40 @@
+//
+//  CpuFeatures.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__CpuFeatures__
+#define __gatherer__cpu__CpuFeatures__
+
+#include "cpu/gatherer_cpu.h"
+
+#include <string>
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \struct CpuFeatures
+ *
+ * \brief Instruction set extensions usable on the host
+ *
+ * Detected once with cpuid, including the OS support (xgetbv) needed for the
+ * AVX register state.  On ARM builds neon reflects the compile target.
+ */
+
+struct CpuFeatures
+{
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool avx2 = false;
+    bool avx512bw = false; // AVX-512 F + BW
+    bool neon = false;
+
+    static const CpuFeatures & get();
+
+    std::string toString() const;
+};
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__CpuFeatures__) */
@@ -0,0 +1,67 @@
+//
+//  GaussProc.cpp
+//  gatherer
+//
+
+#include "cpu/GaussProc.h"
+#include "cpu/Kernels.h"
+#include "cpu/Parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+_GATHERER_CPU_BEGIN
+
+void GaussProc::render(const cv::Mat &input, cv::Mat &output)
+{
+    CV_Assert(input.depth() == CV_8U);
+
+    const int r = kernels::kGaussRadius;
+    const int taps = 2 * r + 1;
+    const int width = input.cols;
+    const int height = input.rows;
+    const int channels = input.channels();
+    const int count = width * channels;
+    const bool simd = m_options.simd;
+
+    output.create(input.size(), input.type());
+    parallelRows(height, m_options.parallel, [&](const cv::Range &range)
+    {
+        std::vector<uint8_t> padded((width + 2 * r) * channels);
+        std::vector<int16_t> window(taps * count);
+
+        auto slot = [&](int y) { return window.data() + (((y % taps) + taps) % taps) * count; };
+        auto filterRow = [&](int y)
+        {
+            // Replicate the border (GL_CLAMP_TO_EDGE) around a copy of the source row
+            const uint8_t *src = input.ptr<uint8_t>(std::min(std::max(y, 0), height - 1));
+            uint8_t *row = padded.data() + r * channels;
+            std::memcpy(row, src, count);
+            for(int i = 1; i <= r; i++)
+            {
+                std::memcpy(row - i * channels, src, channels);
+                std::memcpy(row + (width - 1 + i) * channels, src + (width - 1) * channels, channels);
+            }
+            kernels::rowGaussH(row, slot(y), width, channels, simd);
+        };
+
+        for(int y = range.start - r; y < range.start + r; y++)
+        {
+            filterRow(y);
+        }
+
+        const int16_t *rows[taps];
+        for(int y = range.start; y < range.end; y++)
+        {
+            filterRow(y + r);
+            for(int k = 0; k < taps; k++)
+            {
+                rows[k] = slot(y - r + k);
+            }
+            kernels::rowGaussV(rows, output.ptr<uint8_t>(y), count, simd);
+        }
+    });
+}
+
+_GATHERER_CPU_END
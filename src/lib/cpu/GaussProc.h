@@ -0,0 +1,38 @@
+//
+//  GaussProc.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__GaussProc__
+#define __gatherer__cpu__GaussProc__
+
+#include "cpu/gatherer_cpu.h"
+#include "cpu/ProcBase.h"
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \class GaussProc
+ *
+ * \brief CPU equivalent of ogles_gpgpu::GaussProc
+ *
+ * Separable 9 tap gaussian applied to every channel of 8-bit input (e.g. the
+ * packed GradProc output in the pyredge pipeline).  Each row stripe keeps a
+ * sliding window of 9 horizontally filtered rows, so the vertical pass never
+ * touches a full-frame intermediate.
+ */
+
+class GaussProc : public ProcBase
+{
+public:
+
+    virtual const char *getProcName() const { return "GaussProc"; }
+
+protected:
+
+    virtual void render(const cv::Mat &input, cv::Mat &output);
+};
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__GaussProc__) */
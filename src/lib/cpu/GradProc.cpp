@@ -0,0 +1,37 @@
+//
+//  GradProc.cpp
+//  gatherer
+//
+
+#include "cpu/GradProc.h"
+#include "cpu/Kernels.h"
+#include "cpu/Parallel.h"
+
+#include <algorithm>
+
+_GATHERER_CPU_BEGIN
+
+void GradProc::render(const cv::Mat &input, cv::Mat &output)
+{
+    CV_Assert(input.depth() == CV_8U);
+
+    const cv::Mat *gray = &getLuminance(input);
+
+    const int rows = gray->rows;
+    const float strength = m_strength;
+    const bool simd = m_options.simd;
+
+    output.create(gray->size(), CV_8UC4);
+    parallelRows(rows, m_options.parallel, [&](const cv::Range &range)
+    {
+        for(int y = range.start; y < range.end; y++)
+        {
+            const uint8_t *r0 = gray->ptr<uint8_t>(std::max(y - 1, 0));
+            const uint8_t *r1 = gray->ptr<uint8_t>(y);
+            const uint8_t *r2 = gray->ptr<uint8_t>(std::min(y + 1, rows - 1));
+            kernels::rowGradient(r0, r1, r2, output.ptr<uint8_t>(y), gray->cols, strength, simd);
+        }
+    });
+}
+
+_GATHERER_CPU_END
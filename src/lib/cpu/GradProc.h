@@ -0,0 +1,42 @@
+//
+//  GradProc.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__GradProc__
+#define __gatherer__cpu__GradProc__
+
+#include "cpu/gatherer_cpu.h"
+#include "cpu/ProcBase.h"
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \class GradProc
+ *
+ * \brief CPU equivalent of ogles_gpgpu::GradProc
+ *
+ * 3x3 Sobel gradient of channel 0 of the input, packed into CV_8UC4 exactly as
+ * the shader writes it: (magnitude, orientation, dx, dy).  See
+ * kernels::rowGradient() for the encoding.
+ */
+
+class GradProc : public ProcBase
+{
+public:
+
+    virtual const char *getProcName() const { return "GradProc"; }
+
+    void setStrength(float strength) { m_strength = strength; }
+    float getStrength() const { return m_strength; }
+
+protected:
+
+    virtual void render(const cv::Mat &input, cv::Mat &output);
+
+    float m_strength = 1.f;
+};
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__GradProc__) */
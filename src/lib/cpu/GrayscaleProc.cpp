@@ -0,0 +1,38 @@
+//
+//  GrayscaleProc.cpp
+//  gatherer
+//
+
+#include "cpu/GrayscaleProc.h"
+#include "cpu/Kernels.h"
+#include "cpu/Parallel.h"
+
+_GATHERER_CPU_BEGIN
+
+void GrayscaleProc::render(const cv::Mat &input, cv::Mat &output)
+{
+    CV_Assert(input.depth() == CV_8U);
+
+    if(m_convType == GRAYSCALE_INPUT_CONVERSION_NONE)
+    {
+        input.copyTo(output);
+        return;
+    }
+
+    const int channels = input.channels();
+    CV_Assert(channels == 1 || channels == 3 || channels == 4);
+
+    const auto weights = (m_convType == GRAYSCALE_INPUT_CONVERSION_RGB) ? kernels::getGrayWeightsRGB() : kernels::getGrayWeightsBGR();
+    const bool simd = m_options.simd;
+
+    output.create(input.size(), CV_8UC1);
+    parallelRows(input.rows, m_options.parallel, [&](const cv::Range &range)
+    {
+        for(int y = range.start; y < range.end; y++)
+        {
+            kernels::rowToGray(input.ptr<uint8_t>(y), output.ptr<uint8_t>(y), input.cols, channels, weights, simd);
+        }
+    });
+}
+
+_GATHERER_CPU_END
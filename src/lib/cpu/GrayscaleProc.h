@@ -0,0 +1,50 @@
+//
+//  GrayscaleProc.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__GrayscaleProc__
+#define __gatherer__cpu__GrayscaleProc__
+
+#include "cpu/gatherer_cpu.h"
+#include "cpu/ProcBase.h"
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \class GrayscaleProc
+ *
+ * \brief CPU equivalent of ogles_gpgpu::GrayscaleProc
+ *
+ * Converts 1, 3 or 4 channel 8-bit input to a CV_8UC1 luminance image with the
+ * same BT.601 weights as the shader.  Channel order refers to memory order, so
+ * the default GRAYSCALE_INPUT_CONVERSION_BGR matches OpenCV images (and BGRA
+ * frames uploaded with GL_BGRA on the GPU path).
+ */
+
+class GrayscaleProc : public ProcBase
+{
+public:
+
+    enum GrayscaleInputConvType
+    {
+        GRAYSCALE_INPUT_CONVERSION_NONE,    // pass through
+        GRAYSCALE_INPUT_CONVERSION_RGB,
+        GRAYSCALE_INPUT_CONVERSION_BGR
+    };
+
+    virtual const char *getProcName() const { return "GrayscaleProc"; }
+
+    void setGrayscaleConvType(GrayscaleInputConvType type) { m_convType = type; }
+    GrayscaleInputConvType getGrayscaleConvType() const { return m_convType; }
+
+protected:
+
+    virtual void render(const cv::Mat &input, cv::Mat &output);
+
+    GrayscaleInputConvType m_convType = GRAYSCALE_INPUT_CONVERSION_BGR;
+};
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__GrayscaleProc__) */
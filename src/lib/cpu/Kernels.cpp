@@ -0,0 +1,211 @@
+//
+//  Kernels.cpp
+//  gatherer
+//
+
+#include "cpu/KernelsImpl.h"
+#include "cpu/CpuFeatures.h"
+
+#include <cstdlib>
+#include <cstring>
+
+_GATHERER_CPU_BEGIN
+
+namespace kernels
+{
+
+GrayWeights getGrayWeightsRGB()
+{
+    return { kWeightR, kWeightG, kWeightB };
+}
+
+GrayWeights getGrayWeightsBGR()
+{
+    return { kWeightB, kWeightG, kWeightR };
+}
+
+// ########### Dispatch ###########
+
+static const KernelTable kScalar =
+{
+    "scalar", scalar::rowToGray, scalar::rowGradient, scalar::rowGaussH, scalar::rowGaussV, scalar::rowLbp
+};
+
+#if GATHERER_CPU_SSE2
+static const KernelTable kSSE2 =
+{
+    "sse2", sse2::rowToGray, sse2::rowGradient, sse2::rowGaussH, sse2::rowGaussV, sse2::rowLbp
+};
+#endif
+
+#if GATHERER_CPU_X86_DISPATCH
+static const KernelTable kSSE41 =
+{
+    "sse41", sse41::rowToGray, sse2::rowGradient, sse2::rowGaussH, sse2::rowGaussV, sse2::rowLbp
+};
+
+static const KernelTable kAVX2 =
+{
+    "avx2", avx2::rowToGray, avx2::rowGradient, avx2::rowGaussH, avx2::rowGaussV, avx2::rowLbp
+};
+
+static const KernelTable kAVX512 =
+{
+    "avx512", avx2::rowToGray, avx2::rowGradient, avx512::rowGaussH, avx2::rowGaussV, avx512::rowLbp
+};
+#endif
+
+#if GATHERER_CPU_NEON
+static const KernelTable kNEON =
+{
+    "neon", neon::rowToGray, neon::rowGradient, neon::rowGaussH, neon::rowGaussV, neon::rowLbp
+};
+#endif
+
+std::vector<const KernelTable *> getAvailableKernels()
+{
+    const CpuFeatures &features = CpuFeatures::get();
+
+    std::vector<const KernelTable *> tables { &kScalar };
+#if GATHERER_CPU_SSE2
+    tables.push_back(&kSSE2);
+#endif
+#if GATHERER_CPU_X86_DISPATCH
+    if(features.sse41)
+    {
+        tables.push_back(&kSSE41);
+    }
+    if(features.avx2)
+    {
+        tables.push_back(&kAVX2);
+    }
+    if(features.avx512bw)
+    {
+        tables.push_back(&kAVX512);
+    }
+#endif
+#if GATHERER_CPU_NEON
+    tables.push_back(&kNEON);
+#endif
+    (void)features;
+    return tables;
+}
+
+const KernelTable * findKernels(const char *name)
+{
+    for(const auto *table : getAvailableKernels())
+    {
+        if(std::strcmp(table->name, name) == 0)
+        {
+            return table;
+        }
+    }
+    return nullptr;
+}
+
+static const KernelTable * selectKernels()
+{
+    if(const char *name = std::getenv("GATHERER_CPU_DISPATCH"))
+    {
+        if(const KernelTable *table = findKernels(name))
+        {
+            return table;
+        }
+    }
+    return getAvailableKernels().back();
+}
+
+const KernelTable & getKernels()
+{
+    static const KernelTable *table = selectKernels();
+    return *table;
+}
+
+const KernelTable & getScalarKernels()
+{
+    return kScalar;
+}
+
+static inline const KernelTable & select(bool simd)
+{
+    return simd ? getKernels() : kScalar;
+}
+
+// ########### Entry points ###########
+
+void rowToGray(const uint8_t *src, uint8_t *dst, int width, int channels, const GrayWeights &weights, bool simd)
+{
+    select(simd).rowToGray(src, dst, width, channels, weights);
+}
+
+void rowExtractChannel(const uint8_t *src, uint8_t *dst, int width, int channels)
+{
+    for(int x = 0; x < width; x++)
+    {
+        dst[x] = src[x * channels];
+    }
+}
+
+void rowGradient(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, float strength, bool simd)
+{
+    select(simd).rowGradient(r0, r1, r2, dst, width, strength);
+}
+
+void rowGaussH(const uint8_t *src, int16_t *dst, int width, int channels, bool simd)
+{
+    select(simd).rowGaussH(src, dst, width, channels);
+}
+
+void rowGaussV(const int16_t * const rows[9], uint8_t *dst, int count, bool simd)
+{
+    select(simd).rowGaussV(rows, dst, count);
+}
+
+void rowLbp(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, bool simd)
+{
+    select(simd).rowLbp(r0, r1, r2, dst, width);
+}
+
+// ########### LBP tables ###########
+
+static bool isUniform(int code)
+{
+    // At most two 0/1 transitions around the (circular) neighbourhood
+    const int rotated = ((code << 1) | (code >> 7)) & 0xff;
+    int transitions = 0;
+    for(int bits = code ^ rotated; bits; bits &= bits - 1)
+    {
+        transitions++;
+    }
+    return transitions <= 2;
+}
+
+const uint8_t * getLbpUniformTable()
+{
+    struct Table
+    {
+        uint8_t labels[256];
+        Table()
+        {
+            int next = 0;
+            for(int code = 0; code < 256; code++)
+            {
+                labels[code] = uint8_t(isUniform(code) ? next++ : kLbpUniformBins - 1);
+            }
+        }
+    };
+    static const Table table;
+    return table.labels;
+}
+
+void rowLookup(const uint8_t *src, uint8_t *dst, int width, const uint8_t *table)
+{
+    for(int x = 0; x < width; x++)
+    {
+        dst[x] = table[src[x]];
+    }
+}
+
+} // namespace kernels
+
+_GATHERER_CPU_END
@@ -0,0 +1,111 @@
+//
+//  Kernels.h
+//  gatherer
+//
+//  Row kernels shared by the CPU processing stages.  Each kernel has a scalar
+//  reference and one or more vectorized variants (SSE2, SSE4.1, AVX2,
+//  AVX-512, NEON) which produce bit-identical results.  The best variant for
+//  the host is bound at startup (see getKernels()); the simd flag of each
+//  entry point selects between it and the scalar reference.
+//
+
+#ifndef __gatherer__cpu__Kernels__
+#define __gatherer__cpu__Kernels__
+
+#include "cpu/gatherer_cpu.h"
+
+#include <cstdint>
+#include <vector>
+
+_GATHERER_CPU_BEGIN
+
+namespace kernels
+{
+    /// Q14 fixed point luminance weights in memory channel order (sum to 1 << 14)
+    struct GrayWeights
+    {
+        int16_t c0, c1, c2;
+    };
+
+    GrayWeights getGrayWeightsRGB();
+    GrayWeights getGrayWeightsBGR();
+
+    /// Convert a row of 1, 3 or 4 channel pixels to 8-bit luminance
+    void rowToGray(const uint8_t *src, uint8_t *dst, int width, int channels, const GrayWeights &weights, bool simd);
+
+    /// Copy channel 0 of a row of interleaved pixels
+    void rowExtractChannel(const uint8_t *src, uint8_t *dst, int width, int channels);
+
+    /*
+     * 3x3 Sobel gradient of one row packed as ogles_gpgpu::GradProc writes it:
+     *   R: clamp(strength * |g|)
+     *   G: (atan2(dy, dx) + pi) / (2 * pi)
+     *   B: clamp(strength * dx * 0.5 + 0.5)
+     *   A: clamp(strength * dy * 0.5 + 0.5)
+     * with intensities normalized to [0,1] and rows r0, r1, r2 centered on r1.
+     * Columns are clamped to the edge as with GL_CLAMP_TO_EDGE sampling.
+     */
+    void rowGradient(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, float strength, bool simd);
+
+    /// Number of taps on each side of the 9 tap GaussProc kernel
+    enum { kGaussRadius = 4 };
+
+    /*
+     * Horizontal 9 tap gaussian (the discrete taps behind the linear sampled
+     * GaussProc shader: 924, 792, 495, 220, 66 / 4070, in Q8).  src must have
+     * kGaussRadius replicated border pixels on each side; dst is Q6.
+     */
+    void rowGaussH(const uint8_t *src, int16_t *dst, int width, int channels, bool simd);
+
+    /// Vertical 9 tap gaussian over Q6 rows produced by rowGaussH()
+    void rowGaussV(const int16_t * const rows[9], uint8_t *dst, int count, bool simd);
+
+    /*
+     * 8 neighbour local binary pattern of one row, bit order as ogles_gpgpu::LbpProc:
+     *   64 128   1
+     *   32   c   2
+     *   16   8   4
+     * A bit is set when the neighbour is >= the center.  Columns are clamped.
+     */
+    void rowLbp(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, bool simd);
+
+    /// Number of labels produced by the uniform pattern table
+    enum { kLbpUniformBins = 59 };
+
+    /// Map of the 256 LBP codes to 58 uniform pattern labels [0,57] plus one non-uniform label (58)
+    const uint8_t * getLbpUniformTable();
+
+    /// dst[i] = table[src[i]]
+    void rowLookup(const uint8_t *src, uint8_t *dst, int width, const uint8_t *table);
+
+    /// One instruction set variant of the dispatched kernels (arguments as above)
+    struct KernelTable
+    {
+        const char *name;
+        void (*rowToGray)(const uint8_t *src, uint8_t *dst, int width, int channels, const GrayWeights &weights);
+        void (*rowGradient)(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, float strength);
+        void (*rowGaussH)(const uint8_t *src, int16_t *dst, int width, int channels);
+        void (*rowGaussV)(const int16_t * const rows[9], uint8_t *dst, int count);
+        void (*rowLbp)(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width);
+    };
+
+    /*
+     * The variant used by the kernels above: the fastest one supported by
+     * the host, or the one named by the GATHERER_CPU_DISPATCH environment
+     * variable (scalar, sse2, sse41, avx2, avx512, neon) if it is supported.
+     */
+    const KernelTable & getKernels();
+
+    /// The scalar reference variant
+    const KernelTable & getScalarKernels();
+
+    /// Variant by name, or nullptr if it was not built or the host lacks the instructions
+    const KernelTable * findKernels(const char *name);
+
+    /// All variants usable on this host, slowest first
+    std::vector<const KernelTable *> getAvailableKernels();
+}
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__Kernels__) */
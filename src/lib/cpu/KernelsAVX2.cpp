@@ -0,0 +1,233 @@
+//
+//  KernelsAVX2.cpp
+//  gatherer
+//
+//  AVX2 kernels, compiled with -mavx2 (see src/lib/CMakeLists.txt).  FMA is
+//  deliberately not enabled so the float math rounds exactly as in the
+//  scalar and SSE2 kernels.
+//
+
+#include "cpu/KernelsImpl.h"
+
+#if GATHERER_CPU_X86_DISPATCH
+
+#include <immintrin.h>
+
+_GATHERER_CPU_BEGIN
+
+namespace kernels
+{
+namespace avx2
+{
+
+// Undo the per 128-bit lane interleaving of hadd/pack: 64-bit chunks 0, 2, 1, 3
+static inline __m256i fixLanes(__m256i v)
+{
+    return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3,1,2,0));
+}
+
+void rowToGray(const uint8_t *src, uint8_t *dst, int width, int channels, const GrayWeights &weights)
+{
+    if(channels != 4)
+    {
+        sse41::rowToGray(src, dst, width, channels, weights);
+        return;
+    }
+
+    const __m256i w = _mm256_setr_epi16(
+        weights.c0, weights.c1, weights.c2, 0, weights.c0, weights.c1, weights.c2, 0,
+        weights.c0, weights.c1, weights.c2, 0, weights.c0, weights.c1, weights.c2, 0);
+    const __m256i half = _mm256_set1_epi32(1 << 13);
+
+    // 8 pixels -> 8 int32 luminance values in order
+    auto gray8 = [&](const uint8_t *p)
+    {
+        const __m256i lo = _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))), w);
+        const __m256i hi = _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16))), w);
+        return fixLanes(_mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(lo, hi), half), 14));
+    };
+
+    int x = 0;
+    for(; x + 32 <= width; x += 32)
+    {
+        const uint8_t *p = src + x * 4;
+        const __m256i g0 = fixLanes(_mm256_packs_epi32(gray8(p + 0), gray8(p + 32)));
+        const __m256i g1 = fixLanes(_mm256_packs_epi32(gray8(p + 64), gray8(p + 96)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), fixLanes(_mm256_packus_epi16(g0, g1)));
+    }
+    sse2::rowToGray(src + x * 4, dst + x, width - x, channels, weights);
+}
+
+static inline __m256 selectPs(__m256 mask, __m256 a, __m256 b)
+{
+    return _mm256_or_ps(_mm256_and_ps(mask, a), _mm256_andnot_ps(mask, b));
+}
+
+static inline __m256 atan2Approx(__m256 y, __m256 x)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 ax = _mm256_andnot_ps(signMask, x), ay = _mm256_andnot_ps(signMask, y);
+    const __m256 a = _mm256_div_ps(_mm256_min_ps(ax, ay), _mm256_add_ps(_mm256_max_ps(ax, ay), _mm256_set1_ps(1e-10f)));
+    const __m256 s = _mm256_mul_ps(a, a);
+    __m256 r = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-0.0464964749f), s), _mm256_set1_ps(0.15931422f));
+    r = _mm256_sub_ps(_mm256_mul_ps(r, s), _mm256_set1_ps(0.327622764f));
+    r = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(r, s), a), a);
+    r = selectPs(_mm256_cmp_ps(ay, ax, _CMP_GT_OQ), _mm256_sub_ps(_mm256_set1_ps(kPi * 0.5f), r), r);
+    r = selectPs(_mm256_cmp_ps(x, zero, _CMP_LT_OQ), _mm256_sub_ps(_mm256_set1_ps(kPi), r), r);
+    return selectPs(_mm256_cmp_ps(y, zero, _CMP_LT_OQ), _mm256_sub_ps(zero, r), r);
+}
+
+static inline __m256i toUnorm8(__m256 v)
+{
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.f));
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(255.f)), _mm256_set1_ps(0.5f)));
+}
+
+// Pack 8 pixels of int32 dx, dy
+static inline void packGradient(__m256i dx, __m256i dy, __m256 scale, uint8_t *dst)
+{
+    const __m256 fx = _mm256_cvtepi32_ps(dx), fy = _mm256_cvtepi32_ps(dy);
+    const __m256 sx = _mm256_mul_ps(fx, scale), sy = _mm256_mul_ps(fy, scale);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i r = toUnorm8(_mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(sx, sx), _mm256_mul_ps(sy, sy))));
+    const __m256i g = toUnorm8(_mm256_mul_ps(_mm256_add_ps(atan2Approx(fy, fx), _mm256_set1_ps(kPi)), _mm256_set1_ps(0.5f / kPi)));
+    const __m256i b = toUnorm8(_mm256_add_ps(_mm256_mul_ps(sx, half), half));
+    const __m256i a = toUnorm8(_mm256_add_ps(_mm256_mul_ps(sy, half), half));
+    const __m256i rgba = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_slli_epi32(a, 24)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), rgba);
+}
+
+static inline __m256i load16(const uint8_t *p)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+void rowGradient(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, float strength)
+{
+    const float scale = strength / 255.f;
+    const __m256 s = _mm256_set1_ps(scale);
+
+    // The vector body needs x - 1 and x + 16 in range
+    int x = 0;
+    if(width > 0)
+    {
+        gradientAt(r0, r1, r2, x++, width, scale, dst);
+    }
+    for(; x + 17 <= width; x += 16)
+    {
+        const __m256i tl = load16(r0 + x - 1), t = load16(r0 + x), tr = load16(r0 + x + 1);
+        const __m256i l = load16(r1 + x - 1), r = load16(r1 + x + 1);
+        const __m256i bl = load16(r2 + x - 1), b = load16(r2 + x), br = load16(r2 + x + 1);
+
+        const __m256i dx = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(tr, br), _mm256_slli_epi16(r, 1)), _mm256_add_epi16(_mm256_add_epi16(tl, bl), _mm256_slli_epi16(l, 1)));
+        const __m256i dy = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(bl, br), _mm256_slli_epi16(b, 1)), _mm256_add_epi16(_mm256_add_epi16(tl, tr), _mm256_slli_epi16(t, 1)));
+
+        packGradient(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(dx)), _mm256_cvtepi16_epi32(_mm256_castsi256_si128(dy)), s, dst + x * 4);
+        packGradient(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(dx, 1)), _mm256_cvtepi16_epi32(_mm256_extracti128_si256(dy, 1)), s, dst + x * 4 + 32);
+    }
+    for(; x < width; x++)
+    {
+        gradientAt(r0, r1, r2, x, width, scale, dst + x * 4);
+    }
+}
+
+void rowGaussH(const uint8_t *src, int16_t *dst, int width, int channels)
+{
+    const int n = width * channels;
+    const int c1 = channels, c2 = channels * 2, c3 = channels * 3, c4 = channels * 4;
+
+    const __m256i w0 = _mm256_set1_epi16(kGauss0), w1 = _mm256_set1_epi16(kGauss1);
+    const __m256i w2 = _mm256_set1_epi16(kGauss2), w3 = _mm256_set1_epi16(kGauss3), w4 = _mm256_set1_epi16(kGauss4);
+    const __m256i two = _mm256_set1_epi16(2);
+
+    int i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        const uint8_t *p = src + i;
+        __m256i s = _mm256_mullo_epi16(load16(p), w0);
+        s = _mm256_add_epi16(s, _mm256_mullo_epi16(_mm256_add_epi16(load16(p - c1), load16(p + c1)), w1));
+        s = _mm256_add_epi16(s, _mm256_mullo_epi16(_mm256_add_epi16(load16(p - c2), load16(p + c2)), w2));
+        s = _mm256_add_epi16(s, _mm256_mullo_epi16(_mm256_add_epi16(load16(p - c3), load16(p + c3)), w3));
+        s = _mm256_add_epi16(s, _mm256_mullo_epi16(_mm256_add_epi16(load16(p - c4), load16(p + c4)), w4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_srli_epi16(_mm256_add_epi16(s, two), 2));
+    }
+    for(; i < n; i++)
+    {
+        dst[i] = gaussHAt(src + i, channels);
+    }
+}
+
+void rowGaussV(const int16_t * const rows[9], uint8_t *dst, int count)
+{
+    const __m256i w01 = _mm256_set1_epi32((int(kGauss1) << 16) | kGauss0);
+    const __m256i w23 = _mm256_set1_epi32((int(kGauss3) << 16) | kGauss2);
+    const __m256i w40 = _mm256_set1_epi32(kGauss4);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i half = _mm256_set1_epi32(1 << 13);
+
+    int i = 0;
+    auto load = [&](int k) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[k] + i)); };
+
+    for(; i + 16 <= count; i += 16)
+    {
+        const __m256i s0 = load(4);
+        const __m256i s1 = _mm256_add_epi16(load(3), load(5));
+        const __m256i s2 = _mm256_add_epi16(load(2), load(6));
+        const __m256i s3 = _mm256_add_epi16(load(1), load(7));
+        const __m256i s4 = _mm256_add_epi16(load(0), load(8));
+
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(s0, s1), w01);
+        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(s2, s3), w23));
+        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(s4, zero), w40));
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(s0, s1), w01);
+        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(s2, s3), w23));
+        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(s4, zero), w40));
+
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, half), 14);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, half), 14);
+        const __m256i packed = _mm256_packs_epi32(lo, hi); // unpack and pack cancel out per lane
+        const __m256i bytes = fixLanes(_mm256_packus_epi16(packed, packed));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm256_castsi256_si128(bytes));
+    }
+    for(; i < count; i++)
+    {
+        dst[i] = gaussVAt(rows, i);
+    }
+}
+
+void rowLbp(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width)
+{
+    // n >= c  <=>  max(n, c) == n for unsigned bytes
+    auto bit = [](const uint8_t *p, __m256i c, int shift)
+    {
+        const __m256i n = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        return _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(n, c), n), _mm256_set1_epi8(char(1 << shift)));
+    };
+
+    int x = 0;
+    if(width > 0)
+    {
+        dst[0] = lbpAt(r0, r1, r2, x++, width);
+    }
+    for(; x + 32 < width; x += 32)
+    {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(r1 + x));
+        __m256i code = _mm256_or_si256(bit(r0 + x + 1, c, 0), bit(r1 + x + 1, c, 1));
+        code = _mm256_or_si256(code, _mm256_or_si256(bit(r2 + x + 1, c, 2), bit(r2 + x, c, 3)));
+        code = _mm256_or_si256(code, _mm256_or_si256(bit(r2 + x - 1, c, 4), bit(r1 + x - 1, c, 5)));
+        code = _mm256_or_si256(code, _mm256_or_si256(bit(r0 + x - 1, c, 6), bit(r0 + x, c, 7)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), code);
+    }
+    for(; x < width; x++)
+    {
+        dst[x] = lbpAt(r0, r1, r2, x, width);
+    }
+}
+
+} // namespace avx2
+} // namespace kernels
+
+_GATHERER_CPU_END
+
+#endif // GATHERER_CPU_X86_DISPATCH
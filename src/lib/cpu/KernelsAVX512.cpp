@@ -0,0 +1,87 @@
+//
+//  KernelsAVX512.cpp
+//  gatherer
+//
+//  AVX-512 (F + BW) kernels, compiled with -mavx512f -mavx512bw (see
+//  src/lib/CMakeLists.txt).  Only the byte-parallel kernels gain from the
+//  wider registers; everything else stays on the avx2 variants.
+//
+
+#include "cpu/KernelsImpl.h"
+
+#if GATHERER_CPU_X86_DISPATCH
+
+#include <immintrin.h>
+
+_GATHERER_CPU_BEGIN
+
+namespace kernels
+{
+namespace avx512
+{
+
+static inline __m512i load32(const uint8_t *p)
+{
+    return _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+}
+
+void rowGaussH(const uint8_t *src, int16_t *dst, int width, int channels)
+{
+    const int n = width * channels;
+    const int c1 = channels, c2 = channels * 2, c3 = channels * 3, c4 = channels * 4;
+
+    const __m512i w0 = _mm512_set1_epi16(kGauss0), w1 = _mm512_set1_epi16(kGauss1);
+    const __m512i w2 = _mm512_set1_epi16(kGauss2), w3 = _mm512_set1_epi16(kGauss3), w4 = _mm512_set1_epi16(kGauss4);
+    const __m512i two = _mm512_set1_epi16(2);
+
+    int i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        const uint8_t *p = src + i;
+        __m512i s = _mm512_mullo_epi16(load32(p), w0);
+        s = _mm512_add_epi16(s, _mm512_mullo_epi16(_mm512_add_epi16(load32(p - c1), load32(p + c1)), w1));
+        s = _mm512_add_epi16(s, _mm512_mullo_epi16(_mm512_add_epi16(load32(p - c2), load32(p + c2)), w2));
+        s = _mm512_add_epi16(s, _mm512_mullo_epi16(_mm512_add_epi16(load32(p - c3), load32(p + c3)), w3));
+        s = _mm512_add_epi16(s, _mm512_mullo_epi16(_mm512_add_epi16(load32(p - c4), load32(p + c4)), w4));
+        _mm512_storeu_si512(dst + i, _mm512_srli_epi16(_mm512_add_epi16(s, two), 2));
+    }
+    for(; i < n; i++)
+    {
+        dst[i] = gaussHAt(src + i, channels);
+    }
+}
+
+void rowLbp(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width)
+{
+    auto bit = [](const uint8_t *p, __m512i c, int shift)
+    {
+        const __mmask64 ge = _mm512_cmpge_epu8_mask(_mm512_loadu_si512(p), c);
+        return _mm512_maskz_mov_epi8(ge, _mm512_set1_epi8(char(1 << shift)));
+    };
+
+    int x = 0;
+    if(width > 0)
+    {
+        dst[0] = lbpAt(r0, r1, r2, x++, width);
+    }
+    for(; x + 64 < width; x += 64)
+    {
+        const __m512i c = _mm512_loadu_si512(r1 + x);
+        __m512i code = _mm512_or_si512(bit(r0 + x + 1, c, 0), bit(r1 + x + 1, c, 1));
+        code = _mm512_or_si512(code, _mm512_or_si512(bit(r2 + x + 1, c, 2), bit(r2 + x, c, 3)));
+        code = _mm512_or_si512(code, _mm512_or_si512(bit(r2 + x - 1, c, 4), bit(r1 + x - 1, c, 5)));
+        code = _mm512_or_si512(code, _mm512_or_si512(bit(r0 + x - 1, c, 6), bit(r0 + x, c, 7)));
+        _mm512_storeu_si512(dst + x, code);
+    }
+    for(; x < width; x++)
+    {
+        dst[x] = lbpAt(r0, r1, r2, x, width);
+    }
+}
+
+} // namespace avx512
+} // namespace kernels
+
+_GATHERER_CPU_END
+
+#endif // GATHERER_CPU_X86_DISPATCH
@@ -0,0 +1,183 @@
+//
+//  KernelsImpl.h
+//  gatherer
+//
+//  Private to the kernel translation units.  Each instruction set variant
+//  lives in its own file compiled with its own target flags, so everything
+//  shared here must have internal linkage: an out-of-line copy of an inline
+//  function (or std::min/std::max instantiation) emitted from an AVX2 file
+//  could otherwise be picked by the linker and executed on any CPU.
+//
+
+#ifndef __gatherer__cpu__KernelsImpl__
+#define __gatherer__cpu__KernelsImpl__
+
+#include "cpu/Kernels.h"
+
+#include <cmath>
+
+_GATHERER_CPU_BEGIN
+
+namespace kernels
+{
+
+// ITU-R BT.601 weights, as used by the GrayscaleProc shader (0.299, 0.587, 0.114)
+static const int16_t kWeightR = 4899;
+static const int16_t kWeightG = 9617;
+static const int16_t kWeightB = 1868;
+
+// Q8 taps of the 9 tap gaussian: 924, 792, 495, 220, 66 / 4070
+static const int16_t kGauss0 = 58;
+static const int16_t kGauss1 = 50;
+static const int16_t kGauss2 = 31;
+static const int16_t kGauss3 = 14;
+static const int16_t kGauss4 = 4;
+
+static const float kPi = 3.14159265358979f;
+
+static inline int mini(int a, int b) { return a < b ? a : b; }
+static inline int maxi(int a, int b) { return a > b ? a : b; }
+static inline float minf(float a, float b) { return a < b ? a : b; }
+static inline float maxf(float a, float b) { return a > b ? a : b; }
+
+// ########### Per pixel reference implementations (used for borders and tails) ###########
+
+static inline uint8_t grayAt(const uint8_t *p, const GrayWeights &weights)
+{
+    return uint8_t((p[0] * weights.c0 + p[1] * weights.c1 + p[2] * weights.c2 + (1 << 13)) >> 14);
+}
+
+// Branch free atan2 approximation (max error ~1e-5 rad), written so that the
+// vector versions perform the identical sequence of IEEE operations.
+static inline float atan2Approx(float y, float x)
+{
+    const float ax = std::abs(x), ay = std::abs(y);
+    const float a = minf(ax, ay) / (maxf(ax, ay) + 1e-10f);
+    const float s = a * a;
+    float r = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+    r = (ay > ax) ? (kPi * 0.5f - r) : r;
+    r = (x < 0.f) ? (kPi - r) : r;
+    return (y < 0.f) ? -r : r;
+}
+
+static inline uint8_t toUnorm8(float v)
+{
+    return uint8_t(int(minf(maxf(v, 0.f), 1.f) * 255.f + 0.5f));
+}
+
+static inline void packGradient(int dx, int dy, float scale, uint8_t *dst)
+{
+    const float sx = float(dx) * scale;
+    const float sy = float(dy) * scale;
+    dst[0] = toUnorm8(std::sqrt(sx * sx + sy * sy));
+    dst[1] = toUnorm8((atan2Approx(float(dy), float(dx)) + kPi) * (0.5f / kPi));
+    dst[2] = toUnorm8(sx * 0.5f + 0.5f);
+    dst[3] = toUnorm8(sy * 0.5f + 0.5f);
+}
+
+static inline void gradientAt(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, int x, int width, float scale, uint8_t *dst)
+{
+    const int l = maxi(x - 1, 0);
+    const int r = mini(x + 1, width - 1);
+    const int dx = (r0[r] + 2 * r1[r] + r2[r]) - (r0[l] + 2 * r1[l] + r2[l]);
+    const int dy = (r2[l] + 2 * r2[x] + r2[r]) - (r0[l] + 2 * r0[x] + r0[r]);
+    packGradient(dx, dy, scale, dst);
+}
+
+static inline int16_t gaussHAt(const uint8_t *p, int c1)
+{
+    const int c2 = c1 * 2, c3 = c1 * 3, c4 = c1 * 4;
+    const int s = kGauss0 * p[0]
+        + kGauss1 * (p[-c1] + p[c1])
+        + kGauss2 * (p[-c2] + p[c2])
+        + kGauss3 * (p[-c3] + p[c3])
+        + kGauss4 * (p[-c4] + p[c4]);
+    return int16_t((s + 2) >> 2);
+}
+
+static inline uint8_t gaussVAt(const int16_t * const rows[9], int i)
+{
+    const int s = kGauss0 * rows[4][i]
+        + kGauss1 * (rows[3][i] + rows[5][i])
+        + kGauss2 * (rows[2][i] + rows[6][i])
+        + kGauss3 * (rows[1][i] + rows[7][i])
+        + kGauss4 * (rows[0][i] + rows[8][i]);
+    return uint8_t(mini((s + (1 << 13)) >> 14, 255));
+}
+
+static inline uint8_t lbpAt(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, int x, int width)
+{
+    const int xl = maxi(x - 1, 0), xr = mini(x + 1, width - 1);
+    const uint8_t c = r1[x];
+    return uint8_t(
+        ((r0[xr] >= c) << 0) | ((r1[xr] >= c) << 1) | ((r2[xr] >= c) << 2) | ((r2[x] >= c) << 3) |
+        ((r2[xl] >= c) << 4) | ((r1[xl] >= c) << 5) | ((r0[xl] >= c) << 6) | ((r0[x] >= c) << 7));
+}
+
+// ########### Variants ###########
+
+// Signatures of the KernelTable entries
+#define GATHERER_CPU_ROW_TO_GRAY void rowToGray(const uint8_t *src, uint8_t *dst, int width, int channels, const GrayWeights &weights)
+#define GATHERER_CPU_ROW_GRADIENT void rowGradient(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, float strength)
+#define GATHERER_CPU_ROW_GAUSS_H void rowGaussH(const uint8_t *src, int16_t *dst, int width, int channels)
+#define GATHERER_CPU_ROW_GAUSS_V void rowGaussV(const int16_t * const rows[9], uint8_t *dst, int count)
+#define GATHERER_CPU_ROW_LBP void rowLbp(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width)
+
+namespace scalar
+{
+    GATHERER_CPU_ROW_TO_GRAY;
+    GATHERER_CPU_ROW_GRADIENT;
+    GATHERER_CPU_ROW_GAUSS_H;
+    GATHERER_CPU_ROW_GAUSS_V;
+    GATHERER_CPU_ROW_LBP;
+}
+
+#if GATHERER_CPU_SSE2
+namespace sse2
+{
+    GATHERER_CPU_ROW_TO_GRAY;
+    GATHERER_CPU_ROW_GRADIENT;
+    GATHERER_CPU_ROW_GAUSS_H;
+    GATHERER_CPU_ROW_GAUSS_V;
+    GATHERER_CPU_ROW_LBP;
+}
+#endif
+
+#if GATHERER_CPU_X86_DISPATCH
+namespace sse41
+{
+    GATHERER_CPU_ROW_TO_GRAY;
+}
+
+namespace avx2
+{
+    GATHERER_CPU_ROW_TO_GRAY;
+    GATHERER_CPU_ROW_GRADIENT;
+    GATHERER_CPU_ROW_GAUSS_H;
+    GATHERER_CPU_ROW_GAUSS_V;
+    GATHERER_CPU_ROW_LBP;
+}
+
+namespace avx512
+{
+    GATHERER_CPU_ROW_GAUSS_H;
+    GATHERER_CPU_ROW_LBP;
+}
+#endif
+
+#if GATHERER_CPU_NEON
+namespace neon
+{
+    GATHERER_CPU_ROW_TO_GRAY;
+    GATHERER_CPU_ROW_GRADIENT;
+    GATHERER_CPU_ROW_GAUSS_H;
+    GATHERER_CPU_ROW_GAUSS_V;
+    GATHERER_CPU_ROW_LBP;
+}
+#endif
+
+}
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__KernelsImpl__) */
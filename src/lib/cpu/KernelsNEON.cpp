@@ -0,0 +1,186 @@
+//
+//  KernelsNEON.cpp
+//  gatherer
+//
+//  NEON kernels (ARMv7 with -mfpu=neon, always available on AArch64).
+//
+
+#include "cpu/KernelsImpl.h"
+
+#if GATHERER_CPU_NEON
+
+#include <arm_neon.h>
+
+_GATHERER_CPU_BEGIN
+
+namespace kernels
+{
+namespace neon
+{
+
+void rowToGray(const uint8_t *src, uint8_t *dst, int width, int channels, const GrayWeights &weights)
+{
+    if(channels != 3 && channels != 4)
+    {
+        scalar::rowToGray(src, dst, width, channels, weights);
+        return;
+    }
+
+    auto gray8 = [&](uint8x8_t c0, uint8x8_t c1, uint8x8_t c2)
+    {
+        const uint16x8_t v0 = vmovl_u8(c0), v1 = vmovl_u8(c1), v2 = vmovl_u8(c2);
+        uint32x4_t lo = vmull_n_u16(vget_low_u16(v0), weights.c0);
+        lo = vmlal_n_u16(lo, vget_low_u16(v1), weights.c1);
+        lo = vmlal_n_u16(lo, vget_low_u16(v2), weights.c2);
+        uint32x4_t hi = vmull_n_u16(vget_high_u16(v0), weights.c0);
+        hi = vmlal_n_u16(hi, vget_high_u16(v1), weights.c1);
+        hi = vmlal_n_u16(hi, vget_high_u16(v2), weights.c2);
+        return vmovn_u16(vcombine_u16(vrshrn_n_u32(lo, 14), vrshrn_n_u32(hi, 14)));
+    };
+
+    int x = 0;
+    if(channels == 4)
+    {
+        for(; x + 8 <= width; x += 8)
+        {
+            const uint8x8x4_t px = vld4_u8(src + x * 4);
+            vst1_u8(dst + x, gray8(px.val[0], px.val[1], px.val[2]));
+        }
+    }
+    else
+    {
+        for(; x + 8 <= width; x += 8)
+        {
+            const uint8x8x3_t px = vld3_u8(src + x * 3);
+            vst1_u8(dst + x, gray8(px.val[0], px.val[1], px.val[2]));
+        }
+    }
+    for(; x < width; x++)
+    {
+        dst[x] = grayAt(src + x * channels, weights);
+    }
+}
+
+static inline int16x8_t load8(const uint8_t *p)
+{
+    return vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p)));
+}
+
+void rowGradient(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, float strength)
+{
+    const float scale = strength / 255.f;
+
+    // The vector body needs x - 1 and x + 8 in range
+    int x = 0;
+    if(width > 0)
+    {
+        gradientAt(r0, r1, r2, x++, width, scale, dst);
+    }
+    for(; x + 9 <= width; x += 8)
+    {
+        const int16x8_t tl = load8(r0 + x - 1), t = load8(r0 + x), tr = load8(r0 + x + 1);
+        const int16x8_t l = load8(r1 + x - 1), r = load8(r1 + x + 1);
+        const int16x8_t bl = load8(r2 + x - 1), b = load8(r2 + x), br = load8(r2 + x + 1);
+
+        int16_t dx[8], dy[8];
+        vst1q_s16(dx, vsubq_s16(vaddq_s16(vaddq_s16(tr, br), vshlq_n_s16(r, 1)), vaddq_s16(vaddq_s16(tl, bl), vshlq_n_s16(l, 1))));
+        vst1q_s16(dy, vsubq_s16(vaddq_s16(vaddq_s16(bl, br), vshlq_n_s16(b, 1)), vaddq_s16(vaddq_s16(tl, tr), vshlq_n_s16(t, 1))));
+        for(int i = 0; i < 8; i++)
+        {
+            packGradient(dx[i], dy[i], scale, dst + (x + i) * 4);
+        }
+    }
+    for(; x < width; x++)
+    {
+        gradientAt(r0, r1, r2, x, width, scale, dst + x * 4);
+    }
+}
+
+void rowGaussH(const uint8_t *src, int16_t *dst, int width, int channels)
+{
+    const int n = width * channels;
+    const int c1 = channels, c2 = channels * 2, c3 = channels * 3, c4 = channels * 4;
+
+    int i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        const uint8_t *p = src + i;
+        uint16x8_t s = vmull_u8(vld1_u8(p), vdup_n_u8(kGauss0));
+        s = vmlaq_n_u16(s, vaddl_u8(vld1_u8(p - c1), vld1_u8(p + c1)), kGauss1);
+        s = vmlaq_n_u16(s, vaddl_u8(vld1_u8(p - c2), vld1_u8(p + c2)), kGauss2);
+        s = vmlaq_n_u16(s, vaddl_u8(vld1_u8(p - c3), vld1_u8(p + c3)), kGauss3);
+        s = vmlaq_n_u16(s, vaddl_u8(vld1_u8(p - c4), vld1_u8(p + c4)), kGauss4);
+        vst1q_s16(dst + i, vreinterpretq_s16_u16(vshrq_n_u16(vaddq_u16(s, vdupq_n_u16(2)), 2)));
+    }
+    for(; i < n; i++)
+    {
+        dst[i] = gaussHAt(src + i, channels);
+    }
+}
+
+void rowGaussV(const int16_t * const rows[9], uint8_t *dst, int count)
+{
+    int i = 0;
+    auto load = [&](int k) { return vld1q_s16(rows[k] + i); };
+
+    for(; i + 8 <= count; i += 8)
+    {
+        const int16x8_t s0 = load(4);
+        const int16x8_t s1 = vaddq_s16(load(3), load(5));
+        const int16x8_t s2 = vaddq_s16(load(2), load(6));
+        const int16x8_t s3 = vaddq_s16(load(1), load(7));
+        const int16x8_t s4 = vaddq_s16(load(0), load(8));
+
+        int32x4_t lo = vmull_n_s16(vget_low_s16(s0), kGauss0);
+        lo = vmlal_n_s16(lo, vget_low_s16(s1), kGauss1);
+        lo = vmlal_n_s16(lo, vget_low_s16(s2), kGauss2);
+        lo = vmlal_n_s16(lo, vget_low_s16(s3), kGauss3);
+        lo = vmlal_n_s16(lo, vget_low_s16(s4), kGauss4);
+        int32x4_t hi = vmull_n_s16(vget_high_s16(s0), kGauss0);
+        hi = vmlal_n_s16(hi, vget_high_s16(s1), kGauss1);
+        hi = vmlal_n_s16(hi, vget_high_s16(s2), kGauss2);
+        hi = vmlal_n_s16(hi, vget_high_s16(s3), kGauss3);
+        hi = vmlal_n_s16(hi, vget_high_s16(s4), kGauss4);
+
+        const int16x8_t packed = vcombine_s16(vrshrn_n_s32(lo, 14), vrshrn_n_s32(hi, 14));
+        vst1_u8(dst + i, vqmovun_s16(packed));
+    }
+    for(; i < count; i++)
+    {
+        dst[i] = gaussVAt(rows, i);
+    }
+}
+
+void rowLbp(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width)
+{
+    auto bit = [](const uint8_t *p, uint8x16_t c, int shift)
+    {
+        return vandq_u8(vcgeq_u8(vld1q_u8(p), c), vdupq_n_u8(uint8_t(1 << shift)));
+    };
+
+    int x = 0;
+    if(width > 0)
+    {
+        dst[0] = lbpAt(r0, r1, r2, x++, width);
+    }
+    for(; x + 16 < width; x += 16)
+    {
+        const uint8x16_t c = vld1q_u8(r1 + x);
+        uint8x16_t code = vorrq_u8(bit(r0 + x + 1, c, 0), bit(r1 + x + 1, c, 1));
+        code = vorrq_u8(code, vorrq_u8(bit(r2 + x + 1, c, 2), bit(r2 + x, c, 3)));
+        code = vorrq_u8(code, vorrq_u8(bit(r2 + x - 1, c, 4), bit(r1 + x - 1, c, 5)));
+        code = vorrq_u8(code, vorrq_u8(bit(r0 + x - 1, c, 6), bit(r0 + x, c, 7)));
+        vst1q_u8(dst + x, code);
+    }
+    for(; x < width; x++)
+    {
+        dst[x] = lbpAt(r0, r1, r2, x, width);
+    }
+}
+
+} // namespace neon
+} // namespace kernels
+
+_GATHERER_CPU_END
+
+#endif // GATHERER_CPU_NEON
@@ -0,0 +1,230 @@
+//
+//  KernelsSSE2.cpp
+//  gatherer
+//
+//  SSE2 kernels (baseline on x86-64, no extra compiler flags).
+//
+
+#include "cpu/KernelsImpl.h"
+
+#if GATHERER_CPU_SSE2
+
+#include <emmintrin.h>
+
+_GATHERER_CPU_BEGIN
+
+namespace kernels
+{
+namespace sse2
+{
+
+void rowToGray(const uint8_t *src, uint8_t *dst, int width, int channels, const GrayWeights &weights)
+{
+    if(channels != 4)
+    {
+        scalar::rowToGray(src, dst, width, channels, weights);
+        return;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w = _mm_setr_epi16(weights.c0, weights.c1, weights.c2, 0, weights.c0, weights.c1, weights.c2, 0);
+    const __m128i half = _mm_set1_epi32(1 << 13);
+
+    auto gray4 = [&](const uint8_t *p)
+    {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128 lo = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(px, zero), w));
+        const __m128 hi = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(px, zero), w));
+        const __m128i even = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2,0,2,0)));
+        const __m128i odd = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3,1,3,1)));
+        return _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), half), 14);
+    };
+
+    int x = 0;
+    for(; x + 16 <= width; x += 16)
+    {
+        const uint8_t *p = src + x * 4;
+        const __m128i g0 = _mm_packs_epi32(gray4(p + 0), gray4(p + 16));
+        const __m128i g1 = _mm_packs_epi32(gray4(p + 32), gray4(p + 48));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(g0, g1));
+    }
+    for(; x < width; x++)
+    {
+        dst[x] = grayAt(src + x * 4, weights);
+    }
+}
+
+static inline __m128 selectPs(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 atan2Approx(__m128 y, __m128 x)
+{
+    const __m128 signMask = _mm_set1_ps(-0.f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 ax = _mm_andnot_ps(signMask, x), ay = _mm_andnot_ps(signMask, y);
+    const __m128 a = _mm_div_ps(_mm_min_ps(ax, ay), _mm_add_ps(_mm_max_ps(ax, ay), _mm_set1_ps(1e-10f)));
+    const __m128 s = _mm_mul_ps(a, a);
+    __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.0464964749f), s), _mm_set1_ps(0.15931422f));
+    r = _mm_sub_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.327622764f));
+    r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, s), a), a);
+    r = selectPs(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(kPi * 0.5f), r), r);
+    r = selectPs(_mm_cmplt_ps(x, zero), _mm_sub_ps(_mm_set1_ps(kPi), r), r);
+    return selectPs(_mm_cmplt_ps(y, zero), _mm_sub_ps(zero, r), r);
+}
+
+static inline __m128i toUnorm8(__m128 v)
+{
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f)));
+}
+
+// Pack 4 pixels of int32 dx, dy
+static inline void packGradient(__m128i dx, __m128i dy, __m128 scale, uint8_t *dst)
+{
+    const __m128 fx = _mm_cvtepi32_ps(dx), fy = _mm_cvtepi32_ps(dy);
+    const __m128 sx = _mm_mul_ps(fx, scale), sy = _mm_mul_ps(fy, scale);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i r = toUnorm8(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sy, sy))));
+    const __m128i g = toUnorm8(_mm_mul_ps(_mm_add_ps(atan2Approx(fy, fx), _mm_set1_ps(kPi)), _mm_set1_ps(0.5f / kPi)));
+    const __m128i b = toUnorm8(_mm_add_ps(_mm_mul_ps(sx, half), half));
+    const __m128i a = toUnorm8(_mm_add_ps(_mm_mul_ps(sy, half), half));
+    const __m128i rgba = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), rgba);
+}
+
+static inline __m128i load8(const uint8_t *p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)), _mm_setzero_si128());
+}
+
+void rowGradient(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, float strength)
+{
+    const float scale = strength / 255.f;
+    const __m128 s = _mm_set1_ps(scale);
+
+    // The vector body needs x - 1 and x + 8 in range
+    int x = 0;
+    if(width > 0)
+    {
+        gradientAt(r0, r1, r2, x++, width, scale, dst);
+    }
+    for(; x + 9 <= width; x += 8)
+    {
+        const __m128i tl = load8(r0 + x - 1), t = load8(r0 + x), tr = load8(r0 + x + 1);
+        const __m128i l = load8(r1 + x - 1), r = load8(r1 + x + 1);
+        const __m128i bl = load8(r2 + x - 1), b = load8(r2 + x), br = load8(r2 + x + 1);
+
+        const __m128i dx = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(tr, br), _mm_slli_epi16(r, 1)), _mm_add_epi16(_mm_add_epi16(tl, bl), _mm_slli_epi16(l, 1)));
+        const __m128i dy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(bl, br), _mm_slli_epi16(b, 1)), _mm_add_epi16(_mm_add_epi16(tl, tr), _mm_slli_epi16(t, 1)));
+
+        packGradient(_mm_srai_epi32(_mm_unpacklo_epi16(dx, dx), 16), _mm_srai_epi32(_mm_unpacklo_epi16(dy, dy), 16), s, dst + x * 4);
+        packGradient(_mm_srai_epi32(_mm_unpackhi_epi16(dx, dx), 16), _mm_srai_epi32(_mm_unpackhi_epi16(dy, dy), 16), s, dst + x * 4 + 16);
+    }
+    for(; x < width; x++)
+    {
+        gradientAt(r0, r1, r2, x, width, scale, dst + x * 4);
+    }
+}
+
+void rowGaussH(const uint8_t *src, int16_t *dst, int width, int channels)
+{
+    const int n = width * channels;
+    const int c1 = channels, c2 = channels * 2, c3 = channels * 3, c4 = channels * 4;
+
+    const __m128i w0 = _mm_set1_epi16(kGauss0), w1 = _mm_set1_epi16(kGauss1);
+    const __m128i w2 = _mm_set1_epi16(kGauss2), w3 = _mm_set1_epi16(kGauss3), w4 = _mm_set1_epi16(kGauss4);
+    const __m128i two = _mm_set1_epi16(2);
+
+    int i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        const uint8_t *p = src + i;
+        // Sums stay below 2^16: wraparound in epi16 is harmless with the logical shift
+        __m128i s = _mm_mullo_epi16(load8(p), w0);
+        s = _mm_add_epi16(s, _mm_mullo_epi16(_mm_add_epi16(load8(p - c1), load8(p + c1)), w1));
+        s = _mm_add_epi16(s, _mm_mullo_epi16(_mm_add_epi16(load8(p - c2), load8(p + c2)), w2));
+        s = _mm_add_epi16(s, _mm_mullo_epi16(_mm_add_epi16(load8(p - c3), load8(p + c3)), w3));
+        s = _mm_add_epi16(s, _mm_mullo_epi16(_mm_add_epi16(load8(p - c4), load8(p + c4)), w4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_srli_epi16(_mm_add_epi16(s, two), 2));
+    }
+    for(; i < n; i++)
+    {
+        dst[i] = gaussHAt(src + i, channels);
+    }
+}
+
+void rowGaussV(const int16_t * const rows[9], uint8_t *dst, int count)
+{
+    const __m128i w01 = _mm_setr_epi16(kGauss0, kGauss1, kGauss0, kGauss1, kGauss0, kGauss1, kGauss0, kGauss1);
+    const __m128i w23 = _mm_setr_epi16(kGauss2, kGauss3, kGauss2, kGauss3, kGauss2, kGauss3, kGauss2, kGauss3);
+    const __m128i w40 = _mm_setr_epi16(kGauss4, 0, kGauss4, 0, kGauss4, 0, kGauss4, 0);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(1 << 13);
+
+    int i = 0;
+    auto load = [&](int k) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + i)); };
+
+    for(; i + 8 <= count; i += 8)
+    {
+        // Symmetric pairs of Q6 values stay below 2^15
+        const __m128i s0 = load(4);
+        const __m128i s1 = _mm_add_epi16(load(3), load(5));
+        const __m128i s2 = _mm_add_epi16(load(2), load(6));
+        const __m128i s3 = _mm_add_epi16(load(1), load(7));
+        const __m128i s4 = _mm_add_epi16(load(0), load(8));
+
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(s0, s1), w01);
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(s2, s3), w23));
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(s4, zero), w40));
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(s0, s1), w01);
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(s2, s3), w23));
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(s4, zero), w40));
+
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, half), 14);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, half), 14);
+        const __m128i packed = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(packed, packed));
+    }
+    for(; i < count; i++)
+    {
+        dst[i] = gaussVAt(rows, i);
+    }
+}
+
+void rowLbp(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width)
+{
+    // n >= c  <=>  max(n, c) == n for unsigned bytes
+    auto bit = [](const uint8_t *p, __m128i c, int shift)
+    {
+        const __m128i n = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        return _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(n, c), n), _mm_set1_epi8(char(1 << shift)));
+    };
+
+    int x = 0;
+    if(width > 0)
+    {
+        dst[0] = lbpAt(r0, r1, r2, x++, width);
+    }
+    for(; x + 16 < width; x += 16)
+    {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r1 + x));
+        __m128i code = _mm_or_si128(bit(r0 + x + 1, c, 0), bit(r1 + x + 1, c, 1));
+        code = _mm_or_si128(code, _mm_or_si128(bit(r2 + x + 1, c, 2), bit(r2 + x, c, 3)));
+        code = _mm_or_si128(code, _mm_or_si128(bit(r2 + x - 1, c, 4), bit(r1 + x - 1, c, 5)));
+        code = _mm_or_si128(code, _mm_or_si128(bit(r0 + x - 1, c, 6), bit(r0 + x, c, 7)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), code);
+    }
+    for(; x < width; x++)
+    {
+        dst[x] = lbpAt(r0, r1, r2, x, width);
+    }
+}
+
+} // namespace sse2
+} // namespace kernels
+
+_GATHERER_CPU_END
+
+#endif // GATHERER_CPU_SSE2
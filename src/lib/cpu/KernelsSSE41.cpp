@@ -0,0 +1,64 @@
+//
+//  KernelsSSE41.cpp
+//  gatherer
+//
+//  SSSE3/SSE4.1 kernels, compiled with -msse4.1 (see src/lib/CMakeLists.txt).
+//
+
+#include "cpu/KernelsImpl.h"
+
+#if GATHERER_CPU_X86_DISPATCH
+
+#include <smmintrin.h>
+
+_GATHERER_CPU_BEGIN
+
+namespace kernels
+{
+namespace sse41
+{
+
+void rowToGray(const uint8_t *src, uint8_t *dst, int width, int channels, const GrayWeights &weights)
+{
+    if(channels != 3)
+    {
+        // 4 channel input is already as fast as it gets in sse2
+        sse2::rowToGray(src, dst, width, channels, weights);
+        return;
+    }
+
+    // Spread 2 packed 3 byte pixels into (c0, c1, c2, 0) int16 quads
+    const __m128i spread01 = _mm_setr_epi8(0, -1, 1, -1, 2, -1, -1, -1, 3, -1, 4, -1, 5, -1, -1, -1);
+    const __m128i spread23 = _mm_setr_epi8(6, -1, 7, -1, 8, -1, -1, -1, 9, -1, 10, -1, 11, -1, -1, -1);
+    const __m128i w = _mm_setr_epi16(weights.c0, weights.c1, weights.c2, 0, weights.c0, weights.c1, weights.c2, 0);
+    const __m128i half = _mm_set1_epi32(1 << 13);
+
+    auto gray4 = [&](const uint8_t *p)
+    {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i lo = _mm_madd_epi16(_mm_shuffle_epi8(px, spread01), w);
+        const __m128i hi = _mm_madd_epi16(_mm_shuffle_epi8(px, spread23), w);
+        return _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(lo, hi), half), 14);
+    };
+
+    // Each 16 byte load consumes 12 bytes, so keep 4 bytes of slack after the block
+    int x = 0;
+    for(; (x + 16) * 3 + 4 <= width * 3; x += 16)
+    {
+        const uint8_t *p = src + x * 3;
+        const __m128i g0 = _mm_packs_epi32(gray4(p + 0), gray4(p + 12));
+        const __m128i g1 = _mm_packs_epi32(gray4(p + 24), gray4(p + 36));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(g0, g1));
+    }
+    for(; x < width; x++)
+    {
+        dst[x] = grayAt(src + x * 3, weights);
+    }
+}
+
+} // namespace sse41
+} // namespace kernels
+
+_GATHERER_CPU_END
+
+#endif // GATHERER_CPU_X86_DISPATCH
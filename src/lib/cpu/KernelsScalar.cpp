@@ -0,0 +1,69 @@
+//
+//  KernelsScalar.cpp
+//  gatherer
+//
+//  Portable kernels: the reference every SIMD variant must match bit for bit.
+//
+
+#include "cpu/KernelsImpl.h"
+
+#include <cstring>
+
+_GATHERER_CPU_BEGIN
+
+namespace kernels
+{
+namespace scalar
+{
+
+void rowToGray(const uint8_t *src, uint8_t *dst, int width, int channels, const GrayWeights &weights)
+{
+    if(channels == 1)
+    {
+        std::memcpy(dst, src, width);
+        return;
+    }
+    for(int x = 0; x < width; x++)
+    {
+        dst[x] = grayAt(src + x * channels, weights);
+    }
+}
+
+void rowGradient(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width, float strength)
+{
+    const float scale = strength / 255.f;
+    for(int x = 0; x < width; x++)
+    {
+        gradientAt(r0, r1, r2, x, width, scale, dst + x * 4);
+    }
+}
+
+void rowGaussH(const uint8_t *src, int16_t *dst, int width, int channels)
+{
+    const int n = width * channels;
+    for(int i = 0; i < n; i++)
+    {
+        dst[i] = gaussHAt(src + i, channels);
+    }
+}
+
+void rowGaussV(const int16_t * const rows[9], uint8_t *dst, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        dst[i] = gaussVAt(rows, i);
+    }
+}
+
+void rowLbp(const uint8_t *r0, const uint8_t *r1, const uint8_t *r2, uint8_t *dst, int width)
+{
+    for(int x = 0; x < width; x++)
+    {
+        dst[x] = lbpAt(r0, r1, r2, x, width);
+    }
+}
+
+} // namespace scalar
+} // namespace kernels
+
+_GATHERER_CPU_END
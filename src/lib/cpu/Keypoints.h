@@ -0,0 +1,65 @@
+//
+//  Keypoints.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__Keypoints__
+#define __gatherer__cpu__Keypoints__
+
+#include "cpu/gatherer_cpu.h"
+
+#include <cstddef>
+#include <vector>
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \struct Keypoints
+ *
+ * \brief Structure-of-arrays keypoint list
+ *
+ * Coordinates are in pixels of the detection image; score is the normalized
+ * [0,1] corner response.  Points are stored in row-major (raster) order.
+ */
+
+struct Keypoints
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> score;
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    void clear()
+    {
+        x.clear();
+        y.clear();
+        score.clear();
+    }
+
+    void reserve(size_t n)
+    {
+        x.reserve(n);
+        y.reserve(n);
+        score.reserve(n);
+    }
+
+    void push_back(float px, float py, float s)
+    {
+        x.push_back(px);
+        y.push_back(py);
+        score.push_back(s);
+    }
+
+    void append(const Keypoints &other)
+    {
+        x.insert(x.end(), other.x.begin(), other.x.end());
+        y.insert(y.end(), other.y.begin(), other.y.end());
+        score.insert(score.end(), other.score.begin(), other.score.end());
+    }
+};
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__Keypoints__) */
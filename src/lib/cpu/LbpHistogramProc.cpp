@@ -0,0 +1,80 @@
+//
+//  LbpHistogramProc.cpp
+//  gatherer
+//
+
+#include "cpu/LbpHistogramProc.h"
+#include "cpu/Kernels.h"
+#include "cpu/Parallel.h"
+
+#include <algorithm>
+#include <vector>
+
+_GATHERER_CPU_BEGIN
+
+void LbpHistogramProc::render(const cv::Mat &input, cv::Mat &output)
+{
+    CV_Assert(input.depth() == CV_8U && m_cellSize > 0);
+
+    const cv::Mat &gray = getLuminance(input);
+    const int rows = gray.rows;
+    const int cellSize = m_cellSize;
+    const int bins = m_uniform ? int(kernels::kLbpUniformBins) : 256;
+    const uint8_t *table = m_uniform ? kernels::getLbpUniformTable() : nullptr;
+    const bool simd = m_options.simd;
+
+    m_cells = cv::Size(gray.cols / cellSize, gray.rows / cellSize);
+    const int width = m_cells.width * cellSize;
+    const float scale = 1.f / float(cellSize * cellSize);
+
+    output.create(m_cells.area(), bins, CV_32FC1);
+    if(m_cells.area() == 0)
+    {
+        return;
+    }
+
+    // One task per row of cells: codes for a single image row live in a
+    // scratch line and are binned immediately into integer histograms.
+    parallelRows(m_cells.height, m_options.parallel, [&](const cv::Range &range)
+    {
+        std::vector<uint8_t> codes(gray.cols);
+        std::vector<int> counts(m_cells.width * bins);
+
+        for(int cy = range.start; cy < range.end; cy++)
+        {
+            std::fill(counts.begin(), counts.end(), 0);
+            for(int y = cy * cellSize; y < (cy + 1) * cellSize; y++)
+            {
+                const uint8_t *r0 = gray.ptr<uint8_t>(std::max(y - 1, 0));
+                const uint8_t *r1 = gray.ptr<uint8_t>(y);
+                const uint8_t *r2 = gray.ptr<uint8_t>(std::min(y + 1, rows - 1));
+                kernels::rowLbp(r0, r1, r2, codes.data(), gray.cols, simd);
+                if(table)
+                {
+                    kernels::rowLookup(codes.data(), codes.data(), width, table);
+                }
+
+                int *hist = counts.data();
+                for(int x = 0; x < width; x += cellSize, hist += bins)
+                {
+                    for(int i = x; i < x + cellSize; i++)
+                    {
+                        hist[codes[i]]++;
+                    }
+                }
+            }
+
+            for(int cx = 0; cx < m_cells.width; cx++)
+            {
+                const int *hist = counts.data() + cx * bins;
+                float *dst = output.ptr<float>(cy * m_cells.width + cx);
+                for(int i = 0; i < bins; i++)
+                {
+                    dst[i] = float(hist[i]) * scale;
+                }
+            }
+        }
+    }, 1);
+}
+
+_GATHERER_CPU_END
@@ -0,0 +1,53 @@
+//
+//  LbpHistogramProc.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__LbpHistogramProc__
+#define __gatherer__cpu__LbpHistogramProc__
+
+#include "cpu/gatherer_cpu.h"
+#include "cpu/ProcBase.h"
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \class LbpHistogramProc
+ *
+ * \brief Histogram of LBP codes over a grid of cells
+ *
+ * LBP codes are computed a row at a time and binned straight into the
+ * histograms of the current row of cells, so the code image is never
+ * stored.  The result is a CV_32FC1 matrix with one row per cell (raster
+ * order) and 256 columns, or 59 with setUniform(true).  Each histogram is
+ * L1 normalized.  Pixels in partial cells on the right and bottom edges are
+ * ignored.
+ */
+
+class LbpHistogramProc : public ProcBase
+{
+public:
+
+    virtual const char *getProcName() const { return "LbpHistogramProc"; }
+
+    void setCellSize(int cellSize) { m_cellSize = cellSize; }
+    int getCellSize() const { return m_cellSize; }
+
+    void setUniform(bool uniform) { m_uniform = uniform; }
+    bool getUniform() const { return m_uniform; }
+
+    /// Grid of cells in the last result
+    cv::Size getCells() const { return m_cells; }
+
+protected:
+
+    virtual void render(const cv::Mat &input, cv::Mat &output);
+
+    int m_cellSize = 16;
+    bool m_uniform = true;
+    cv::Size m_cells;
+};
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__LbpHistogramProc__) */
@@ -0,0 +1,41 @@
+//
+//  LbpProc.cpp
+//  gatherer
+//
+
+#include "cpu/LbpProc.h"
+#include "cpu/Kernels.h"
+#include "cpu/Parallel.h"
+
+#include <algorithm>
+
+_GATHERER_CPU_BEGIN
+
+void LbpProc::render(const cv::Mat &input, cv::Mat &output)
+{
+    CV_Assert(input.depth() == CV_8U);
+
+    const cv::Mat &gray = getLuminance(input);
+    const int rows = gray.rows;
+    const uint8_t *table = m_uniform ? kernels::getLbpUniformTable() : nullptr;
+    const bool simd = m_options.simd;
+
+    output.create(gray.size(), CV_8UC1);
+    parallelRows(rows, m_options.parallel, [&](const cv::Range &range)
+    {
+        for(int y = range.start; y < range.end; y++)
+        {
+            const uint8_t *r0 = gray.ptr<uint8_t>(std::max(y - 1, 0));
+            const uint8_t *r1 = gray.ptr<uint8_t>(y);
+            const uint8_t *r2 = gray.ptr<uint8_t>(std::min(y + 1, rows - 1));
+            uint8_t *dst = output.ptr<uint8_t>(y);
+            kernels::rowLbp(r0, r1, r2, dst, gray.cols, simd);
+            if(table)
+            {
+                kernels::rowLookup(dst, dst, gray.cols, table);
+            }
+        }
+    });
+}
+
+_GATHERER_CPU_END
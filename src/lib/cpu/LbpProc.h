@@ -0,0 +1,43 @@
+//
+//  LbpProc.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__LbpProc__
+#define __gatherer__cpu__LbpProc__
+
+#include "cpu/gatherer_cpu.h"
+#include "cpu/ProcBase.h"
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \class LbpProc
+ *
+ * \brief CPU equivalent of ogles_gpgpu::LbpProc
+ *
+ * 8 neighbour local binary pattern of channel 0 of the input, written as a
+ * full size CV_8UC1 image with the same bit order and border handling as the
+ * shader (see kernels::rowLbp()).  With setUniform(true) the codes are mapped
+ * to the 59 uniform pattern labels instead.
+ */
+
+class LbpProc : public ProcBase
+{
+public:
+
+    virtual const char *getProcName() const { return "LbpProc"; }
+
+    void setUniform(bool uniform) { m_uniform = uniform; }
+    bool getUniform() const { return m_uniform; }
+
+protected:
+
+    virtual void render(const cv::Mat &input, cv::Mat &output);
+
+    bool m_uniform = false;
+};
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__LbpProc__) */
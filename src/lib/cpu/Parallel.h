@@ -0,0 +1,49 @@
+//
+//  Parallel.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__Parallel__
+#define __gatherer__cpu__Parallel__
+
+#include "cpu/gatherer_cpu.h"
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+
+_GATHERER_CPU_BEGIN
+
+// Adapt a callable to cv::ParallelLoopBody (the lambda overload of
+// cv::parallel_for_ is not available in all OpenCV 3.x releases).
+template <typename Function>
+class ParallelRows : public cv::ParallelLoopBody
+{
+public:
+    ParallelRows(const Function &function) : m_function(function) {}
+    virtual void operator()(const cv::Range &range) const { m_function(range); }
+protected:
+    const Function &m_function;
+};
+
+/*
+ * Run function(cv::Range) over [0, rows) in horizontal stripes of at least
+ * grain rows.  Each stripe is handed to a single call so kernels can keep
+ * per-stripe scratch rows (sliding windows) hot in cache.
+ */
+template <typename Function>
+void parallelRows(int rows, bool parallel, const Function &function, int grain = 16)
+{
+    const int stripes = std::max(1, rows / std::max(1, grain));
+    if(parallel && stripes > 1)
+    {
+        cv::parallel_for_(cv::Range(0, rows), ParallelRows<Function>(function), double(stripes));
+    }
+    else
+    {
+        function(cv::Range(0, rows));
+    }
+}
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__Parallel__) */
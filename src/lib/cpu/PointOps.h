@@ -0,0 +1,340 @@
+//
+//  PointOps.h
+//  gatherer
+//
+//  Compile-time composition of per-pixel operations.  A chain such as
+//
+//      auto op = ops::grayBGR() | ops::gainOffset(1.5f, -20.f) | ops::threshold(128);
+//
+//  is a single inlined functor, so transform() runs color conversion, gain
+//  and threshold in one pass over the image with no intermediate cv::Mat, and
+//  the row loop is left simple enough for the compiler to vectorize (table
+//  lookups excepted).  The same chains feed the histogram() and statistics()
+//  reductions, which never store the transformed image at all.
+//
+
+#ifndef __gatherer__cpu__PointOps__
+#define __gatherer__cpu__PointOps__
+
+#include "cpu/gatherer_cpu.h"
+#include "cpu/Kernels.h"
+#include "cpu/Parallel.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+_GATHERER_CPU_BEGIN
+
+namespace ops
+{
+    /// Input pixel with a compile-time channel count, converts to its first channel
+    template <int Channels>
+    struct Pixel
+    {
+        const uint8_t *p;
+        int operator[](int i) const { return p[i]; }
+        operator int() const { return p[0]; }
+    };
+
+    /// Numeric value of an intermediate result
+    inline float value(float v) { return v; }
+    inline float value(int v) { return float(v); }
+    template <int Channels>
+    float value(const Pixel<Channels> &px) { return float(px[0]); }
+
+    /// CRTP base: anything derived from PointOp composes with operator|
+    template <typename Derived>
+    struct PointOp
+    {
+        enum { kMinChannels = 1 }; // input channels the operation reads
+
+        const Derived & self() const { return static_cast<const Derived &>(*this); }
+    };
+
+    /// first, then second
+    template <typename First, typename Second>
+    struct Chain : public PointOp<Chain<First, Second>>
+    {
+        enum { kMinChannels = First::kMinChannels };
+
+        Chain(const First &first, const Second &second) : first(first), second(second) {}
+
+        template <typename T>
+        auto operator()(const T &v) const -> decltype(std::declval<Second>()(std::declval<First>()(v)))
+        {
+            return second(first(v));
+        }
+
+        First first;
+        Second second;
+    };
+
+    template <typename First, typename Second>
+    Chain<First, Second> operator|(const PointOp<First> &first, const PointOp<Second> &second)
+    {
+        return Chain<First, Second>(first.self(), second.self());
+    }
+
+    // ########### Sources (consume a Pixel) ###########
+
+    /// Q14 BT.601 luminance, bit-exact with GrayscaleProc (1 and 2 channel input is passed through)
+    struct Gray : public PointOp<Gray>
+    {
+        explicit Gray(const kernels::GrayWeights &weights) : w(weights) {}
+
+        template <int Channels>
+        int operator()(const Pixel<Channels> &px) const
+        {
+            return (Channels < 3) ? px[0] : ((px[0] * w.c0 + px[1] * w.c1 + px[2] * w.c2 + (1 << 13)) >> 14);
+        }
+
+        kernels::GrayWeights w;
+    };
+
+    inline Gray grayBGR() { return Gray(kernels::getGrayWeightsBGR()); }
+    inline Gray grayRGB() { return Gray(kernels::getGrayWeightsRGB()); }
+
+    /// Select one channel
+    template <int Index>
+    struct Channel : public PointOp<Channel<Index>>
+    {
+        enum { kMinChannels = Index + 1 };
+
+        template <int Channels>
+        int operator()(const Pixel<Channels> &px) const { return px[Index]; }
+    };
+
+    template <int Index>
+    Channel<Index> channel() { return Channel<Index>(); }
+
+    // ########### Value operations ###########
+
+    /// v * gain + offset (float)
+    struct GainOffset : public PointOp<GainOffset>
+    {
+        GainOffset(float gain, float offset) : gain(gain), offset(offset) {}
+
+        template <typename T>
+        float operator()(const T &v) const { return value(v) * gain + offset; }
+
+        float gain, offset;
+    };
+
+    inline GainOffset gainOffset(float gain, float offset = 0.f) { return GainOffset(gain, offset); }
+
+    /// Round and clamp to [0,255] (float input must be within int range)
+    struct Saturate : public PointOp<Saturate>
+    {
+        uint8_t operator()(float v) const
+        {
+            // Clamp after the conversion: integer selects vectorize without -fno-trapping-math
+            return (*this)(int(v + 0.5f));
+        }
+        uint8_t operator()(int v) const
+        {
+            v = (v < 0) ? 0 : v;
+            return uint8_t((v > 255) ? 255 : v);
+        }
+
+        template <int Channels>
+        uint8_t operator()(const Pixel<Channels> &px) const { return uint8_t(px[0]); }
+    };
+
+    inline Saturate saturate() { return Saturate(); }
+
+    /// table[saturate(v)] for a 256 entry table (owned by the caller)
+    struct Lut : public PointOp<Lut>
+    {
+        explicit Lut(const uint8_t *table) : table(table) {}
+
+        template <typename T>
+        uint8_t operator()(const T &v) const { return table[Saturate()(v)]; }
+
+        const uint8_t *table;
+    };
+
+    inline Lut lut(const uint8_t *table) { return Lut(table); }
+
+    /// v > thresh ? maxValue : 0, as cv::THRESH_BINARY
+    struct Threshold : public PointOp<Threshold>
+    {
+        Threshold(float thresh, int maxValue) : thresh(thresh), maxValue(maxValue) {}
+
+        template <typename T>
+        int operator()(const T &v) const { return (value(v) > thresh) ? maxValue : 0; }
+
+        float thresh;
+        int maxValue;
+    };
+
+    inline Threshold threshold(float thresh, int maxValue = 255) { return Threshold(thresh, maxValue); }
+
+    // ########### Drivers ###########
+
+    template <int Channels, typename Op>
+    void transformRow(const uint8_t *src, uint8_t *dst, int width, const Op &op)
+    {
+        const Saturate store;
+        for(int x = 0; x < width; x++)
+        {
+            dst[x] = store(op(Pixel<Channels> { src + x * Channels }));
+        }
+    }
+
+    // Run body.run<Channels>() for the channel count of an 8-bit image
+    template <typename Op, typename Body>
+    void forChannels(int channels, const Body &body)
+    {
+        CV_Assert(channels >= int(Op::kMinChannels));
+        switch(channels)
+        {
+            case 1: body.template run<1>(); break;
+            case 2: body.template run<2>(); break;
+            case 3: body.template run<3>(); break;
+            case 4: body.template run<4>(); break;
+            default: CV_Assert(channels >= 1 && channels <= 4);
+        }
+    }
+
+    template <typename Op>
+    struct TransformBody
+    {
+        template <int Channels>
+        void run() const
+        {
+            parallelRows(src.rows, parallel, [&](const cv::Range &range)
+            {
+                for(int y = range.start; y < range.end; y++)
+                {
+                    transformRow<Channels>(src.ptr<uint8_t>(y), dst.ptr<uint8_t>(y), src.cols, op);
+                }
+            });
+        }
+
+        const cv::Mat &src;
+        cv::Mat &dst;
+        const Op &op;
+        bool parallel;
+    };
+
+    /// dst = saturate(op(src)) as a single CV_8UC1 pass
+    template <typename Op>
+    void transform(const cv::Mat &src, cv::Mat &dst, const Op &op, bool parallel = true)
+    {
+        CV_Assert(src.depth() == CV_8U);
+        dst.create(src.size(), CV_8UC1);
+        forChannels<Op>(src.channels(), TransformBody<Op> { src, dst, op, parallel });
+    }
+
+    template <typename Op>
+    struct HistogramBody
+    {
+        template <int Channels>
+        void run() const
+        {
+            std::mutex mutex;
+            parallelRows(src.rows, parallel, [&](const cv::Range &range)
+            {
+                int local[256] = { 0 };
+                const Saturate store;
+                for(int y = range.start; y < range.end; y++)
+                {
+                    const uint8_t *row = src.ptr<uint8_t>(y);
+                    for(int x = 0; x < src.cols; x++)
+                    {
+                        local[store(op(Pixel<Channels> { row + x * Channels }))]++;
+                    }
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                for(int i = 0; i < 256; i++)
+                {
+                    hist[i] += local[i];
+                }
+            });
+        }
+
+        const cv::Mat &src;
+        const Op &op;
+        int *hist;
+        bool parallel;
+    };
+
+    /// Accumulate the 256 bin histogram of saturate(op(src)) into hist (not cleared)
+    template <typename Op>
+    void histogram(const cv::Mat &src, const Op &op, int hist[256], bool parallel = true)
+    {
+        CV_Assert(src.depth() == CV_8U);
+        forChannels<Op>(src.channels(), HistogramBody<Op> { src, op, hist, parallel });
+    }
+
+    struct Statistics
+    {
+        double sum = 0.0;
+        double sumSq = 0.0;
+        float min = std::numeric_limits<float>::max();
+        float max = std::numeric_limits<float>::lowest();
+        size_t count = 0;
+
+        double mean() const { return count ? sum / double(count) : 0.0; }
+        double variance() const { return count ? std::max(sumSq / double(count) - mean() * mean(), 0.0) : 0.0; }
+    };
+
+    template <typename Op>
+    struct StatisticsBody
+    {
+        template <int Channels>
+        void run() const
+        {
+            std::mutex mutex;
+            parallelRows(src.rows, parallel, [&](const cv::Range &range)
+            {
+                Statistics local;
+                for(int y = range.start; y < range.end; y++)
+                {
+                    const uint8_t *row = src.ptr<uint8_t>(y);
+                    for(int x = 0; x < src.cols; x++)
+                    {
+                        const float v = value(op(Pixel<Channels> { row + x * Channels }));
+                        local.sum += v;
+                        local.sumSq += double(v) * double(v);
+                        local.min = std::min(local.min, v);
+                        local.max = std::max(local.max, v);
+                    }
+                }
+                local.count = size_t(range.size()) * size_t(src.cols);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                result.sum += local.sum;
+                result.sumSq += local.sumSq;
+                result.min = std::min(result.min, local.min);
+                result.max = std::max(result.max, local.max);
+                result.count += local.count;
+            });
+        }
+
+        const cv::Mat &src;
+        const Op &op;
+        Statistics &result;
+        bool parallel;
+    };
+
+    /// Sum, sum of squares, min and max of op(src) (before saturation)
+    template <typename Op>
+    Statistics statistics(const cv::Mat &src, const Op &op, bool parallel = true)
+    {
+        CV_Assert(src.depth() == CV_8U);
+        Statistics result;
+        forChannels<Op>(src.channels(), StatisticsBody<Op> { src, op, result, parallel });
+        return result;
+    }
+}
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__PointOps__) */
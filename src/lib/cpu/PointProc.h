@@ -0,0 +1,64 @@
+//
+//  PointProc.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__PointProc__
+#define __gatherer__cpu__PointProc__
+
+#include "cpu/gatherer_cpu.h"
+#include "cpu/ProcBase.h"
+#include "cpu/PointOps.h"
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \class PointProc
+ *
+ * \brief Pipeline stage running a fused ops:: chain
+ *
+ * Ingest stage for per-pixel preprocessing: the whole chain is evaluated in
+ * one pass and only its CV_8UC1 result is stored.
+ *
+ * @code
+ *
+ * auto op = gatherer::cpu::ops::grayBGR() | gatherer::cpu::ops::gainOffset(1.5f, -20.f);
+ * auto ingestProc = gatherer::cpu::makePointProc(op);
+ * gatherer::cpu::LbpProc lbpProc;
+ * ingestProc.add(&lbpProc);
+ * ingestProc.process(image);
+ *
+ * @endcode
+ */
+
+template <typename Op>
+class PointProc : public ProcBase
+{
+public:
+
+    explicit PointProc(const Op &op) : m_op(op) {}
+
+    virtual const char *getProcName() const { return "PointProc"; }
+
+    const Op & getOp() const { return m_op; }
+    void setOp(const Op &op) { m_op = op; }
+
+protected:
+
+    virtual void render(const cv::Mat &input, cv::Mat &output)
+    {
+        ops::transform(input, output, m_op, m_options.parallel);
+    }
+
+    Op m_op;
+};
+
+template <typename Op>
+PointProc<Op> makePointProc(const Op &op)
+{
+    return PointProc<Op>(op);
+}
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__PointProc__) */
@@ -0,0 +1,61 @@
+//
+//  ProcBase.cpp
+//  gatherer
+//
+
+#include "cpu/ProcBase.h"
+#include "cpu/Kernels.h"
+
+#include <cstring>
+
+_GATHERER_CPU_BEGIN
+
+void ProcBase::add(ProcBase *proc)
+{
+    m_subscribers.push_back(proc);
+    proc->setOptions(m_options);
+}
+
+void ProcBase::process(const cv::Mat &input)
+{
+    render(input, m_output);
+    for(auto &proc : m_subscribers)
+    {
+        proc->process(m_output);
+    }
+}
+
+void ProcBase::setOptions(const Options &options)
+{
+    m_options = options;
+    for(auto &proc : m_subscribers)
+    {
+        proc->setOptions(options);
+    }
+}
+
+const cv::Mat & ProcBase::getLuminance(const cv::Mat &input)
+{
+    if(input.channels() == 1)
+    {
+        return input;
+    }
+
+    m_luminance.create(input.size(), CV_8UC1);
+    for(int y = 0; y < input.rows; y++)
+    {
+        kernels::rowExtractChannel(input.ptr<uint8_t>(y), m_luminance.ptr<uint8_t>(y), input.cols, input.channels());
+    }
+    return m_luminance;
+}
+
+void ProcBase::getResultData(unsigned char *data) const
+{
+    const size_t rowSize = m_output.cols * m_output.elemSize();
+    for(int y = 0; y < m_output.rows; y++)
+    {
+        std::memcpy(data + y * rowSize, m_output.ptr(y), rowSize);
+    }
+}
+
+_GATHERER_CPU_END
@@ -0,0 +1,82 @@
+//
+//  ProcBase.h
+//  gatherer
+//
+
+#ifndef __gatherer__cpu__ProcBase__
+#define __gatherer__cpu__ProcBase__
+
+#include "cpu/gatherer_cpu.h"
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+_GATHERER_CPU_BEGIN
+
+/**
+ * \class ProcBase
+ *
+ * \brief Base class for CPU processing stages
+ *
+ * Mirrors the ogles_gpgpu::ProcInterface chaining model so a CPU pipeline is
+ * wired exactly like its shader counterpart:
+ *
+ * @code
+ *
+ * gatherer::cpu::GrayscaleProc grayscaleProc;
+ * gatherer::cpu::GradProc gradProc;
+ * grayscaleProc.add(&gradProc);
+ * grayscaleProc.process(image);
+ * cv::Mat result = gradProc.getResult();
+ *
+ * @endcode
+ */
+
+class ProcBase
+{
+public:
+
+    /// Execution options, shared by every stage of a pipeline (see setOptions())
+    struct Options
+    {
+        bool simd = true;       // use the vectorized kernels
+        bool parallel = true;   // split each frame into row stripes across threads
+    };
+
+    virtual ~ProcBase() {}
+    virtual const char *getProcName() const = 0;
+
+    /// Subscribe a stage to the output of this stage
+    void add(ProcBase *proc);
+
+    /// Render this stage and all subscribers
+    void process(const cv::Mat &input);
+
+    /// Set execution options for this stage and everything downstream of it
+    void setOptions(const Options &options);
+    const Options & getOptions() const { return m_options; }
+
+    const cv::Mat & getResult() const { return m_output; }
+    int getOutFrameW() const { return m_output.cols; }
+    int getOutFrameH() const { return m_output.rows; }
+
+    /// Copy the (tightly packed) result to data, as ogles_gpgpu::ProcInterface::getResultData()
+    void getResultData(unsigned char *data) const;
+
+protected:
+
+    virtual void render(const cv::Mat &input, cv::Mat &output) = 0;
+
+    /// Channel 0 of the input (the channel the shaders sample), copied only for multi-channel input
+    const cv::Mat & getLuminance(const cv::Mat &input);
+
+    Options m_options;
+    cv::Mat m_output;
+    std::vector<ProcBase *> m_subscribers;
+
+    cv::Mat m_luminance;
+};
+
+_GATHERER_CPU_END
+
+#endif /* defined(__gatherer__cpu__ProcBase__) */
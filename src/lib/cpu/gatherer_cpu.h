@@ -0,0 +1,36 @@
+//
+//  gatherer_cpu.h
+//  gatherer
+//
+//  Native CPU counterparts of the ogles_gpgpu shader stages for hosts
+//  without a (fast) GPU.
+//
+
+#ifndef GATHERER_gatherer_cpu_h
+#define GATHERER_gatherer_cpu_h
+
+#define _GATHERER_CPU_BEGIN namespace gatherer { namespace cpu {
+#define _GATHERER_CPU_END } }
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#  define GATHERER_CPU_SSE2 1
+#else
+#  define GATHERER_CPU_SSE2 0
+#endif
+
+// Set by the build when the SSE4.1, AVX2 and AVX-512 kernel files are compiled
+// with their target flags (see src/lib/CMakeLists.txt).  Their tables fall back
+// to the SSE2 kernels, so 32-bit x86 builds without SSE2 (i686 without -msse2)
+// don't dispatch.
+#if !defined(GATHERER_CPU_X86_DISPATCH) || !GATHERER_CPU_SSE2
+#  undef GATHERER_CPU_X86_DISPATCH
+#  define GATHERER_CPU_X86_DISPATCH 0
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#  define GATHERER_CPU_NEON 1
+#else
+#  define GATHERER_CPU_NEON 0
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+# This file generated automatically by:
+#   generate_sugar_files.py
+# see wiki for more info:
+#   https://github.com/ruslo/sugar/wiki/Collecting-sources
+
+if(DEFINED SRC_LIB_CPU_SUGAR_CMAKE_)
+  return()
+else()
+  set(SRC_LIB_CPU_SUGAR_CMAKE_ 1)
+endif()
+
+include(sugar_files)
+
+sugar_files(
+    GATHERER_CPU_SRC
+    CornerDetector.cpp
+    CpuFeatures.cpp
+    GaussProc.cpp
+    GradProc.cpp
+    GrayscaleProc.cpp
+    Kernels.cpp
+    KernelsAVX2.cpp
+    KernelsAVX512.cpp
+    KernelsNEON.cpp
+    KernelsSSE2.cpp
+    KernelsSSE41.cpp
+    KernelsScalar.cpp
+    LbpHistogramProc.cpp
+    LbpProc.cpp
+    ProcBase.cpp
+)
+
+sugar_files(
+    GATHERER_CPU_HDRS
+    CornerDetector.h
+    CpuFeatures.h
+    GaussProc.h
+    GradProc.h
+    GrayscaleProc.h
+    Kernels.h
+    KernelsImpl.h
+    Keypoints.h
+    LbpHistogramProc.h
+    LbpProc.h
+    Parallel.h
+    PointOps.h
+    PointProc.h
+    ProcBase.h
+    gatherer_cpu.h
+)
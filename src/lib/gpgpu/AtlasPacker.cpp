@@ -0,0 +1,101 @@
+//
+//  AtlasPacker.cpp
+//  gatherer
+//
+
+#include "gpgpu/AtlasPacker.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+AtlasPacker::AtlasPacker(int padding, int maxSide)
+: m_padding(padding)
+, m_maxSide(maxSide)
+{
+    if(padding < 0 || maxSide <= 0)
+    {
+        throw std::invalid_argument("AtlasPacker: invalid padding or size limit");
+    }
+}
+
+cv::Size AtlasPacker::packShelves(const std::vector<cv::Size> &sizes, const std::vector<int> &order, int width, std::vector<cv::Rect> &rects) const
+{
+    cv::Size used(0, 0);
+    cv::Point shelf(0, 0);
+    int shelfHeight = 0;
+    for(int i : order)
+    {
+        const cv::Size &size = sizes[i];
+        if(shelf.x > 0 && shelf.x + size.width > width)
+        {
+            shelf = cv::Point(0, shelf.y + shelfHeight + m_padding);
+            shelfHeight = 0;
+        }
+        rects[i] = cv::Rect(shelf, size);
+        shelf.x += size.width + m_padding;
+        shelfHeight = std::max(shelfHeight, size.height);
+        used.width = std::max(used.width, rects[i].x + size.width);
+        used.height = std::max(used.height, rects[i].y + size.height);
+    }
+    return used;
+}
+
+std::vector<cv::Rect> AtlasPacker::pack(const std::vector<cv::Size> &sizes, cv::Size &atlasSize) const
+{
+    std::vector<cv::Rect> best(sizes.size()), rects(sizes.size());
+    atlasSize = cv::Size(0, 0);
+    if(sizes.empty())
+    {
+        return best;
+    }
+
+    std::vector<int> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return sizes[a].height > sizes[b].height; });
+
+    int widest = 0;
+    for(const auto &size : sizes)
+    {
+        widest = std::max(widest, size.width);
+    }
+
+    // A shelf breaks after the first k rectangles of the height order
+    std::vector<int> widths { widest };
+    for(size_t k = 0, x = 0; k < order.size(); k++)
+    {
+        x += sizes[order[k]].width + (k ? m_padding : 0);
+        if(int(x) > widest && int(x) <= m_maxSide)
+        {
+            widths.push_back(int(x));
+        }
+    }
+
+    double bestArea = 0.0;
+    for(int width : widths)
+    {
+        const cv::Size used = packShelves(sizes, order, width, rects);
+        if(used.width > m_maxSide || used.height > m_maxSide)
+        {
+            continue;
+        }
+        const double area = double(used.width) * double(used.height);
+        const bool smaller = (area < bestArea) || (area == bestArea && std::max(used.width, used.height) < std::max(atlasSize.width, atlasSize.height));
+        if(!bestArea || smaller)
+        {
+            bestArea = area;
+            atlasSize = used;
+            best = rects;
+        }
+    }
+
+    if(!bestArea)
+    {
+        throw std::runtime_error("AtlasPacker: rectangles do not fit in the maximum texture size");
+    }
+    return best;
+}
+
+_GATHERER_GRAPHICS_END
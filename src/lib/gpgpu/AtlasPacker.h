@@ -0,0 +1,48 @@
+//
+//  AtlasPacker.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__AtlasPacker__
+#define __gatherer__gpgpu__AtlasPacker__
+
+#include "graphics/gatherer_graphics.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class AtlasPacker
+ *
+ * \brief Shelf packing of rectangles into a small texture atlas
+ *
+ * Rectangles are placed by decreasing height on horizontal shelves.  Every
+ * atlas width at which a shelf could break is tried and the one with the
+ * smallest area wins, so a geometric series of pyramid levels ends up with
+ * the coarse levels tucked beside the large ones.
+ */
+
+class AtlasPacker
+{
+public:
+
+    /// padding: empty texels kept between rectangles, maxSide: texture size limit
+    explicit AtlasPacker(int padding = 1, int maxSide = 4096);
+
+    /// Placement of each size (in input order); throws if they do not fit in maxSide x maxSide
+    std::vector<cv::Rect> pack(const std::vector<cv::Size> &sizes, cv::Size &atlasSize) const;
+
+protected:
+
+    cv::Size packShelves(const std::vector<cv::Size> &sizes, const std::vector<int> &order, int width, std::vector<cv::Rect> &rects) const;
+
+    int m_padding;
+    int m_maxSide;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__AtlasPacker__) */
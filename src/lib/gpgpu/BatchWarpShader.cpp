@@ -0,0 +1,249 @@
+//
+//  BatchWarpShader.cpp
+//  gatherer
+//
+
+#include "gpgpu/BatchWarpShader.h"
+#include "gpgpu/AtlasPacker.h"
+#include "graphics/GLExtra.h"
+#include "graphics/GLStateCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+enum { kAttribPosition, kAttribTexCoord };
+
+// Per vertex: atlas position (clip space), homogeneous input texture coordinate
+enum { kVertexFloats = 5 };
+
+static const char *kVertexShader = R"(
+attribute vec4 position;
+attribute vec3 texCoord;
+varying vec3 vTexCoord;
+void main()
+{
+    vTexCoord = texCoord;
+    gl_Position = position;
+})";
+
+// The homogeneous coordinate is linear over the patch, the divide makes it projective
+static const char *kFragmentShader = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+uniform sampler2D uInputTex;
+varying vec3 vTexCoord;
+void main()
+{
+    gl_FragColor = texture2D(uInputTex, vTexCoord.xy / vTexCoord.z);
+})";
+
+BatchWarpShader::Patch::Patch(const cv::Rect &roi, const cv::Size &size)
+: roi(roi)
+, size(size)
+{
+    // Pixel centers as cv::resize: (x + 0.5) * scale - 0.5
+    const float sx = float(size.width) / float(roi.width);
+    const float sy = float(size.height) / float(roi.height);
+    H = cv::Matx33f(sx, 0.f, 0.5f * sx - 0.5f, 0.f, sy, 0.5f * sy - 0.5f, 0.f, 0.f, 1.f);
+}
+
+BatchWarpShader::Patch::Patch(const cv::Rect &roi, const cv::Matx33f &H, const cv::Size &size)
+: roi(roi)
+, H(H)
+, size(size)
+{
+
+}
+
+BatchWarpShader::Patch::Patch(const cv::Rect &roi, const cv::Matx23f &A, const cv::Size &size)
+: roi(roi)
+, H(A(0,0), A(0,1), A(0,2), A(1,0), A(1,1), A(1,2), 0.f, 0.f, 1.f)
+, size(size)
+{
+
+}
+
+BatchWarpShader::BatchWarpShader(int padding)
+: m_padding(padding)
+{
+    compileShaders();
+}
+
+BatchWarpShader::~BatchWarpShader()
+{
+    release();
+}
+
+void BatchWarpShader::compileShaders()
+{
+    std::vector< std::pair<int, const char *> > attributes
+    {
+        { kAttribPosition, "position" },
+        { kAttribTexCoord, "texCoord" }
+    };
+    const GLchar * vShaderStr[] = { kVertexShader };
+    const GLchar * fShaderStr[] = { kFragmentShader };
+    m_program = make_unique<shader_prog>(vShaderStr, fShaderStr, attributes);
+}
+
+void BatchWarpShader::release()
+{
+    if(m_vbo)
+    {
+        glDeleteBuffers(1, &m_vbo);
+    }
+    if(m_fbo)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+    if(m_texture)
+    {
+        glDeleteTextures(1, &m_texture);
+    }
+    m_vbo = m_fbo = m_texture = 0;
+    m_capacity = cv::Size();
+    GLStateCache::get().invalidate(); // the names can be reused
+}
+
+void BatchWarpShader::allocate(const cv::Size &size)
+{
+    release();
+
+    glGenBuffers(1, &m_vbo);
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.width, size.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("BatchWarpShader: incomplete framebuffer");
+    }
+
+    m_capacity = size;
+}
+
+void BatchWarpShader::operator()(GLuint texture, const cv::Size &textureSize, const std::vector<Patch> &patches)
+{
+    if(patches.empty())
+    {
+        m_layout = PyramidLayout();
+        m_reader.reset();
+        return;
+    }
+
+    std::vector<cv::Size> sizes;
+    sizes.reserve(patches.size());
+    for(const auto &patch : patches)
+    {
+        if(patch.size.area() <= 0 || patch.roi.area() <= 0)
+        {
+            throw std::invalid_argument("BatchWarpShader: empty patch");
+        }
+        sizes.push_back(patch.size);
+    }
+
+    cv::Size atlasSize;
+    PyramidLayout layout(AtlasPacker(m_padding).pack(sizes, atlasSize));
+
+    GLint viewport[4], framebuffer = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    // Grow only, so a varying patch count does not reallocate every frame
+    if(atlasSize.width > m_capacity.width || atlasSize.height > m_capacity.height)
+    {
+        allocate(cv::Size(std::max(atlasSize.width, m_capacity.width), std::max(atlasSize.height, m_capacity.height)));
+    }
+    layout.textureSize = m_capacity; // the packed rects sit in the (larger) texture
+
+    const bool changed = (layout.levels != m_layout.levels) || (layout.textureSize != m_layout.textureSize);
+    if(changed)
+    {
+        m_layout = layout;
+        m_reader = make_unique<PyramidReader>(m_layout);
+    }
+
+    // Two triangles per patch.  A patch pixel center p samples the input at
+    // roi.tl() + H^-1 p, folded with the texture normalization into one matrix
+    // so the corners carry homogeneous texture coordinates.
+    const cv::Matx33f N(1.f / float(textureSize.width), 0.f, 0.f, 0.f, 1.f / float(textureSize.height), 0.f, 0.f, 0.f, 1.f);
+    const cv::Matx33f C(1.f, 0.f, -0.5f, 0.f, 1.f, -0.5f, 0.f, 0.f, 1.f);
+    m_vertices.clear();
+    for(size_t i = 0; i < patches.size(); i++)
+    {
+        const Patch &patch = patches[i];
+        const cv::Rect &rect = m_layout.levels[i];
+
+        const cv::Matx33f T(1.f, 0.f, float(patch.roi.x) + 0.5f, 0.f, 1.f, float(patch.roi.y) + 0.5f, 0.f, 0.f, 1.f);
+        const cv::Matx33f M = N * T * patch.H.inv() * C;
+
+        const float x0 = 2.f * float(rect.x) / float(m_capacity.width) - 1.f;
+        const float y0 = 2.f * float(rect.y) / float(m_capacity.height) - 1.f;
+        const float x1 = 2.f * float(rect.x + rect.width) / float(m_capacity.width) - 1.f;
+        const float y1 = 2.f * float(rect.y + rect.height) / float(m_capacity.height) - 1.f;
+        const float w = float(patch.size.width);
+        const float h = float(patch.size.height);
+        const GLfloat corners[4][4] = { { x0, y0, 0.f, 0.f }, { x1, y0, w, 0.f }, { x0, y1, 0.f, h }, { x1, y1, w, h } };
+        for(int corner : { 0, 1, 2, 2, 1, 3 })
+        {
+            const cv::Vec3f q = M * cv::Vec3f(corners[corner][2], corners[corner][3], 1.f);
+            m_vertices.insert(m_vertices.end(), { corners[corner][0], corners[corner][1], q[0], q[1], q[2] });
+        }
+    }
+
+    (*m_program)();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(m_program->GetUniformLocation("uInputTex"), 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_capacity.width, m_capacity.height);
+    if(changed)
+    {
+        // Padding is never drawn, clear it when the packing moves
+        glClearColor(0.f, 0.f, 0.f, 0.f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    const GLsizei stride = kVertexFloats * sizeof(GLfloat);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(GLfloat), m_vertices.data(), GL_STREAM_DRAW);
+    glVertexAttribPointer(kAttribPosition, 2, GL_FLOAT, GL_FALSE, stride, (const GLvoid *)0);
+    glVertexAttribPointer(kAttribTexCoord, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid *)(2 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(kAttribPosition);
+    glEnableVertexAttribArray(kAttribTexCoord);
+
+    glDrawArrays(GL_TRIANGLES, 0, GLsizei(m_vertices.size() / kVertexFloats));
+
+    // ogles_gpgpu draws from client memory
+    glDisableVertexAttribArray(kAttribTexCoord);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLStateCache::get().invalidate(); // bound outside the cache
+}
+
+const std::vector<cv::Mat> & BatchWarpShader::read()
+{
+    if(!m_reader)
+    {
+        static const std::vector<cv::Mat> none;
+        return none;
+    }
+    (*m_reader)(m_texture);
+    return m_reader->getLevels();
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,108 @@
+//
+//  BatchWarpShader.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__BatchWarpShader__
+#define __gatherer__gpgpu__BatchWarpShader__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLSLShaderProgram.h"
+#include "gpgpu/PyramidLayout.h"
+#include "gpgpu/PyramidReader.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class BatchWarpShader
+ *
+ * \brief Crop and warp many patches of a texture into one atlas with one draw call
+ *
+ * The batched counterpart of WarpShader for detectors that need dozens of
+ * normalized patches per frame (e.g. faces warped to a canonical pose).  All
+ * patches are quads of one vertex buffer, so a frame costs one FBO bind, one
+ * glDrawArrays and one glReadPixels of the atlas, whatever the patch count:
+ *
+ * @code
+ *
+ * using Patch = gatherer::graphics::BatchWarpShader::Patch;
+ * std::vector<Patch> patches;
+ * for(const auto &face : faces)
+ * {
+ *     patches.emplace_back(face.roi, face.H, cv::Size(64, 64)); // H: roi pixels to patch pixels
+ * }
+ * gatherer::graphics::BatchWarpShader warper;
+ * warper(video.getInputTexId(), frameSize, patches);
+ * const std::vector<cv::Mat> &crops = warper.read(); // CV_8UC4 views, one per patch
+ *
+ * @endcode
+ *
+ * Coordinates follow cv::warpPerspective: H maps pixel centers of the ROI
+ * (origin at roi.tl()) to pixel centers of the patch, and the patch samples
+ * the source through its inverse.  The ROI only sets the origin; samples are
+ * not clipped to it.  The input texture should use GL_LINEAR filtering.
+ */
+
+class BatchWarpShader
+{
+public:
+
+    struct Patch
+    {
+        /// Resize of the ROI to size
+        Patch(const cv::Rect &roi, const cv::Size &size);
+
+        /// Perspective warp of the ROI
+        Patch(const cv::Rect &roi, const cv::Matx33f &H, const cv::Size &size);
+
+        /// Affine warp of the ROI
+        Patch(const cv::Rect &roi, const cv::Matx23f &A, const cv::Size &size);
+
+        cv::Rect roi;
+        cv::Matx33f H;
+        cv::Size size;
+    };
+
+    /// padding: empty texels kept between patches
+    explicit BatchWarpShader(int padding = 1);
+    ~BatchWarpShader();
+
+    /// Render all patches of a GL_TEXTURE_2D of the given size into the atlas
+    void operator()(GLuint texture, const cv::Size &textureSize, const std::vector<Patch> &patches);
+
+    GLuint getOutputTexId() const { return m_texture; }
+
+    /// Patch rectangles within the atlas (in the order given)
+    const PyramidLayout & getLayout() const { return m_layout; }
+
+    /// One readback of the patches of the last render, as cv::Mat views valid until the next read
+    const std::vector<cv::Mat> & read();
+
+protected:
+
+    void compileShaders();
+    void allocate(const cv::Size &size);
+    void release();
+
+    int m_padding;
+
+    PyramidLayout m_layout;
+    cv::Size m_capacity;            // texture size, only grows
+    std::vector<GLfloat> m_vertices; // reused between frames
+
+    GLuint m_texture = 0;
+    GLuint m_fbo = 0;
+    GLuint m_vbo = 0;
+
+    std::unique_ptr<shader_prog> m_program;
+    std::unique_ptr<PyramidReader> m_reader;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__BatchWarpShader__) */
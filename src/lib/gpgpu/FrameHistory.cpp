@@ -0,0 +1,170 @@
+//
+//  FrameHistory.cpp
+//  gatherer
+//
+
+#include "gpgpu/FrameHistory.h"
+#include "graphics/GLExtra.h"
+#include "graphics/GLStateCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+enum { kAttribPosition };
+
+static const char *kVertexShader = R"(
+attribute vec4 position;
+varying vec2 vTexCoord;
+void main()
+{
+    vTexCoord = position.xy * 0.5 + 0.5;
+    gl_Position = position;
+})";
+
+static const char *kCopyShader = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+uniform sampler2D uInputTex;
+varying vec2 vTexCoord;
+void main()
+{
+    gl_FragColor = texture2D(uInputTex, vTexCoord);
+})";
+
+FrameHistory::FrameHistory(int depth, GLTextureFormat::Format format) : m_format(format)
+{
+    if(depth <= 0)
+    {
+        throw std::invalid_argument("FrameHistory: depth must be positive");
+    }
+    m_slots.resize(depth);
+}
+
+FrameHistory::~FrameHistory()
+{
+    release();
+}
+
+void FrameHistory::release()
+{
+    for(auto &slot : m_slots)
+    {
+        if(slot.fbo)
+        {
+            glDeleteFramebuffers(1, &slot.fbo);
+        }
+        if(slot.texture)
+        {
+            glDeleteTextures(1, &slot.texture);
+        }
+        slot = Slot();
+    }
+    m_count = 0;
+    m_size = cv::Size();
+    GLStateCache::get().invalidate(); // the names can be reused
+}
+
+void FrameHistory::allocate(const cv::Size &size)
+{
+    release();
+
+    const GLTextureFormat::Format format = getFormat();
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    for(auto &slot : m_slots)
+    {
+        glGenTextures(1, &slot.texture);
+        GLTextureFormat::allocate(slot.texture, size, format);
+
+        glGenFramebuffers(1, &slot.fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, slot.fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, slot.texture, 0);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            throw std::runtime_error("FrameHistory: incomplete framebuffer");
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    m_size = size;
+    GLStateCache::get().invalidate(); // bound outside the cache
+}
+
+GLuint FrameHistory::getWriteFramebuffer(const cv::Size &size)
+{
+    if(size != m_size)
+    {
+        allocate(size);
+    }
+    return m_slots[(m_head + 1) % m_slots.size()].fbo;
+}
+
+void FrameHistory::advance()
+{
+    m_head = (m_head + 1) % int(m_slots.size());
+    m_count = std::min(m_count + 1, int(m_slots.size()));
+}
+
+void FrameHistory::push(GLuint texture, int width, int height)
+{
+    static const GLfloat quad[] = { -1.f, -1.f, 1.f, -1.f, -1.f, 1.f, 1.f, 1.f };
+
+    if(!m_copy)
+    {
+        std::vector< std::pair<int, const char *> > attributes { { kAttribPosition, "position" } };
+        const GLchar * vShaderStr[] = { kVertexShader };
+        const GLchar * fShaderStr[] = { kCopyShader };
+        m_copy = make_unique<shader_prog>(vShaderStr, fShaderStr, attributes);
+    }
+
+    GLint viewport[4], framebuffer = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    const GLuint fbo = getWriteFramebuffer(cv::Size(width, height));
+    (*m_copy)();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(m_copy->GetUniformLocation("uInputTex"), 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glVertexAttribPointer(kAttribPosition, 2, GL_FLOAT, GL_FALSE, 0, quad);
+    glEnableVertexAttribArray(kAttribPosition);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    advance();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLStateCache::get().invalidate(); // bound outside the cache
+}
+
+GLuint FrameHistory::getTexture(int k) const
+{
+    if(k < 0 || k >= m_count)
+    {
+        throw std::out_of_range("FrameHistory: no such frame");
+    }
+    const int depth = int(m_slots.size());
+    return m_slots[(m_head - k + depth) % depth].texture;
+}
+
+void FrameHistory::bind(GLenum firstUnit, int count) const
+{
+    if(!m_count)
+    {
+        throw std::logic_error("FrameHistory: empty");
+    }
+    for(int k = 0; k < count; k++)
+    {
+        glActiveTexture(firstUnit + k);
+        glBindTexture(GL_TEXTURE_2D, getTexture(std::min(k, m_count - 1)));
+    }
+    glActiveTexture(GL_TEXTURE0);
+    GLStateCache::get().invalidate(); // bound outside the cache
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,106 @@
+//
+//  FrameHistory.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__FrameHistory__
+#define __gatherer__gpgpu__FrameHistory__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLSLShaderProgram.h"
+#include "graphics/GLTextureFormat.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class FrameHistory
+ *
+ * \brief Ring of the last N frames as pooled textures
+ *
+ * Slots are allocated once; moving to the next frame rotates the head index,
+ * so past frames are never shifted or copied.  A producer either renders
+ * straight into the next slot or pushes a texture it owns (one copy of the
+ * new frame):
+ *
+ * @code
+ *
+ * gatherer::graphics::FrameHistory history(3);
+ *
+ * glBindFramebuffer(GL_FRAMEBUFFER, history.getWriteFramebuffer(size));
+ * ... render the frame ...
+ * history.advance();
+ *
+ * history.push(grayscaleProc.getOutputTexId(), width, height);
+ *
+ * history.bind(GL_TEXTURE0, 3);   // history[k] on unit k
+ *
+ * @endcode
+ *
+ * The same thing as a GL_TEXTURE_2D_ARRAY layer index, but available on
+ * OpenGL ES 2.0.  A history of gray or mask frames can be stored as
+ * GLTextureFormat::kR8, a quarter of the memory and bandwidth of RGBA8.
+ */
+
+class FrameHistory
+{
+public:
+
+    explicit FrameHistory(int depth, GLTextureFormat::Format format = GLTextureFormat::kRGBA8);
+    ~FrameHistory();
+
+    int getDepth() const { return int(m_slots.size()); }
+
+    /// Format of the slots (the requested one if renderable, else RGBA8)
+    GLTextureFormat::Format getFormat() const { return GLTextureFormat::resolve(m_format); }
+
+    /// Frames stored so far (up to the depth)
+    int getCount() const { return m_count; }
+
+    const cv::Size & getSize() const { return m_size; }
+
+    /// Framebuffer of the slot the next frame goes to; (re)allocates the ring for a new size
+    GLuint getWriteFramebuffer(const cv::Size &size);
+
+    /// Make the slot written through getWriteFramebuffer() history[0]
+    void advance();
+
+    /// Copy a width x height GL_TEXTURE_2D in as history[0]
+    void push(GLuint texture, int width, int height);
+
+    /// Texture of history[k], k = 0 is the newest frame (k < getCount())
+    GLuint getTexture(int k) const;
+
+    /// Bind history[k] to firstUnit + k for k < count, repeating the oldest frame while the ring fills
+    void bind(GLenum firstUnit, int count) const;
+
+    /// Forget the stored frames (textures are kept)
+    void clear() { m_count = 0; }
+
+protected:
+
+    struct Slot
+    {
+        GLuint texture = 0;
+        GLuint fbo = 0;
+    };
+
+    void allocate(const cv::Size &size);
+    void release();
+
+    std::vector<Slot> m_slots;
+    int m_head = 0;         // slot of history[0]
+    int m_count = 0;
+    cv::Size m_size;
+    GLTextureFormat::Format m_format;
+
+    std::unique_ptr<shader_prog> m_copy;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__FrameHistory__) */
@@ -0,0 +1,164 @@
+//
+//  FusedPointProc.cpp
+//  gatherer
+//
+
+#include "gpgpu/FusedPointProc.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+static const char * getTypeName(PointUniform::Type type)
+{
+    switch(type)
+    {
+        case PointUniform::kFloat: return "float";
+        case PointUniform::kVec2: return "vec2";
+        case PointUniform::kVec3: return "vec3";
+        case PointUniform::kVec4: return "vec4";
+        case PointUniform::kMat4: return "mat4";
+    }
+    throw std::logic_error("FusedPointProc: unknown uniform type");
+}
+
+static std::string getPrefix(size_t index)
+{
+    return "s" + std::to_string(index) + "_";
+}
+
+static bool readsSource(const std::vector<PointStage *> &stages)
+{
+    return std::any_of(stages.begin(), stages.end(), [](const PointStage *stage) { return stage->readsSource(); });
+}
+
+FusedPointProc::FusedPointProc(const std::vector<PointStage *> &stages, const FusedPointProc *head)
+: m_stages(stages)
+, m_head(readsSource(stages) ? head : nullptr)
+, m_fshaderSrc(generate(stages, m_head != nullptr))
+{
+    if(stages.empty())
+    {
+        throw std::logic_error("FusedPointProc: empty stage list");
+    }
+}
+
+std::string FusedPointProc::generate(const std::vector<PointStage *> &stages, bool sourceTexture)
+{
+    std::string declarations, functions, calls;
+    for(size_t i = 0; i < stages.size(); i++)
+    {
+        const std::string prefix = getPrefix(i);
+        for(const auto &uniform : stages[i]->getUniforms())
+        {
+            declarations += std::string("uniform ") + getTypeName(uniform.type) + " " + prefix + uniform.name + ";\n";
+        }
+
+        functions += "\n// " + std::string(stages[i]->getName()) + "\n";
+        functions += "vec4 " + prefix + "apply(vec4 color, vec4 source)\n{\n" + stages[i]->getSource(prefix) + "}\n";
+        calls += "    color = " + prefix + "apply(color, source);\n";
+    }
+
+    return
+    "#ifdef GL_ES\n"
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n" // highp is optional in GLES 2.0 fragment shaders
+    "#endif\n"
+    "#endif\n"
+    "varying vec2 vTexCoord;\n"
+    "uniform sampler2D uInputTex;\n"
+    + std::string(sourceTexture ? "uniform sampler2D uSourceTex;\n" : "")
+    + declarations
+    + functions +
+    "\nvoid main()\n"
+    "{\n"
+    + std::string(sourceTexture ?
+    "    vec4 source = texture2D(uSourceTex, vTexCoord);\n"
+    "    vec4 color = texture2D(uInputTex, vTexCoord);\n" :
+    "    vec4 source = texture2D(uInputTex, vTexCoord);\n"
+    "    vec4 color = source;\n")
+    + calls +
+    "    gl_FragColor = color;\n"
+    "}\n";
+}
+
+bool FusedPointProc::validate(std::string &log) const
+{
+    const GLchar *source = m_fshaderSrc.c_str();
+    GLuint shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint compiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if(!compiled)
+    {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        log.assign(std::max(length, 1), ' ');
+        glGetShaderInfoLog(shader, length, &length, &log[0]);
+    }
+    glDeleteShader(shader);
+    return compiled != 0;
+}
+
+void FusedPointProc::useTexture(GLuint id, GLuint useTexUnit, GLenum target, int position)
+{
+    m_inputTexId = id;
+    FilterProcBase::useTexture(id, useTexUnit, target, position);
+}
+
+void FusedPointProc::getUniforms()
+{
+    FilterProcBase::getUniforms();
+
+    if(m_head)
+    {
+        m_sourceTexLocation = shader->getParam(ogles_gpgpu::UNIF, "uSourceTex");
+    }
+
+    m_bindings.clear();
+    for(size_t i = 0; i < m_stages.size(); i++)
+    {
+        const std::string prefix = getPrefix(i);
+        for(const auto &uniform : m_stages[i]->getUniforms())
+        {
+            const std::string name = prefix + uniform.name;
+            m_bindings.push_back({ uniform, shader->getParam(ogles_gpgpu::UNIF, name.c_str()) });
+        }
+    }
+}
+
+void FusedPointProc::setUniforms()
+{
+    FilterProcBase::setUniforms();
+
+    for(const auto &binding : m_bindings)
+    {
+        const GLfloat *value = binding.uniform.value;
+        switch(binding.uniform.type)
+        {
+            case PointUniform::kFloat: glUniform1fv(binding.location, 1, value); break;
+            case PointUniform::kVec2: glUniform2fv(binding.location, 1, value); break;
+            case PointUniform::kVec3: glUniform3fv(binding.location, 1, value); break;
+            case PointUniform::kVec4: glUniform4fv(binding.location, 1, value); break;
+            case PointUniform::kMat4: glUniformMatrix4fv(binding.location, 1, GL_FALSE, value); break;
+        }
+    }
+
+    if(m_head)
+    {
+        // The input of this pass stays bound on its own unit
+        GLint activeUnit = GL_TEXTURE0;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+        glActiveTexture(GL_TEXTURE0 + kSourceTexUnit);
+        glBindTexture(GL_TEXTURE_2D, m_head->m_inputTexId);
+        glUniform1i(m_sourceTexLocation, kSourceTexUnit);
+        glActiveTexture(activeUnit);
+    }
+}
+
+_GATHERER_GRAPHICS_END
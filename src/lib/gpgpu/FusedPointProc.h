@@ -0,0 +1,81 @@
+//
+//  FusedPointProc.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__FusedPointProc__
+#define __gatherer__gpgpu__FusedPointProc__
+
+#include "graphics/gatherer_graphics.h"
+#include "gpgpu/PointStage.h"
+
+#include "ogles_gpgpu/common/proc/base/filterprocbase.h"
+
+#include <string>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class FusedPointProc
+ *
+ * \brief Single pass filter evaluating a chain of PointStage snippets
+ *
+ * The fragment shader is generated once from the stages (each stage becomes
+ * a function s<i>_apply() with its uniforms prefixed s<i>_) and compiled by
+ * the regular ogles_gpgpu init path.  Intermediate values stay in float
+ * registers, so the result can differ from the equivalent chain of separate
+ * passes by the 8-bit rounding of each intermediate texture.
+ *
+ * A proc that doesn't start its chain takes the head of the chain: stages
+ * reading source then sample the input texture of the head (uSourceTex)
+ * instead of their own input, as they would in the fused pass.
+ *
+ * Stages are owned by the caller and must outlive the proc.
+ */
+
+class FusedPointProc : public ogles_gpgpu::FilterProcBase
+{
+public:
+
+    explicit FusedPointProc(const std::vector<PointStage *> &stages, const FusedPointProc *head = nullptr);
+
+    virtual const char *getProcName() { return "FusedPointProc"; }
+
+    virtual void useTexture(GLuint id, GLuint useTexUnit = 1, GLenum target = GL_TEXTURE_2D, int position = 0);
+
+    const std::vector<PointStage *> & getStages() const { return m_stages; }
+    const std::string & getFragmentShader() const { return m_fshaderSrc; }
+
+    /// Compile the generated fragment shader in the current GL context, the error log is returned on failure
+    bool validate(std::string &log) const;
+
+    /// Fragment shader for a chain of stages, reading source from uSourceTex if sourceTexture is set
+    static std::string generate(const std::vector<PointStage *> &stages, bool sourceTexture = false);
+
+    /// Texture unit of uSourceTex, above the units of ogles_gpgpu inputs
+    enum { kSourceTexUnit = 4 };
+
+private:
+
+    virtual const char *getFragmentShaderSource() { return m_fshaderSrc.c_str(); }
+    virtual void getUniforms();
+    virtual void setUniforms();
+
+    struct Binding
+    {
+        PointUniform uniform;
+        GLint location;
+    };
+
+    std::vector<PointStage *> m_stages;
+    const FusedPointProc *m_head;   // null unless a stage reads source of an earlier pass
+    GLuint m_inputTexId = 0;
+    std::string m_fshaderSrc;
+    std::vector<Binding> m_bindings;
+    GLint m_sourceTexLocation = -1;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__FusedPointProc__) */
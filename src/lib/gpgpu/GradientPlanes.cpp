@@ -0,0 +1,292 @@
+//
+//  GradientPlanes.cpp
+//  gatherer
+//
+
+#include "gpgpu/GradientPlanes.h"
+#include "graphics/GLCapabilities.h"
+#include "graphics/GLStateCache.h"
+#include "graphics/GLFence.h"
+
+#include <sstream>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+enum { kAttribPosition };
+
+static const char *kVertexShader = R"(
+attribute vec4 position;
+void main()
+{
+    gl_Position = position;
+})";
+
+// kFloatN selects raw values or the 8 bit GradProc encoding of plane N,
+// kWriteN(v) stores plane N (or nothing in single plane passes).
+static const char *kFragmentShader = R"(
+#ifdef GL_ES
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+precision highp sampler2D;  // lowp texels would round the 8 bit input before the differences
+#else
+precision mediump float;    // highp is optional in GLES 2.0 fragment shaders
+precision mediump sampler2D;
+#endif
+#endif
+uniform sampler2D uInputTex;
+uniform vec2 uTexelSize;    // 1 / texture size
+uniform float uStrength;
+
+const float kPi = 3.14159265;
+
+float intensity(vec2 p, float x, float y)
+{
+    return texture2D(uInputTex, (p + vec2(x, y)) * uTexelSize).r;
+}
+
+void main()
+{
+    vec2 p = floor(gl_FragCoord.xy) + 0.5;
+    float i00 = intensity(p, -1.0, -1.0), i10 = intensity(p, 0.0, -1.0), i20 = intensity(p, 1.0, -1.0);
+    float i01 = intensity(p, -1.0,  0.0),                                 i21 = intensity(p, 1.0,  0.0);
+    float i02 = intensity(p, -1.0,  1.0), i12 = intensity(p, 0.0,  1.0), i22 = intensity(p, 1.0,  1.0);
+
+    float dx = uStrength * ((i20 + 2.0 * i21 + i22) - (i00 + 2.0 * i01 + i02));
+    float dy = uStrength * ((i02 + 2.0 * i12 + i22) - (i00 + 2.0 * i10 + i20));
+    float magnitude = length(vec2(dx, dy));
+    float theta = atan(dy, dx);
+
+#if kFloat0
+    kWrite0(dx);
+#else
+    kWrite0(clamp(dx * 0.5 + 0.5, 0.0, 1.0));
+#endif
+#if kFloat1
+    kWrite1(dy);
+#else
+    kWrite1(clamp(dy * 0.5 + 0.5, 0.0, 1.0));
+#endif
+#if kFloat2
+    kWrite2(magnitude);
+#else
+    kWrite2(clamp(magnitude, 0.0, 1.0));
+#endif
+#if kFloat3
+    kWrite3(theta);
+#else
+    kWrite3((theta + kPi) / (2.0 * kPi));
+#endif
+})";
+
+GradientPlanes::GradientPlanes()
+{
+    for(int i = 0; i < kPlanes; i++)
+    {
+        m_formats[i] = GLTextureFormat::kR32F;
+        m_textures[i] = m_fbos[i] = 0;
+    }
+}
+
+GradientPlanes::~GradientPlanes()
+{
+    release();
+    GLStateCache::get().invalidate(); // our program and texture names can be reused
+}
+
+void GradientPlanes::setFormat(Plane plane, GLTextureFormat::Format format)
+{
+    if(format != m_formats[plane])
+    {
+        release(); // reallocated by the next call
+        m_formats[plane] = format;
+    }
+}
+
+void GradientPlanes::setMultipleRenderTargets(bool enabled)
+{
+    if(enabled != m_mrt)
+    {
+        release();
+        m_mrt = enabled;
+    }
+}
+
+bool GradientPlanes::isMultipleRenderTargets() const
+{
+    const GLCapabilities &caps = GLCapabilities::get();
+    return m_mrt && caps.drawBuffers && caps.maxDrawBuffers >= int(kPlanes);
+}
+
+void GradientPlanes::release()
+{
+    for(int i = 0; i < kPlanes; i++)
+    {
+        if(m_fbos[i])
+        {
+            glDeleteFramebuffers(1, &m_fbos[i]);
+        }
+        if(m_textures[i])
+        {
+            glDeleteTextures(1, &m_textures[i]);
+        }
+        m_textures[i] = m_fbos[i] = 0;
+    }
+    m_size = cv::Size();
+}
+
+void GradientPlanes::allocate(const cv::Size &size)
+{
+    release();
+
+    glGenTextures(kPlanes, m_textures);
+    for(int i = 0; i < kPlanes; i++)
+    {
+        GLTextureFormat::allocate(m_textures[i], size, getFormat(Plane(i)));
+    }
+
+    m_attached = isMultipleRenderTargets();
+    const int fbos = m_attached ? 1 : int(kPlanes);
+    glGenFramebuffers(fbos, m_fbos);
+    for(int i = 0; i < fbos; i++)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_fbos[i]);
+        if(m_attached)
+        {
+#if defined(GL_MAX_DRAW_BUFFERS) && defined(GL_MAX_COLOR_ATTACHMENTS)
+            GLenum buffers[kPlanes];
+            for(int k = 0; k < kPlanes; k++)
+            {
+                buffers[k] = GL_COLOR_ATTACHMENT0 + k;
+                glFramebufferTexture2D(GL_FRAMEBUFFER, buffers[k], GL_TEXTURE_2D, m_textures[k], 0);
+            }
+            glDrawBuffers(kPlanes, buffers);
+#endif
+        }
+        else
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textures[i], 0);
+        }
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            throw std::runtime_error("GradientPlanes: incomplete framebuffer");
+        }
+    }
+
+    m_size = size;
+    GLStateCache::get().invalidate(); // textures and framebuffers bound outside the cache
+}
+
+shader_prog & GradientPlanes::getProgram(int plane)
+{
+    // Multiple render targets need gl_FragData (GL) or GLSL ES 3.00 outputs
+    const bool es3 = (plane < 0) && GLCapabilities::get().es;
+
+    std::stringstream header;
+    if(es3)
+    {
+        header << "#version 300 es\n#define texture2D texture\n";
+    }
+    for(int i = 0; i < kPlanes; i++)
+    {
+        header << "#define kFloat" << i << " " << int(GLTextureFormat::get(getFormat(Plane(i))).isFloat) << "\n";
+        header << "#define kWrite" << i << "(v)";
+        if(es3)
+        {
+            header << " fragData" << i << " = vec4(v, 0.0, 0.0, 1.0)\n";
+            header << "layout(location = " << i << ") out highp vec4 fragData" << i << ";\n";
+        }
+        else if(plane < 0)
+        {
+            header << " gl_FragData[" << i << "] = vec4(v, 0.0, 0.0, 1.0)\n";
+        }
+        else
+        {
+            header << (i == plane ? " gl_FragColor = vec4(v, 0.0, 0.0, 1.0)\n" : "\n");
+        }
+    }
+    const std::string key = header.str();
+
+    auto &program = m_programs[key];
+    if(!program)
+    {
+        std::vector< std::pair<int, const char *> > attributes { { kAttribPosition, "position" } };
+        const GLchar * vShaderStr[] = { es3 ? "#version 300 es\n#define attribute in\n" : "", kVertexShader };
+        const GLchar * fShaderStr[] = { key.c_str(), kFragmentShader };
+        program = make_unique<shader_prog>(vShaderStr, fShaderStr, attributes);
+    }
+    return *program;
+}
+
+void GradientPlanes::operator()(GLuint texture, const cv::Size &size)
+{
+    GLint viewport[4], framebuffer = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    if(size != m_size)
+    {
+        allocate(size);
+    }
+
+    GLStateCache &gl = GLStateCache::get();
+    GATHERER_GL_READ(texture);
+    gl.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+    gl.viewport(0, 0, size.width, size.height);
+    gl.bindArrayBuffer(gl.getQuadBuffer());
+    glVertexAttribPointer(kAttribPosition, 2, GL_FLOAT, 0, 0, (const GLvoid *)GLStateCache::getQuadOffset(GLStateCache::kClipQuad));
+    gl.enableVertexAttribArray(kAttribPosition);
+
+    m_passes = m_attached ? 1 : int(kPlanes);
+    for(int pass = 0; pass < m_passes; pass++)
+    {
+        shader_prog &program = getProgram(m_attached ? -1 : pass);
+        gl.useProgram(program);
+        glUniform2f(program.GetUniformLocation("uTexelSize"), 1.f / float(size.width), 1.f / float(size.height));
+        glUniform1f(program.GetUniformLocation("uStrength"), m_strength);
+        glUniform1i(program.GetUniformLocation("uInputTex"), 0);
+        gl.bindFramebuffer(m_fbos[pass]);
+        gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    // ogles_gpgpu streams vertices from client memory
+    gl.bindArrayBuffer(0);
+
+    gl.bindFramebuffer(framebuffer);
+    gl.viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    for(int i = 0; i < kPlanes; i++)
+    {
+        GATHERER_GL_WRITTEN(m_textures[i]);
+    }
+}
+
+void GradientPlanes::read(Plane plane, cv::Mat &image)
+{
+    if(m_size.area() == 0)
+    {
+        throw std::runtime_error("GradientPlanes: nothing to read");
+    }
+
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    GLStateCache &gl = GLStateCache::get();
+    GATHERER_GL_READ(m_textures[plane]);
+    gl.bindFramebuffer(m_fbos[m_attached ? 0 : int(plane)]);
+#if defined(GL_MAX_DRAW_BUFFERS) && defined(GL_MAX_COLOR_ATTACHMENTS)
+    if(m_attached)
+    {
+        glReadBuffer(GL_COLOR_ATTACHMENT0 + plane);
+    }
+#endif
+    GLTextureFormat::read(m_size, getFormat(plane), image);
+#if defined(GL_MAX_DRAW_BUFFERS) && defined(GL_MAX_COLOR_ATTACHMENTS)
+    if(m_attached)
+    {
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+#endif
+    gl.bindFramebuffer(framebuffer);
+}
+
+_GATHERER_GRAPHICS_END
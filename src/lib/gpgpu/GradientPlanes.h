@@ -0,0 +1,114 @@
+//
+//  GradientPlanes.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__GradientPlanes__
+#define __gatherer__gpgpu__GradientPlanes__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLSLShaderProgram.h"
+#include "graphics/GLTextureFormat.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class GradientPlanes
+ *
+ * \brief 3x3 Sobel gradient with dx, dy, magnitude and orientation in separate textures
+ *
+ * ogles_gpgpu::GradProc packs the four quantities into one RGBA8 texture.
+ * Here each one is a plane of its own format, written by a single draw to
+ * four render targets, so a consumer binds just the planes it needs:
+ *
+ * @code
+ *
+ * using gatherer::graphics::GradientPlanes;
+ * GradientPlanes grad;
+ * grad.setFormat(GradientPlanes::kOrientation, gatherer::graphics::GLTextureFormat::kR8);
+ * grad(grayscaleProc.getOutputTexId(), size);    // gradient of channel 0
+ * GLuint dx = grad.getTexId(GradientPlanes::kDx), dy = grad.getTexId(GradientPlanes::kDy);
+ *
+ * @endcode
+ *
+ * Float planes (the default, R32F) store the values themselves, with
+ * intensities normalized to [0,1]:
+ * - kDx, kDy: strength * Sobel response, in [-4,4] * strength.
+ * - kMagnitude: sqrt(dx^2 + dy^2).
+ * - kOrientation: atan2(dy, dx) in radians.
+ *
+ * 8 bit planes (kR8, or RGBA8 when a format isn't renderable) use the
+ * GradProc encoding: clamp(0.5 + dx / 2), clamp(magnitude) and
+ * (atan2(dy, dx) + pi) / (2 * pi).  The value is in the red channel.
+ *
+ * Without multiple render targets (GLES 2.0) every plane takes a pass of
+ * its own.
+ */
+
+class GradientPlanes
+{
+public:
+
+    enum Plane
+    {
+        kDx,
+        kDy,
+        kMagnitude,
+        kOrientation,
+        kPlanes
+    };
+
+    GradientPlanes();
+    ~GradientPlanes();
+
+    void setStrength(float strength) { m_strength = strength; }
+    float getStrength() const { return m_strength; }
+
+    /// Format of a plane, applied by the next call (getFormat() is RGBA8 if it isn't renderable)
+    void setFormat(Plane plane, GLTextureFormat::Format format);
+    GLTextureFormat::Format getFormat(Plane plane) const { return GLTextureFormat::resolve(m_formats[plane]); }
+
+    /// Draw all planes at once when the context supports it (default), else one pass per plane
+    void setMultipleRenderTargets(bool enabled);
+
+    /// Gradient of channel 0 of a texture
+    void operator()(GLuint texture, const cv::Size &size);
+
+    GLuint getTexId(Plane plane) const { return m_textures[plane]; }
+    const cv::Size & getSize() const { return m_size; }
+
+    /// Draw calls of the last call: 1 with multiple render targets
+    int getPasses() const { return m_passes; }
+
+    /// Read back a plane in the layout of its format (CV_32FC1 for R32F, ...)
+    void read(Plane plane, cv::Mat &image);
+
+protected:
+
+    bool isMultipleRenderTargets() const;
+    shader_prog & getProgram(int plane);    // plane < 0 writes all planes
+    void allocate(const cv::Size &size);
+    void release();
+
+    std::map<std::string, std::unique_ptr<shader_prog>> m_programs; // by header
+
+    GLTextureFormat::Format m_formats[kPlanes];   // as requested
+    float m_strength = 1.f;
+    bool m_mrt = true;
+    bool m_attached = false;                // all planes attached to m_fbos[0]
+    int m_passes = 0;
+
+    cv::Size m_size;
+    GLuint m_textures[kPlanes];
+    GLuint m_fbos[kPlanes];                 // one per plane without multiple render targets
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__GradientPlanes__) */
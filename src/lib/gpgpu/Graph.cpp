@@ -0,0 +1,232 @@
+//
+//  Graph.cpp
+//  gatherer
+//
+
+#include "gpgpu/Graph.h"
+
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+Graph::Graph(const GraphDescription &description, const ProcFactory &factory)
+: m_description(description)
+{
+    const auto &nodes = m_description.nodes;
+
+    std::map<std::string, int> index;
+    for(int i = 0; i < int(nodes.size()); i++)
+    {
+        if(nodes[i].name == GraphDescription::kInput || !index.insert({ nodes[i].name, i }).second)
+        {
+            throw std::runtime_error("Graph: invalid or duplicate node name " + nodes[i].name);
+        }
+        if(nodes[i].inputs.empty())
+        {
+            throw std::runtime_error("Graph: node " + nodes[i].name + " has no input");
+        }
+    }
+
+    // Depth first topological sort, so every input precedes its consumers
+    std::vector<int> order, state(nodes.size(), 0);
+    std::function<void(int)> visit = [&](int i)
+    {
+        if(state[i] == 2)
+        {
+            return;
+        }
+        if(state[i] == 1)
+        {
+            throw std::runtime_error("Graph: cycle through node " + nodes[i].name);
+        }
+        state[i] = 1;
+        for(const auto &input : nodes[i].inputs)
+        {
+            if(input != GraphDescription::kInput)
+            {
+                auto iter = index.find(input);
+                if(iter == index.end())
+                {
+                    throw std::runtime_error("Graph: unknown input " + input + " for node " + nodes[i].name);
+                }
+                visit(iter->second);
+            }
+        }
+        state[i] = 2;
+        order.push_back(i);
+    };
+    for(int i = 0; i < int(nodes.size()); i++)
+    {
+        visit(i);
+    }
+
+    m_nodes.resize(order.size());
+    for(int k = 0; k < int(order.size()); k++)
+    {
+        m_nodes[k].description = nodes[order[k]];
+        index[nodes[order[k]].name] = k;
+    }
+
+    for(auto &node : m_nodes)
+    {
+        for(const auto &input : node.description.inputs)
+        {
+            node.inputs.push_back((input == GraphDescription::kInput) ? -1 : index[input]);
+        }
+        node.proc = factory.create(node.description);
+    }
+}
+
+Graph::~Graph()
+{
+
+}
+
+const Graph::Node & Graph::at(const std::string &name) const
+{
+    for(const auto &node : m_nodes)
+    {
+        if(node.description.name == name)
+        {
+            return node;
+        }
+    }
+    throw std::runtime_error("Graph: unknown node " + name);
+}
+
+Graph::Node & Graph::at(const std::string &name)
+{
+    return const_cast<Node &>(static_cast<const Graph &>(*this).at(name));
+}
+
+void Graph::setDisplay(const std::string &name)
+{
+    m_display = name.empty() ? -1 : int(&at(name) - &m_nodes.front());
+}
+
+GLuint Graph::getDisplayTexId() const
+{
+    return (m_display < 0) ? 0 : m_nodes[m_display].proc->getOutputTexId();
+}
+
+void Graph::setHandler(const std::string &name, const Handler &handler)
+{
+    at(name).handler = handler;
+}
+
+void Graph::request(const std::string &name)
+{
+    at(name).requested = true;
+}
+
+ogles_gpgpu::ProcInterface * Graph::getProc(const std::string &name) const
+{
+    return at(name).proc.get();
+}
+
+GLuint Graph::getOutputTexId(const std::string &name) const
+{
+    return at(name).proc->getOutputTexId();
+}
+
+bool Graph::isRendered(const std::string &name) const
+{
+    return at(name).rendered;
+}
+
+size_t Graph::getRenderCount() const
+{
+    size_t count = 0;
+    for(const auto &node : m_nodes)
+    {
+        count += node.rendered;
+    }
+    return count;
+}
+
+void Graph::prepare(Node &node, int order, int width, int height, bool externalInput)
+{
+    // Procs are initialized on first use, so branches that are never consumed allocate nothing
+    if(!node.initialized)
+    {
+        node.proc->init(width, height, order, externalInput);
+        node.proc->createFBOTex(false);
+        node.initialized = true;
+    }
+    else if(width != node.inputWidth || height != node.inputHeight)
+    {
+        node.proc->reinit(width, height, externalInput);
+        node.proc->createFBOTex(false);
+    }
+    node.inputWidth = width;
+    node.inputHeight = height;
+}
+
+void Graph::process(GLuint inputTexId, int width, int height, GLenum inputTarget)
+{
+    // Mark the consumed nodes, then everything upstream of them (inputs precede consumers)
+    for(int k = int(m_nodes.size()) - 1; k >= 0; k--)
+    {
+        Node &node = m_nodes[k];
+        node.needed = node.needed || node.requested || bool(node.handler) || (k == m_display);
+        if(node.needed)
+        {
+            for(int input : node.inputs)
+            {
+                if(input >= 0)
+                {
+                    m_nodes[input].needed = true;
+                }
+            }
+        }
+    }
+
+    for(int k = 0; k < int(m_nodes.size()); k++)
+    {
+        Node &node = m_nodes[k];
+        node.rendered = false;
+        if(!node.needed)
+        {
+            continue;
+        }
+
+        const int source = node.inputs.front();
+        if(source < 0)
+        {
+            prepare(node, k, width, height, inputTarget != GL_TEXTURE_2D);
+        }
+        else
+        {
+            const auto &proc = m_nodes[source].proc;
+            prepare(node, k, proc->getOutFrameW(), proc->getOutFrameH(), false);
+        }
+
+        for(int position = 0; position < int(node.inputs.size()); position++)
+        {
+            const int input = node.inputs[position];
+            if(input < 0)
+            {
+                node.proc->useTexture(inputTexId, 1 + position, inputTarget, position);
+            }
+            else
+            {
+                node.proc->useTexture(m_nodes[input].proc->getOutputTexId(), 1 + position, GL_TEXTURE_2D, position);
+            }
+        }
+
+        node.proc->render(0);
+        node.rendered = true;
+    }
+
+    for(auto &node : m_nodes)
+    {
+        if(node.rendered && node.handler)
+        {
+            node.handler(*node.proc);
+        }
+        node.requested = false;
+        node.needed = false;
+    }
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,114 @@
+//
+//  Graph.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__Graph__
+#define __gatherer__gpgpu__Graph__
+
+#include "graphics/gatherer_graphics.h"
+#include "gpgpu/GraphDescription.h"
+#include "gpgpu/ProcFactory.h"
+
+#include "ogles_gpgpu/common/proc/base/procinterface.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class Graph
+ *
+ * \brief Proc graph built from a GraphDescription, rendered on demand
+ *
+ * The graph drives its procs itself instead of chaining them with add(), so
+ * a frame renders only the nodes that something consumes: the display
+ * node, nodes with an active handler and nodes requested for readback,
+ * together with everything upstream of them.  Idle branches cost nothing,
+ * and analysis stages are switched at runtime by setting or clearing their
+ * handlers:
+ *
+ * @code
+ *
+ * gatherer::graphics::GraphDescription description;
+ * description.add("gray", "grayscale", { "input" })
+ *            .add("grad", "grad", { "gray" })
+ *            .add("lbp", "lbp", { "gray" });
+ *
+ * gatherer::graphics::Graph graph(description);
+ * graph.setDisplay("grad");
+ * graph.setHandler("lbp", [&](ogles_gpgpu::ProcInterface &proc) { ... });
+ *
+ * graph.process(inputTexId, width, height);  // gray, grad and lbp
+ * graph.setHandler("lbp", nullptr);
+ * graph.process(inputTexId, width, height);  // gray and grad
+ *
+ * @endcode
+ *
+ * Outputs of nodes that were skipped keep the texture of the last frame
+ * that rendered them.
+ */
+
+class Graph
+{
+public:
+
+    using Handler = std::function<void(ogles_gpgpu::ProcInterface &proc)>;
+
+    explicit Graph(const GraphDescription &description, const ProcFactory &factory = ProcFactory());
+    ~Graph();
+
+    /// Node whose output texture is presented every frame (empty for none)
+    void setDisplay(const std::string &name);
+    GLuint getDisplayTexId() const;
+
+    /// Called with the proc after every frame that rendered it; an empty handler removes it
+    void setHandler(const std::string &name, const Handler &handler);
+
+    /// Render the node on the next frame only (e.g. before getResultData())
+    void request(const std::string &name);
+
+    /// Render the nodes required this frame from the given input texture
+    void process(GLuint inputTexId, int width, int height, GLenum inputTarget = GL_TEXTURE_2D);
+
+    ogles_gpgpu::ProcInterface * getProc(const std::string &name) const;
+    GLuint getOutputTexId(const std::string &name) const;
+
+    /// True if the node was rendered by the last process() call
+    bool isRendered(const std::string &name) const;
+    size_t getRenderCount() const;
+
+    const GraphDescription & getDescription() const { return m_description; }
+
+protected:
+
+    struct Node
+    {
+        NodeDescription description;
+        std::unique_ptr<ogles_gpgpu::ProcInterface> proc;
+        std::vector<int> inputs;    // node index per position, -1 for the frame input
+        Handler handler;
+        bool requested = false;
+        bool needed = false;
+        bool rendered = false;
+        bool initialized = false;
+        int inputWidth = 0;
+        int inputHeight = 0;
+    };
+
+    const Node & at(const std::string &name) const;
+    Node & at(const std::string &name);
+    void prepare(Node &node, int order, int width, int height, bool externalInput);
+
+    GraphDescription m_description;
+    std::vector<Node> m_nodes;  // topological order
+    int m_display = -1;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__Graph__) */
@@ -0,0 +1,46 @@
+//
+//  GraphDescription.cpp
+//  gatherer
+//
+
+#include "gpgpu/GraphDescription.h"
+
+#include <cereal/archives/json.hpp>
+
+#include <cstdlib>
+
+_GATHERER_GRAPHICS_BEGIN
+
+float NodeDescription::getFloat(const std::string &key, float value) const
+{
+    auto iter = parameters.find(key);
+    return (iter == parameters.end()) ? value : float(std::atof(iter->second.c_str()));
+}
+
+std::string NodeDescription::getString(const std::string &key, const std::string &value) const
+{
+    auto iter = parameters.find(key);
+    return (iter == parameters.end()) ? value : iter->second;
+}
+
+const char *GraphDescription::kInput = "input";
+
+GraphDescription & GraphDescription::add(const std::string &name, const std::string &type, const std::vector<std::string> &inputs, const std::map<std::string, std::string> &parameters)
+{
+    nodes.push_back({ name, type, inputs, parameters });
+    return *this;
+}
+
+void GraphDescription::load(std::istream &is)
+{
+    cereal::JSONInputArchive ar(is);
+    ar(cereal::make_nvp("graph", *this));
+}
+
+void GraphDescription::save(std::ostream &os) const
+{
+    cereal::JSONOutputArchive ar(os);
+    ar(cereal::make_nvp("graph", *this));
+}
+
+_GATHERER_GRAPHICS_END
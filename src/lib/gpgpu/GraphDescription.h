@@ -0,0 +1,77 @@
+//
+//  GraphDescription.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__GraphDescription__
+#define __gatherer__gpgpu__GraphDescription__
+
+#include "graphics/gatherer_graphics.h"
+
+#include <cereal/cereal.hpp>
+#include <cereal/types/map.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/// One proc of a pipeline graph
+struct NodeDescription
+{
+    std::string name;                               // unique within the graph
+    std::string type;                               // ProcFactory key, e.g. "grayscale"
+    std::vector<std::string> inputs;                // upstream node per input position, "input" for the frame
+    std::map<std::string, std::string> parameters;  // type specific settings
+
+    float getFloat(const std::string &key, float value) const;
+    std::string getString(const std::string &key, const std::string &value) const;
+
+    template <class Archive>
+    void serialize(Archive &ar)
+    {
+        ar(CEREAL_NVP(name), CEREAL_NVP(type), CEREAL_NVP(inputs), CEREAL_NVP(parameters));
+    }
+};
+
+/**
+ * \struct GraphDescription
+ *
+ * \brief Declarative description of a proc graph, as JSON:
+ *
+ * @code
+ * { "graph": { "nodes": [
+ *     { "name": "gray", "type": "grayscale", "inputs": ["input"], "parameters": {} },
+ *     { "name": "grad", "type": "grad", "inputs": ["gray"], "parameters": {} },
+ *     { "name": "lbp", "type": "lbp", "inputs": ["gray"], "parameters": {} }
+ * ] } }
+ * @endcode
+ *
+ * Instantiated by Graph through a ProcFactory.
+ */
+
+struct GraphDescription
+{
+    static const char *kInput; // name of the frame input
+
+    std::vector<NodeDescription> nodes;
+
+    GraphDescription & add(const std::string &name, const std::string &type, const std::vector<std::string> &inputs, const std::map<std::string, std::string> &parameters = {});
+
+    void load(std::istream &is);
+    void save(std::ostream &os) const;
+
+    template <class Archive>
+    void serialize(Archive &ar)
+    {
+        ar(CEREAL_NVP(nodes));
+    }
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__GraphDescription__) */
@@ -0,0 +1,400 @@
+//
+//  KeypointCompactor.cpp
+//  gatherer
+//
+
+#include "gpgpu/KeypointCompactor.h"
+#include "graphics/GLExtra.h"
+#include "graphics/GLStateCache.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+enum { kAttribPosition };
+
+static const char *kVertexShader = R"(
+attribute vec4 position;
+void main()
+{
+    gl_Position = position;
+})";
+
+// Counts are integers up to 2^24 (4096x4096) stored as four bytes
+#define GATHERER_COMPACTOR_HEADER \
+"#ifdef GL_ES\n" \
+"precision highp float;\n" \
+"#endif\n" \
+"float decode(vec4 t)\n" \
+"{\n" \
+"    vec4 b = floor(t * 255.0 + 0.5);\n" \
+"    return b.r + b.g * 256.0 + b.b * 65536.0 + b.a * 16777216.0;\n" \
+"}\n" \
+"vec4 encode(float c)\n" \
+"{\n" \
+"    float a = floor(c / 16777216.0);\n" \
+"    c -= a * 16777216.0;\n" \
+"    float b = floor(c / 65536.0);\n" \
+"    c -= b * 65536.0;\n" \
+"    float g = floor(c / 256.0);\n" \
+"    return vec4(c - g * 256.0, g, b, a) / 255.0;\n" \
+"}\n"
+
+// Level 1 from the input: number of non-zero texels in each 2x2 block
+static const char *kReduceInputShader = GATHERER_COMPACTOR_HEADER R"(
+uniform sampler2D uInputTex;
+uniform vec2 uInputSize;
+uniform vec2 uDstOffset;
+float flag(vec2 p)
+{
+    if(p.x >= uInputSize.x || p.y >= uInputSize.y)
+    {
+        return 0.0;
+    }
+    return step(0.5 / 255.0, texture2D(uInputTex, (p + 0.5) / uInputSize).r);
+}
+void main()
+{
+    vec2 p = 2.0 * floor(gl_FragCoord.xy - uDstOffset);
+    gl_FragColor = encode(flag(p) + flag(p + vec2(1.0, 0.0)) + flag(p + vec2(0.0, 1.0)) + flag(p + vec2(1.0, 1.0)));
+})";
+
+// Level k from level k - 1 (which lives in the other atlas)
+static const char *kReduceLevelShader = GATHERER_COMPACTOR_HEADER R"(
+uniform sampler2D uLevelTex;
+uniform vec2 uLevelTexSize;
+uniform vec2 uSrcOffset;
+uniform vec2 uDstOffset;
+float count(vec2 p)
+{
+    return decode(texture2D(uLevelTex, (uSrcOffset + p + 0.5) / uLevelTexSize));
+}
+void main()
+{
+    vec2 p = 2.0 * floor(gl_FragCoord.xy - uDstOffset);
+    gl_FragColor = encode(count(p) + count(p + vec2(1.0, 0.0)) + count(p + vec2(0.0, 1.0)) + count(p + vec2(1.0, 1.0)));
+})";
+
+// Output texel i finds feature key(i) by walking down from the 1x1 level
+static const char *kTraverseShader = GATHERER_COMPACTOR_HEADER R"(
+uniform sampler2D uInputTex;
+uniform vec2 uInputSize;
+uniform sampler2D uAtlas0;
+uniform sampler2D uAtlas1;
+uniform vec2 uAtlasSize0;
+uniform vec2 uAtlasSize1;
+uniform vec3 uLevel[12];
+uniform float uLevels;
+uniform float uTotal;
+uniform float uCount;
+float fetch(vec3 level, vec2 p)
+{
+    vec2 q = level.xy + p + 0.5;
+    return decode((level.z < 0.5) ? texture2D(uAtlas0, q / uAtlasSize0) : texture2D(uAtlas1, q / uAtlasSize1));
+}
+float flag(vec2 p)
+{
+    if(p.x >= uInputSize.x || p.y >= uInputSize.y)
+    {
+        return 0.0;
+    }
+    return step(0.5 / 255.0, texture2D(uInputTex, (p + 0.5) / uInputSize).r);
+}
+vec2 descend(inout float key, vec2 c, float c0, float c1, float c2)
+{
+    if(key < c0)
+    {
+        return c;
+    }
+    key -= c0;
+    if(key < c1)
+    {
+        return c + vec2(1.0, 0.0);
+    }
+    key -= c1;
+    if(key < c2)
+    {
+        return c + vec2(0.0, 1.0);
+    }
+    key -= c2;
+    return c + vec2(1.0, 1.0);
+}
+void main()
+{
+    vec2 q = floor(gl_FragCoord.xy);
+    float index = q.y * 256.0 + q.x;
+    if(index >= uCount)
+    {
+        gl_FragColor = vec4(0.0);
+        return;
+    }
+
+    float key = min(floor(index * (uTotal / uCount)), uTotal - 1.0);
+    vec2 p = vec2(0.0);
+    for(int k = 11; k >= 1; k--)
+    {
+        if(float(k) < uLevels)
+        {
+            vec3 level = uLevel[k];
+            vec2 c = 2.0 * p;
+            p = descend(key, c, fetch(level, c), fetch(level, c + vec2(1.0, 0.0)), fetch(level, c + vec2(0.0, 1.0)));
+        }
+    }
+    vec2 c = 2.0 * p;
+    p = descend(key, c, flag(c), flag(c + vec2(1.0, 0.0)), flag(c + vec2(0.0, 1.0)));
+
+    // x and y in 12 bits each, score in 8 bits
+    float score = texture2D(uInputTex, (p + 0.5) / uInputSize).r;
+    vec2 high = floor(p / 256.0);
+    gl_FragColor = vec4(p.x - high.x * 256.0, high.x + high.y * 16.0, p.y - high.y * 256.0, floor(score * 255.0 + 0.5)) / 255.0;
+})";
+
+KeypointCompactor::KeypointCompactor(int maxCount)
+{
+    setMaxCount(maxCount);
+    compileShaders();
+}
+
+KeypointCompactor::~KeypointCompactor()
+{
+    releaseTarget(m_atlas[0]);
+    releaseTarget(m_atlas[1]);
+    releaseTarget(m_output);
+}
+
+void KeypointCompactor::setMaxCount(int count)
+{
+    if(count <= 0)
+    {
+        throw std::invalid_argument("KeypointCompactor: maximum count must be positive");
+    }
+    m_maxCount = count;
+}
+
+void KeypointCompactor::compileShaders()
+{
+    std::vector< std::pair<int, const char *> > attributes { { kAttribPosition, "position" } };
+    const GLchar * vShaderStr[] = { kVertexShader };
+
+    const GLchar * reduceInputStr[] = { kReduceInputShader };
+    m_reduceInput = make_unique<shader_prog>(vShaderStr, reduceInputStr, attributes);
+
+    const GLchar * reduceLevelStr[] = { kReduceLevelShader };
+    m_reduceLevel = make_unique<shader_prog>(vShaderStr, reduceLevelStr, attributes);
+
+    const GLchar * traverseStr[] = { kTraverseShader };
+    m_traverse = make_unique<shader_prog>(vShaderStr, traverseStr, attributes);
+}
+
+void KeypointCompactor::createTarget(Target &target, const cv::Size &size)
+{
+    releaseTarget(target);
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.width, size.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+    glGenFramebuffers(1, &target.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("KeypointCompactor: incomplete framebuffer");
+    }
+    target.size = size;
+}
+
+void KeypointCompactor::releaseTarget(Target &target)
+{
+    if(target.fbo)
+    {
+        glDeleteFramebuffers(1, &target.fbo);
+    }
+    if(target.texture)
+    {
+        glDeleteTextures(1, &target.texture);
+    }
+    target = Target();
+    GLStateCache::get().invalidate(); // the names can be reused
+}
+
+void KeypointCompactor::allocate(int width, int height)
+{
+    if(width > 4096 || height > 4096)
+    {
+        throw std::runtime_error("KeypointCompactor: input larger than 4096x4096");
+    }
+
+    int side = 2, levels = 1;
+    while(side < std::max(width, height))
+    {
+        side *= 2;
+        levels++;
+    }
+
+    // Odd levels go to atlas 0 and even levels to atlas 1, so each reduction
+    // reads one texture and writes the other: the largest level of an atlas
+    // sits at the origin and the smaller ones are stacked to its right.
+    m_layout.assign(levels + 1, Level());
+    cv::Size atlasSize[2] = { cv::Size(1, 1), cv::Size(1, 1) };
+    int stacked[2] = { 0, 0 };
+    for(int k = 1; k <= levels; k++)
+    {
+        Level &level = m_layout[k];
+        level.atlas = (k % 2) ? 0 : 1;
+        level.size = side >> k;
+        if(k <= 2)
+        {
+            level.offset = cv::Point(0, 0);
+        }
+        else
+        {
+            level.offset = cv::Point(m_layout[level.atlas + 1].size, stacked[level.atlas]);
+            stacked[level.atlas] += level.size;
+        }
+
+        cv::Size &size = atlasSize[level.atlas];
+        size.width = std::max(size.width, level.offset.x + level.size);
+        size.height = std::max(size.height, level.offset.y + level.size);
+    }
+
+    for(int i = 0; i < 2; i++)
+    {
+        createTarget(m_atlas[i], atlasSize[i]);
+    }
+    createTarget(m_output, cv::Size(kRowWidth, (m_maxCount + kRowWidth - 1) / kRowWidth));
+
+    m_levels = levels;
+    m_inputSize = cv::Size(width, height);
+}
+
+void KeypointCompactor::render(const Target &target, const cv::Rect &viewport)
+{
+    static const GLfloat quad[] = { -1.f, -1.f, 1.f, -1.f, -1.f, 1.f, 1.f, 1.f };
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glViewport(viewport.x, viewport.y, viewport.width, viewport.height);
+    glVertexAttribPointer(kAttribPosition, 2, GL_FLOAT, GL_FALSE, 0, quad);
+    glEnableVertexAttribArray(kAttribPosition);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void KeypointCompactor::operator()(GLuint texture, int width, int height)
+{
+    const int outputRows = (m_maxCount + kRowWidth - 1) / kRowWidth;
+    if(m_inputSize != cv::Size(width, height) || m_output.size.height != outputRows)
+    {
+        allocate(width, height);
+    }
+
+    GLint viewport[4], framebuffer = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // ### Reduction ###
+    (*m_reduceInput)();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(m_reduceInput->GetUniformLocation("uInputTex"), 0);
+    glUniform2f(m_reduceInput->GetUniformLocation("uInputSize"), float(width), float(height));
+    glUniform2f(m_reduceInput->GetUniformLocation("uDstOffset"), 0.f, 0.f);
+    render(m_atlas[0], cv::Rect(m_layout[1].offset, cv::Size(m_layout[1].size, m_layout[1].size)));
+
+    (*m_reduceLevel)();
+    glUniform1i(m_reduceLevel->GetUniformLocation("uLevelTex"), 0);
+    for(int k = 2; k <= m_levels; k++)
+    {
+        const Level &src = m_layout[k - 1], &dst = m_layout[k];
+        const Target &srcAtlas = m_atlas[src.atlas];
+        glBindTexture(GL_TEXTURE_2D, srcAtlas.texture);
+        glUniform2f(m_reduceLevel->GetUniformLocation("uLevelTexSize"), float(srcAtlas.size.width), float(srcAtlas.size.height));
+        glUniform2f(m_reduceLevel->GetUniformLocation("uSrcOffset"), float(src.offset.x), float(src.offset.y));
+        glUniform2f(m_reduceLevel->GetUniformLocation("uDstOffset"), float(dst.offset.x), float(dst.offset.y));
+        render(m_atlas[dst.atlas], cv::Rect(dst.offset, cv::Size(dst.size, dst.size)));
+    }
+
+    // ### Total count (one texel) ###
+    const Level &top = m_layout[m_levels];
+    uint8_t count[4] = { 0, 0, 0, 0 };
+    glBindFramebuffer(GL_FRAMEBUFFER, m_atlas[top.atlas].fbo);
+    glReadPixels(top.offset.x, top.offset.y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, count);
+    m_total = int(count[0]) + (int(count[1]) << 8) + (int(count[2]) << 16) + (int(count[3]) << 24);
+    m_readbackSize = sizeof(count);
+
+    m_keypoints.clear();
+    const int n = std::min(m_total, m_maxCount);
+    if(n > 0)
+    {
+        // ### Traversal ###
+        (*m_traverse)();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, m_atlas[0].texture);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, m_atlas[1].texture);
+
+        GLfloat levels[kMaxLevels * 3] = { 0.f };
+        for(int k = 1; k < m_levels; k++)
+        {
+            levels[k * 3 + 0] = float(m_layout[k].offset.x);
+            levels[k * 3 + 1] = float(m_layout[k].offset.y);
+            levels[k * 3 + 2] = float(m_layout[k].atlas);
+        }
+
+        glUniform1i(m_traverse->GetUniformLocation("uInputTex"), 0);
+        glUniform1i(m_traverse->GetUniformLocation("uAtlas0"), 1);
+        glUniform1i(m_traverse->GetUniformLocation("uAtlas1"), 2);
+        glUniform2f(m_traverse->GetUniformLocation("uInputSize"), float(width), float(height));
+        glUniform2f(m_traverse->GetUniformLocation("uAtlasSize0"), float(m_atlas[0].size.width), float(m_atlas[0].size.height));
+        glUniform2f(m_traverse->GetUniformLocation("uAtlasSize1"), float(m_atlas[1].size.width), float(m_atlas[1].size.height));
+        glUniform3fv(m_traverse->GetUniformLocation("uLevel"), kMaxLevels, levels);
+        glUniform1f(m_traverse->GetUniformLocation("uLevels"), float(m_levels));
+        glUniform1f(m_traverse->GetUniformLocation("uTotal"), float(m_total));
+        glUniform1f(m_traverse->GetUniformLocation("uCount"), float(n));
+
+        const cv::Size region(std::min(n, int(kRowWidth)), (n + kRowWidth - 1) / kRowWidth);
+        render(m_output, cv::Rect(cv::Point(0, 0), region));
+        glActiveTexture(GL_TEXTURE0);
+
+        // ### Readback of the list only ###
+        m_packed.resize(region.area() * 4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, region.width, region.height, GL_RGBA, GL_UNSIGNED_BYTE, m_packed.data());
+        m_readbackSize += m_packed.size();
+
+        std::vector<int> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        if(m_topK > 0 && m_topK < n)
+        {
+            const uint8_t *packed = m_packed.data();
+            std::partial_sort(order.begin(), order.begin() + m_topK, order.end(), [&](int a, int b)
+            {
+                return (packed[a * 4 + 3] > packed[b * 4 + 3]) || (packed[a * 4 + 3] == packed[b * 4 + 3] && a < b);
+            });
+            order.resize(m_topK);
+        }
+
+        m_keypoints.reserve(order.size());
+        for(int i : order)
+        {
+            const uint8_t *texel = &m_packed[i * 4];
+            const int x = texel[0] + ((texel[1] & 0xf) << 8);
+            const int y = texel[2] + ((texel[1] >> 4) << 8);
+            m_keypoints.push_back(float(x), float(y), float(texel[3]) / 255.f);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLStateCache::get().invalidate(); // bound outside the cache
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,121 @@
+//
+//  KeypointCompactor.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__KeypointCompactor__
+#define __gatherer__gpgpu__KeypointCompactor__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLSLShaderProgram.h"
+#include "cpu/Keypoints.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class KeypointCompactor
+ *
+ * \brief Histogram pyramid stream compaction of a sparse feature texture
+ *
+ * Turns a mostly black texture such as the NmsProc output into a list of
+ * (x, y, score) for the texels with a non-zero red channel, so only the
+ * list is read back instead of the whole image:
+ *
+ * @code
+ *
+ * gatherer::graphics::KeypointCompactor compactor(1024);
+ * compactor(nmsProc.getOutputTexId(), nmsProc.getOutFrameW(), nmsProc.getOutFrameH());
+ * const auto &keypoints = compactor.getKeypoints();
+ *
+ * @endcode
+ *
+ * The reduction levels (2x2 sums, counts packed in RGBA8) are built
+ * with one fragment pass each; a single traversal pass then writes one packed
+ * RGBA8 texel per feature.  Readback is 4 bytes for the total plus 4 bytes per
+ * feature, in quadtree order.
+ *
+ * When there are more features than the maximum count an evenly spaced
+ * subset of them is kept; top-K then selects the highest scores within that
+ * subset.  Runs on OpenGL ES 2.0 but needs highp fragment precision.
+ * Input textures are limited to 4096x4096.
+ */
+
+class KeypointCompactor
+{
+public:
+
+    explicit KeypointCompactor(int maxCount = 4096);
+    ~KeypointCompactor();
+
+    void setMaxCount(int count);
+    int getMaxCount() const { return m_maxCount; }
+
+    /// Keep only the K highest scores (0 for all).  With more features than
+    /// the maximum count the scores come from the evenly spaced subset, so
+    /// this is approximate: raise the maximum count for the exact top K.
+    void setTopK(int k) { m_topK = k; }
+    int getTopK() const { return m_topK; }
+
+    /// Compact the non-zero texels of a width x height GL_TEXTURE_2D
+    void operator()(GLuint texture, int width, int height);
+
+    const cpu::Keypoints & getKeypoints() const { return m_keypoints; }
+
+    /// Number of non-zero texels in the last input (may exceed the maximum count)
+    int getTotalCount() const { return m_total; }
+
+    /// Bytes read back by the last call
+    size_t getReadbackSize() const { return m_readbackSize; }
+
+protected:
+
+    enum { kMaxLevels = 12, kRowWidth = 256 };
+
+    struct Target
+    {
+        GLuint texture = 0;
+        GLuint fbo = 0;
+        cv::Size size;
+    };
+
+    struct Level
+    {
+        int atlas;          // 0: odd levels, 1: even levels
+        cv::Point offset;   // texel offset within the atlas
+        int size;
+    };
+
+    void compileShaders();
+    void allocate(int width, int height);
+    void render(const Target &target, const cv::Rect &viewport);
+
+    void createTarget(Target &target, const cv::Size &size);
+    void releaseTarget(Target &target);
+
+    int m_maxCount = 0;
+    int m_topK = 0;
+
+    cv::Size m_inputSize;
+    int m_levels = 0;                   // reduction levels 1..m_levels, the last one is 1x1
+    std::vector<Level> m_layout;        // indexed by level
+    Target m_atlas[2];
+    Target m_output;
+
+    std::unique_ptr<shader_prog> m_reduceInput;
+    std::unique_ptr<shader_prog> m_reduceLevel;
+    std::unique_ptr<shader_prog> m_traverse;
+
+    cpu::Keypoints m_keypoints;
+    std::vector<uint8_t> m_packed;
+    int m_total = 0;
+    size_t m_readbackSize = 0;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__KeypointCompactor__) */
@@ -0,0 +1,364 @@
+//
+//  LucasKanadeTracker.cpp
+//  gatherer
+//
+
+#include "gpgpu/LucasKanadeTracker.h"
+#include "graphics/GLExtra.h"
+#include "graphics/GLStateCache.h"
+
+#include <sstream>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+enum { kAttribPosition, kAttribPoint };
+
+// Per vertex: output texel (clip space), point (level 0 pixels)
+enum { kVertexFloats = 4 };
+
+// Displacements are 8.8 fixed point per component, 0xffff in x marks a lost point
+enum { kLost = 0xffff };
+
+static const char *kVertexShader = R"(
+attribute vec4 position;
+attribute vec2 point;
+varying vec2 vPoint;
+void main()
+{
+    vPoint = point;
+    gl_Position = position;
+    gl_PointSize = 1.0;
+})";
+
+static const char *kFragmentShader = R"(
+#ifdef GL_ES
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+#endif
+#define MAX_LEVELS 8
+#define MAX_ITERATIONS 16
+uniform sampler2D uPrevious;
+uniform sampler2D uCurrent;
+uniform vec2 uTexSize;
+uniform vec4 uLevel[MAX_LEVELS];    // atlas offset, level size
+uniform vec2 uScale[MAX_LEVELS];    // level size / level 0 size
+uniform int uLevels;
+uniform int uIterations;
+uniform float uMinEigen;
+varying vec2 vPoint;
+
+float intensity(sampler2D tex, vec4 level, vec2 p)
+{
+    // Bilinear from texel centers in highp: filtering units may round to 8 bits,
+    // which biases the flow by a tenth of a pixel.  Clamped to the level.
+    p = clamp(p, vec2(0.0), level.zw - 1.0);
+    vec2 i = min(floor(p), max(level.zw - 2.0, vec2(0.0)));
+    vec2 f = p - i;
+    vec2 t = (level.xy + i + 0.5) / uTexSize;
+    vec2 d = 1.0 / uTexSize;
+    float a = texture2D(tex, t).r;
+    float b = texture2D(tex, t + vec2(d.x, 0.0)).r;
+    float c = texture2D(tex, t + vec2(0.0, d.y)).r;
+    float e = texture2D(tex, t + d).r;
+    return mix(mix(a, b, f.x), mix(c, e, f.x), f.y);
+}
+
+vec2 gradient(vec4 level, vec2 p)
+{
+    return 0.5 * vec2(intensity(uPrevious, level, p + vec2(1.0, 0.0)) - intensity(uPrevious, level, p - vec2(1.0, 0.0)),
+                      intensity(uPrevious, level, p + vec2(0.0, 1.0)) - intensity(uPrevious, level, p - vec2(0.0, 1.0)));
+}
+
+vec2 encode(float v)
+{
+    // 8.8 fixed point displacement in two bytes, offset by 128 pixels
+    float f = floor((v + 128.0) * 256.0 + 0.5);
+    float hi = floor(f / 256.0);
+    return vec2(f - hi * 256.0, hi) / 255.0;
+}
+
+void main()
+{
+    vec2 flow = vec2(0.0);
+    bool tracked = true;
+    for(int l = MAX_LEVELS - 1; l >= 0; l--)
+    {
+        if(l < uLevels)
+        {
+            vec4 level = uLevel[l];
+            vec2 p = vPoint.xy * uScale[l];
+
+            // Template gradient (xy) and intensity (z), fetched once per level
+            vec3 window[WINDOW_SIZE];
+            float gxx = 0.0, gxy = 0.0, gyy = 0.0;
+            for(int y = -RADIUS; y <= RADIUS; y++)
+            {
+                for(int x = -RADIUS; x <= RADIUS; x++)
+                {
+                    vec2 q = p + vec2(float(x), float(y));
+                    vec2 d = gradient(level, q);
+                    window[(y + RADIUS) * SIDE + x + RADIUS] = vec3(d, intensity(uPrevious, level, q));
+                    gxx += d.x * d.x;
+                    gxy += d.x * d.y;
+                    gyy += d.y * d.y;
+                }
+            }
+            float det = gxx * gyy - gxy * gxy;
+            // Scaled as cv::calcOpticalFlowPyrLK: Scharr derivatives (32x) of [0,255] intensities over 2^20
+            float minEigen = 0.5 * (gxx + gyy - sqrt((gxx - gyy) * (gxx - gyy) + 4.0 * gxy * gxy)) / WINDOW_AREA * (255.0 * 255.0 / 1024.0);
+
+            vec2 v = vec2(0.0);
+            if(minEigen >= uMinEigen && det > 0.0)
+            {
+                for(int i = 0; i < MAX_ITERATIONS; i++)
+                {
+                    if(i >= uIterations)
+                    {
+                        break;
+                    }
+                    vec2 b = vec2(0.0);
+                    for(int y = -RADIUS; y <= RADIUS; y++)
+                    {
+                        for(int x = -RADIUS; x <= RADIUS; x++)
+                        {
+                            vec3 t = window[(y + RADIUS) * SIDE + x + RADIUS];
+                            float it = t.z - intensity(uCurrent, level, p + vec2(float(x), float(y)) + flow + v);
+                            b += it * t.xy;
+                        }
+                    }
+                    vec2 delta = vec2(gyy * b.x - gxy * b.y, gxx * b.y - gxy * b.x) / det;
+                    v += delta;
+                    if(dot(delta, delta) < 1e-4)
+                    {
+                        break;
+                    }
+                }
+            }
+            else if(l == 0)
+            {
+                tracked = false;
+            }
+
+            flow += v;
+            if(l > 0)
+            {
+                flow *= uScale[l - 1] / uScale[l];
+            }
+        }
+    }
+
+    vec2 result = vPoint + flow;
+    if(any(lessThan(result, vec2(0.0))) || any(greaterThan(result, uLevel[0].zw - 1.0)) || any(greaterThan(abs(flow), vec2(127.0))))
+    {
+        tracked = false;
+    }
+    gl_FragColor = tracked ? vec4(encode(flow.x), encode(flow.y)) : vec4(1.0);
+})";
+
+LucasKanadeTracker::LucasKanadeTracker(const PyramidLayout &layout, int windowRadius)
+: m_layout(layout)
+{
+    if(layout.size() < 1 || layout.size() > kMaxLevels)
+    {
+        throw std::invalid_argument("LucasKanadeTracker: unsupported number of pyramid levels");
+    }
+    if(windowRadius < 1)
+    {
+        throw std::invalid_argument("LucasKanadeTracker: window radius must be positive");
+    }
+    compileShaders(windowRadius);
+}
+
+LucasKanadeTracker::~LucasKanadeTracker()
+{
+    release();
+}
+
+void LucasKanadeTracker::setIterations(int iterations)
+{
+    if(iterations < 1 || iterations > kMaxIterations)
+    {
+        throw std::invalid_argument("LucasKanadeTracker: unsupported number of iterations");
+    }
+    m_iterations = iterations;
+}
+
+void LucasKanadeTracker::compileShaders(int windowRadius)
+{
+    const int side = 2 * windowRadius + 1;
+    std::stringstream defines;
+    defines << "#define RADIUS " << windowRadius << "\n";
+    defines << "#define SIDE " << side << "\n";
+    defines << "#define WINDOW_SIZE " << (side * side) << "\n";
+    defines << "#define WINDOW_AREA " << (side * side) << ".0\n";
+    const std::string source = defines.str() + kFragmentShader;
+
+    std::vector< std::pair<int, const char *> > attributes { { kAttribPosition, "position" }, { kAttribPoint, "point" } };
+    const GLchar * vShaderStr[] = { kVertexShader };
+    const GLchar * fShaderStr[] = { source.c_str() };
+    m_program = make_unique<shader_prog>(vShaderStr, fShaderStr, attributes);
+}
+
+void LucasKanadeTracker::release()
+{
+    if(m_fbo)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+    if(m_texture)
+    {
+        glDeleteTextures(1, &m_texture);
+    }
+    m_fbo = m_texture = 0;
+    m_rows = 0;
+    GLStateCache::get().invalidate(); // the names can be reused
+}
+
+void LucasKanadeTracker::allocate(int rows)
+{
+    release();
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kRowWidth, rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("LucasKanadeTracker: incomplete framebuffer");
+    }
+    m_rows = rows;
+}
+
+void LucasKanadeTracker::operator()(GLuint previous, GLuint current, const std::vector<cv::Point2f> &points)
+{
+    cpu::Keypoints keypoints;
+    keypoints.reserve(points.size());
+    for(const auto &p : points)
+    {
+        keypoints.push_back(p.x, p.y, 0.f);
+    }
+    (*this)(previous, current, keypoints);
+}
+
+void LucasKanadeTracker::operator()(GLuint previous, GLuint current, const cpu::Keypoints &points)
+{
+    m_keypoints.clear();
+    m_status.clear();
+    m_readbackSize = 0;
+
+    const int n = int(points.size());
+    if(!n)
+    {
+        return;
+    }
+
+    // One output texel per point: x and y displacements
+    const int texels = n;
+    const int rows = (texels + kRowWidth - 1) / kRowWidth;
+    if(rows > m_rows)
+    {
+        allocate(rows);
+    }
+
+    m_vertices.resize(texels * kVertexFloats);
+    for(int i = 0; i < texels; i++)
+    {
+        GLfloat *vertex = &m_vertices[i * kVertexFloats];
+        vertex[0] = (float(i % kRowWidth) + 0.5f) * 2.f / float(kRowWidth) - 1.f;
+        vertex[1] = (float(i / kRowWidth) + 0.5f) * 2.f / float(m_rows) - 1.f;
+        vertex[2] = points.x[i];
+        vertex[3] = points.y[i];
+    }
+
+    GLfloat levels[kMaxLevels * 4] = { 0.f }, scales[kMaxLevels * 2] = { 0.f };
+    const cv::Rect &base = m_layout.levels[0];
+    for(size_t l = 0; l < m_layout.size(); l++)
+    {
+        const cv::Rect &roi = m_layout.levels[l];
+        levels[l * 4 + 0] = float(roi.x);
+        levels[l * 4 + 1] = float(roi.y);
+        levels[l * 4 + 2] = float(roi.width);
+        levels[l * 4 + 3] = float(roi.height);
+        scales[l * 2 + 0] = float(roi.width) / float(base.width);
+        scales[l * 2 + 1] = float(roi.height) / float(base.height);
+    }
+
+    GLint viewport[4], framebuffer = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    (*m_program)();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, previous);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, current);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(m_program->GetUniformLocation("uPrevious"), 0);
+    glUniform1i(m_program->GetUniformLocation("uCurrent"), 1);
+    glUniform2f(m_program->GetUniformLocation("uTexSize"), float(m_layout.textureSize.width), float(m_layout.textureSize.height));
+    glUniform4fv(m_program->GetUniformLocation("uLevel"), kMaxLevels, levels);
+    glUniform2fv(m_program->GetUniformLocation("uScale"), kMaxLevels, scales);
+    glUniform1i(m_program->GetUniformLocation("uLevels"), int(m_layout.size()));
+    glUniform1i(m_program->GetUniformLocation("uIterations"), m_iterations);
+    glUniform1f(m_program->GetUniformLocation("uMinEigen"), m_minEigenThreshold);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, kRowWidth, m_rows);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    const GLsizei stride = kVertexFloats * sizeof(GLfloat);
+    glVertexAttribPointer(kAttribPosition, 2, GL_FLOAT, GL_FALSE, stride, &m_vertices[0]);
+    glVertexAttribPointer(kAttribPoint, 2, GL_FLOAT, GL_FALSE, stride, &m_vertices[2]);
+    glEnableVertexAttribArray(kAttribPosition);
+    glEnableVertexAttribArray(kAttribPoint);
+    glDrawArrays(GL_POINTS, 0, texels);
+    glDisableVertexAttribArray(kAttribPoint);
+
+    // ### Readback of the positions only: full rows, then the partial last row ###
+    const int fullRows = texels / kRowWidth, remainder = texels % kRowWidth;
+    m_packed.resize(texels * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    if(fullRows)
+    {
+        glReadPixels(0, 0, kRowWidth, fullRows, GL_RGBA, GL_UNSIGNED_BYTE, m_packed.data());
+    }
+    if(remainder)
+    {
+        glReadPixels(0, fullRows, remainder, 1, GL_RGBA, GL_UNSIGNED_BYTE, &m_packed[fullRows * kRowWidth * 4]);
+    }
+    m_readbackSize = m_packed.size();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLStateCache::get().invalidate(); // bound outside the cache
+
+    m_keypoints.reserve(n);
+    m_status.resize(n);
+    for(int i = 0; i < n; i++)
+    {
+        const uint8_t *texel = &m_packed[i * 4];
+        const int dx = texel[0] + (texel[1] << 8), dy = texel[2] + (texel[3] << 8);
+        m_status[i] = (dx != kLost) ? 1 : 0;
+        if(m_status[i])
+        {
+            const float scale = 1.f / 256.f;
+            m_keypoints.push_back(points.x[i] + float(dx) * scale - 128.f, points.y[i] + float(dy) * scale - 128.f, points.score[i]);
+        }
+        else
+        {
+            m_keypoints.push_back(points.x[i], points.y[i], points.score[i]);
+        }
+    }
+}
+
+_GATHERER_GRAPHICS_END
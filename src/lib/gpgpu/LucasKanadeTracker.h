@@ -0,0 +1,112 @@
+//
+//  LucasKanadeTracker.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__LucasKanadeTracker__
+#define __gatherer__gpgpu__LucasKanadeTracker__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLSLShaderProgram.h"
+#include "gpgpu/PyramidLayout.h"
+#include "cpu/Keypoints.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class LucasKanadeTracker
+ *
+ * \brief Sparse pyramidal Lucas-Kanade tracking on packed pyramid textures
+ *
+ * Tracks points from the previous to the current frame, coarse to fine,
+ * with one fragment per point.  Only the displacements and status are
+ * read back (4 bytes per point), so neither the frames nor a CPU pyramid
+ * are needed:
+ *
+ * @code
+ *
+ * gatherer::graphics::FrameHistory pyramids(2);
+ * gatherer::graphics::LucasKanadeTracker tracker(layout);
+ * pyramids.push(pyrProc.getOutputTexId(), pyrProc.getOutFrameW(), pyrProc.getOutFrameH());
+ * tracker(pyramids.getTexture(1), pyramids.getTexture(0), compactor.getKeypoints());
+ * const auto &tracked = tracker.getKeypoints();
+ * const auto &status = tracker.getStatus();
+ *
+ * @endcode
+ *
+ * Both textures are packed as the layout (e.g. PyramidProc output or a
+ * ScaleSpaceGenerator atlas), level 0 at full resolution, intensity in the
+ * red channel.  Points are in level 0 pixels; displacements have 1/256 pixel
+ * resolution.  A point is lost when it leaves the image, moves by 128 pixels
+ * or more, or when the minimum eigenvalue of its level 0 gradient matrix is
+ * below the threshold, in the units of the cv::calcOpticalFlowPyrLK
+ * minEigThreshold; lost points keep their input position.
+ *
+ * The template gradients and intensities of a level are kept in a
+ * (2r+1)^2 array for the iterations, which bounds the practical window
+ * radius by the register file.  Sub-pixel accuracy needs highp fragment
+ * precision: GLES 2.0 devices without it run in mediump.
+ */
+
+class LucasKanadeTracker
+{
+public:
+
+    enum { kMaxLevels = 8, kMaxIterations = 16 };
+
+    /// windowRadius: half size of the (2r+1)x(2r+1) integration window
+    explicit LucasKanadeTracker(const PyramidLayout &layout, int windowRadius = 3);
+    ~LucasKanadeTracker();
+
+    void setIterations(int iterations);
+    int getIterations() const { return m_iterations; }
+
+    void setMinEigenThreshold(float threshold) { m_minEigenThreshold = threshold; }
+    float getMinEigenThreshold() const { return m_minEigenThreshold; }
+
+    /// Track points from the previous to the current pyramid texture
+    void operator()(GLuint previous, GLuint current, const cpu::Keypoints &points);
+    void operator()(GLuint previous, GLuint current, const std::vector<cv::Point2f> &points);
+
+    /// Tracked positions in input order (scores are carried over)
+    const cpu::Keypoints & getKeypoints() const { return m_keypoints; }
+
+    /// 1 if the point was tracked, 0 if lost
+    const std::vector<uint8_t> & getStatus() const { return m_status; }
+
+    /// Bytes read back by the last call
+    size_t getReadbackSize() const { return m_readbackSize; }
+
+protected:
+
+    enum { kRowWidth = 256 };
+
+    void compileShaders(int windowRadius);
+    void allocate(int rows);
+    void release();
+
+    PyramidLayout m_layout;
+    int m_iterations = 8;
+    float m_minEigenThreshold = 1e-4f;
+
+    GLuint m_texture = 0;
+    GLuint m_fbo = 0;
+    int m_rows = 0;
+
+    std::unique_ptr<shader_prog> m_program;
+
+    std::vector<GLfloat> m_vertices;
+    std::vector<uint8_t> m_packed;
+    cpu::Keypoints m_keypoints;
+    std::vector<uint8_t> m_status;
+    size_t m_readbackSize = 0;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__LucasKanadeTracker__) */
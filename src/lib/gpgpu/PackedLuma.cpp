@@ -0,0 +1,343 @@
+//
+//  PackedLuma.cpp
+//  gatherer
+//
+
+#include "gpgpu/PackedLuma.h"
+#include "graphics/GLStateCache.h"
+#include "graphics/GLFence.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+enum { kAttribPosition };
+
+static const char *kVertexShader = R"(
+attribute vec4 position;
+void main()
+{
+    gl_Position = position;
+})";
+
+// Shared by all fragment shaders: t is the output texel column, y the row
+static const char *kHeader = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+uniform sampler2D uInputTex;
+uniform vec2 uTexelSize;    // 1 / input texture size
+uniform float uWidth;       // input width in pixels
+
+vec4 texel(float t, float y)
+{
+    return texture2D(uInputTex, (vec2(t, y) + 0.5) * uTexelSize);
+}
+
+// One pixel of a packed row, clamped to the image (border replicate)
+float pixel(float x, float y)
+{
+    x = clamp(x, 0.0, uWidth - 1.0);
+    float t = floor((x + 0.5) / 4.0);
+    float c = x - 4.0 * t;
+    vec4 v = texel(t, y);
+    return c < 0.5 ? v.r : (c < 1.5 ? v.g : (c < 2.5 ? v.b : v.a));
+}
+)";
+
+static const char *kPackShader = R"(
+uniform vec3 uWeights;
+float gray(float x, float y)
+{
+    return dot(texture2D(uInputTex, (vec2(min(x, uWidth - 1.0), y) + 0.5) * uTexelSize).rgb, uWeights);
+}
+void main()
+{
+    float x = floor(gl_FragCoord.x) * 4.0;
+    float y = floor(gl_FragCoord.y);
+    gl_FragColor = vec4(gray(x, y), gray(x + 1.0, y), gray(x + 2.0, y), gray(x + 3.0, y));
+})";
+
+static const char *kThresholdShader = R"(
+uniform float uThreshold;
+void main()
+{
+    gl_FragColor = step(vec4(uThreshold), texel(floor(gl_FragCoord.x), floor(gl_FragCoord.y)));
+})";
+
+static const char *kLanes = "rgba";
+
+static std::string toString(float value)
+{
+    std::stringstream ss;
+    ss.precision(9);
+    ss << std::showpoint << value;
+    return ss.str();
+}
+
+// ########### PackedLumaTexture ###########
+
+PackedLumaTexture::~PackedLumaTexture()
+{
+    release();
+}
+
+void PackedLumaTexture::release()
+{
+    if(m_fbo)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+    if(m_texture)
+    {
+        glDeleteTextures(1, &m_texture);
+    }
+    m_fbo = m_texture = 0;
+    m_size = cv::Size();
+    GLStateCache::get().invalidate(); // the names can be reused
+}
+
+void PackedLumaTexture::allocate(const cv::Size &size)
+{
+    if(size == m_size && m_texture)
+    {
+        return;
+    }
+    release();
+
+    const cv::Size packed = getPackedSize(size);
+
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, packed.width, packed.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    GLStateCache::get().invalidate(); // bound outside the cache
+    if(status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("PackedLumaTexture: incomplete framebuffer");
+    }
+
+    m_size = size;
+}
+
+const cv::Mat & PackedLumaTexture::read()
+{
+    const cv::Size packed = getPackedSize();
+
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+    // Packed rows are the CV_8UC1 rows, padded to a whole texel
+    m_buffer.create(packed.height, packed.width * 4, CV_8UC1);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, packed.width, packed.height, GL_RGBA, GL_UNSIGNED_BYTE, m_buffer.ptr());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    m_view = m_buffer.colRange(0, m_size.width);
+    return m_view;
+}
+
+// ########### PackedLumaProc ###########
+
+PackedLumaProc::PackedLumaProc()
+{
+    setWeights(0.299f, 0.587f, 0.114f);
+}
+
+PackedLumaProc::~PackedLumaProc()
+{
+    GLStateCache::get().invalidate(); // our program names can be reused
+}
+
+void PackedLumaProc::setWeights(float r, float g, float b)
+{
+    m_weights[0] = r;
+    m_weights[1] = g;
+    m_weights[2] = b;
+}
+
+std::string PackedLumaProc::generateHorizontal(const std::vector<float> &weights, float bias)
+{
+    const int r = int(weights.size()) / 2;
+    const int R = (r + 3) / 4; // texels on each side
+
+    // Interior texels read the 2R+1 texels around them once and take every tap from those
+    std::stringstream fast, slow;
+    for(int j = 0; j <= 2 * R; j++)
+    {
+        fast << "        vec4 T" << j << " = texel(t + " << toString(float(j - R)) << ", y);\n";
+    }
+    for(int lane = 0; lane < 4; lane++)
+    {
+        fast << "        result." << kLanes[lane] << " = " << toString(bias);
+        slow << "        result." << kLanes[lane] << " = " << toString(bias);
+        for(int o = -r; o <= r; o++)
+        {
+            const float w = weights[o + r];
+            if(w == 0.f)
+            {
+                continue;
+            }
+            const int p = 4 * R + lane + o;
+            fast << " + " << toString(w) << " * T" << (p / 4) << "." << kLanes[p % 4];
+            slow << " + " << toString(w) << " * pixel(x + " << toString(float(lane + o)) << ", y)";
+        }
+        fast << ";\n";
+        slow << ";\n";
+    }
+
+    std::stringstream ss;
+    ss << "void main()\n{\n";
+    ss << "    float t = floor(gl_FragCoord.x);\n";
+    ss << "    float y = floor(gl_FragCoord.y);\n";
+    ss << "    float x = t * 4.0;\n";
+    ss << "    vec4 result;\n";
+    ss << "    if(x >= " << toString(float(r)) << " && x + " << toString(float(3 + r)) << " <= uWidth - 1.0)\n";
+    ss << "    {\n" << fast.str() << "    }\n";
+    ss << "    else\n";
+    ss << "    {\n" << slow.str() << "    }\n";
+    ss << "    gl_FragColor = result;\n";
+    ss << "}\n";
+    return ss.str();
+}
+
+std::string PackedLumaProc::generateVertical(const std::vector<float> &weights, float bias)
+{
+    // Texel wise: the four lanes are independent columns, rows are clamped by GL_CLAMP_TO_EDGE
+    const int r = int(weights.size()) / 2;
+    std::stringstream ss;
+    ss << "void main()\n{\n";
+    ss << "    float t = floor(gl_FragCoord.x);\n";
+    ss << "    float y = floor(gl_FragCoord.y);\n";
+    ss << "    gl_FragColor = vec4(" << toString(bias) << ")";
+    for(int o = -r; o <= r; o++)
+    {
+        const float w = weights[o + r];
+        if(w != 0.f)
+        {
+            ss << " + " << toString(w) << " * texel(t, y + " << toString(float(o)) << ")";
+        }
+    }
+    ss << ";\n}\n";
+    return ss.str();
+}
+
+shader_prog & PackedLumaProc::getProgram(const std::string &fragmentShader)
+{
+    auto &program = m_programs[fragmentShader];
+    if(!program)
+    {
+        std::vector< std::pair<int, const char *> > attributes { { kAttribPosition, "position" } };
+        const GLchar * vShaderStr[] = { kVertexShader };
+        const GLchar * fShaderStr[] = { kHeader, fragmentShader.c_str() };
+        program = make_unique<shader_prog>(vShaderStr, fShaderStr, attributes);
+    }
+    return *program;
+}
+
+void PackedLumaProc::draw(shader_prog &program, GLuint texture, const cv::Size &textureSize, int width, PackedLumaTexture &dst)
+{
+    if(texture == dst.getTexId())
+    {
+        throw std::invalid_argument("PackedLumaProc: input and output are the same texture");
+    }
+
+    GLStateCache &gl = GLStateCache::get();
+
+    GLint viewport[4], framebuffer = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    gl.useProgram(program);
+    glUniform2f(program.GetUniformLocation("uTexelSize"), 1.f / float(textureSize.width), 1.f / float(textureSize.height));
+    glUniform1f(program.GetUniformLocation("uWidth"), float(width));
+    glUniform1i(program.GetUniformLocation("uInputTex"), 0);
+    GATHERER_GL_READ(texture);
+    gl.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+
+    const cv::Size packed = dst.getPackedSize();
+    gl.bindFramebuffer(dst.getFramebuffer());
+    gl.viewport(0, 0, packed.width, packed.height);
+
+    gl.bindArrayBuffer(gl.getQuadBuffer());
+    glVertexAttribPointer(kAttribPosition, 2, GL_FLOAT, 0, 0, (const GLvoid *)GLStateCache::getQuadOffset(GLStateCache::kClipQuad));
+    gl.enableVertexAttribArray(kAttribPosition);
+    gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    // ogles_gpgpu streams vertices from client memory
+    gl.bindArrayBuffer(0);
+
+    gl.bindFramebuffer(framebuffer);
+    gl.viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GATHERER_GL_WRITTEN(dst.getTexId());
+}
+
+void PackedLumaProc::pack(GLuint texture, const cv::Size &size, PackedLumaTexture &dst)
+{
+    dst.allocate(size);
+    shader_prog &program = getProgram(kPackShader);
+    GLStateCache::get().useProgram(program);
+    glUniform3fv(program.GetUniformLocation("uWeights"), 1, m_weights);
+    draw(program, texture, size, size.width, dst);
+}
+
+void PackedLumaProc::threshold(const PackedLumaTexture &src, PackedLumaTexture &dst, float threshold)
+{
+    dst.allocate(src.getSize());
+    shader_prog &program = getProgram(kThresholdShader);
+    GLStateCache::get().useProgram(program);
+    glUniform1f(program.GetUniformLocation("uThreshold"), threshold);
+    draw(program, src.getTexId(), src.getPackedSize(), src.getSize().width, dst);
+}
+
+void PackedLumaProc::gaussian(const PackedLumaTexture &src, PackedLumaTexture &dst, float sigma)
+{
+    if(sigma <= 0.f)
+    {
+        throw std::invalid_argument("PackedLumaProc: sigma must be positive");
+    }
+
+    const int r = std::max(1, int(std::ceil(3.f * sigma)));
+    std::vector<float> weights(2 * r + 1);
+    float sum = 0.f;
+    for(int o = -r; o <= r; o++)
+    {
+        sum += (weights[o + r] = std::exp(-float(o * o) / (2.f * sigma * sigma)));
+    }
+    for(auto &w : weights)
+    {
+        w /= sum;
+    }
+
+    m_tmp.allocate(src.getSize());
+    dst.allocate(src.getSize());
+    draw(getProgram(generateHorizontal(weights, 0.f)), src.getTexId(), src.getPackedSize(), src.getSize().width, m_tmp);
+    draw(getProgram(generateVertical(weights, 0.f)), m_tmp.getTexId(), m_tmp.getPackedSize(), m_tmp.getSize().width, dst);
+}
+
+void PackedLumaProc::gradient(const PackedLumaTexture &src, PackedLumaTexture &dx, PackedLumaTexture &dy)
+{
+    const std::vector<float> diff { -0.5f, 0.f, 0.5f };
+    dx.allocate(src.getSize());
+    dy.allocate(src.getSize());
+    draw(getProgram(generateHorizontal(diff, 0.5f)), src.getTexId(), src.getPackedSize(), src.getSize().width, dx);
+    draw(getProgram(generateVertical(diff, 0.5f)), src.getTexId(), src.getPackedSize(), src.getSize().width, dy);
+}
+
+_GATHERER_GRAPHICS_END
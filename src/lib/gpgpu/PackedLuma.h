@@ -0,0 +1,137 @@
+//
+//  PackedLuma.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__PackedLuma__
+#define __gatherer__gpgpu__PackedLuma__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLSLShaderProgram.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class PackedLumaTexture
+ *
+ * \brief Gray image stored four pixels per RGBA8 texel
+ *
+ * Pixel x of a row is component x % 4 of texel x / 4, so a width x height
+ * image is a ceil(width / 4) x height texture.  Padding pixels of the last
+ * texel are undefined.  The texture uses GL_NEAREST filtering: sampling
+ * between texels would mix pixels.
+ */
+
+class PackedLumaTexture
+{
+public:
+
+    PackedLumaTexture() {}
+    explicit PackedLumaTexture(const cv::Size &size) { allocate(size); }
+    ~PackedLumaTexture();
+
+    PackedLumaTexture(const PackedLumaTexture &) = delete;
+    PackedLumaTexture & operator=(const PackedLumaTexture &) = delete;
+
+    /// (Re)allocate for a gray image of the given size, no-op if unchanged
+    void allocate(const cv::Size &size);
+
+    static cv::Size getPackedSize(const cv::Size &size) { return cv::Size((size.width + 3) / 4, size.height); }
+
+    const cv::Size & getSize() const { return m_size; }
+    cv::Size getPackedSize() const { return getPackedSize(m_size); }
+    GLuint getTexId() const { return m_texture; }
+    GLuint getFramebuffer() const { return m_fbo; }
+
+    /// Read back as CV_8UC1 without unpacking: a view into a reused buffer, valid until the next read
+    const cv::Mat & read();
+
+protected:
+
+    void release();
+
+    cv::Size m_size;
+    GLuint m_texture = 0;
+    GLuint m_fbo = 0;
+
+    cv::Mat m_buffer;   // packed rows, 4 byte aligned
+    cv::Mat m_view;
+};
+
+/**
+ * \class PackedLumaProc
+ *
+ * \brief Luma-only stages on PackedLumaTexture images
+ *
+ * Every texel fetch, write and readback carries four gray pixels instead
+ * of one gray pixel replicated to RGBA, which cuts bandwidth and fill rate
+ * by four for luma-only processing:
+ *
+ * @code
+ *
+ * gatherer::graphics::PackedLumaProc proc;
+ * gatherer::graphics::PackedLumaTexture gray(size), smooth(size), dx(size), dy(size);
+ * proc.pack(video.getInputTexId(), size, gray);    // RGBA input to packed gray
+ * proc.gaussian(gray, smooth, 1.5f);
+ * proc.gradient(smooth, dx, dy);
+ * const cv::Mat &gx = dx.read();                   // CV_8UC1
+ *
+ * @endcode
+ *
+ * - pack: luminance with the GrayscaleProc weights (set BGR order for BGRA textures).
+ * - threshold: v >= threshold ? 1 : 0.
+ * - gaussian: separable, 2 * ceil(3 * sigma) + 1 taps, border replicate.
+ *   The horizontal pass reads its taps from whole texels; only texels near
+ *   the left and right borders fall back to per pixel fetches.
+ * - gradient: central differences encoded as 0.5 + (I(x + 1) - I(x - 1)) / 2.
+ *
+ * Inputs and outputs must be different textures.  Outputs are allocated to
+ * the input size.
+ */
+
+class PackedLumaProc
+{
+public:
+
+    PackedLumaProc();
+    ~PackedLumaProc();
+
+    /// Luminance weights of pack() (rgb of the input texel)
+    void setWeights(float r, float g, float b);
+
+    /// Gray conversion of an RGBA texture into the packed layout
+    void pack(GLuint texture, const cv::Size &size, PackedLumaTexture &dst);
+
+    void threshold(const PackedLumaTexture &src, PackedLumaTexture &dst, float threshold);
+
+    void gaussian(const PackedLumaTexture &src, PackedLumaTexture &dst, float sigma);
+
+    void gradient(const PackedLumaTexture &src, PackedLumaTexture &dx, PackedLumaTexture &dy);
+
+    /// Filter a row with weights centered on the pixel, plus bias (width must be odd)
+    static std::string generateHorizontal(const std::vector<float> &weights, float bias);
+
+    /// Filter a column with weights centered on the pixel, plus bias (width must be odd)
+    static std::string generateVertical(const std::vector<float> &weights, float bias);
+
+protected:
+
+    shader_prog & getProgram(const std::string &fragmentShader);
+    void draw(shader_prog &program, GLuint texture, const cv::Size &textureSize, int width, PackedLumaTexture &dst);
+
+    std::map<std::string, std::unique_ptr<shader_prog>> m_programs; // by fragment shader
+    float m_weights[3];
+
+    PackedLumaTexture m_tmp;    // gaussian intermediate
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__PackedLuma__) */
@@ -0,0 +1,252 @@
+//
+//  PackedReader.cpp
+//  gatherer
+//
+
+#include "gpgpu/PackedReader.h"
+#include "graphics/GLStateCache.h"
+#include "graphics/GLFence.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+enum { kAttribPosition };
+
+static const char *kVertexShader = R"(
+attribute vec4 position;
+void main()
+{
+    gl_Position = position;
+})";
+
+// Value k of an output row is channel k % N of pixel k / N of the ROI row.
+// Each output texel holds the bytes of 4 (kU8), 2 (kU16) or 1 (kFloat) values.
+static const char *kFragmentShader = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+uniform sampler2D uInputTex;
+uniform vec2 uOrigin;       // ROI top left in texels
+uniform vec2 uTexelSize;    // 1 / texture size
+
+float fetch(float k, float y)
+{
+    float x = floor((k + 0.5) / kChannels);
+    float c = k - x * kChannels;
+    vec4 texel = texture2D(uInputTex, (uOrigin + vec2(x, y) + 0.5) * uTexelSize);
+    return c < 0.5 ? texel.kSelect0 : (c < 1.5 ? texel.kSelect1 : (c < 2.5 ? texel.kSelect2 : texel.kSelect3));
+}
+
+vec2 encodeU16(float v)
+{
+    float q = floor(clamp(v, 0.0, 1.0) * 65535.0 + 0.5);
+    float hi = floor(q / 256.0);
+    return vec2(q - hi * 256.0, hi) / 255.0;
+}
+
+// Little endian IEEE 754 bytes
+vec4 encodeFloat(float v)
+{
+    float a = abs(v);
+    float e = floor(log2(a));
+    float m = a * exp2(-e);
+    if(m >= 2.0) { m *= 0.5; e += 1.0; } // log2() may be off by one
+    if(m < 1.0) { m *= 2.0; e -= 1.0; }
+    e += 127.0;
+    if(a == 0.0 || e < 1.0)
+    {
+        return vec4(0.0);
+    }
+    m = (m - 1.0) * 8388608.0;
+    float b2 = floor(m / 65536.0);
+    m -= b2 * 65536.0;
+    float b1 = floor(m / 256.0);
+    float b0 = m - b1 * 256.0;
+    float e1 = floor(e / 2.0);
+    b2 += (e - e1 * 2.0) * 128.0;
+    float b3 = e1 + (v < 0.0 ? 128.0 : 0.0);
+    return vec4(b0, b1, b2, b3) / 255.0;
+}
+
+void main()
+{
+    float i = floor(gl_FragCoord.x);
+    float y = floor(gl_FragCoord.y);
+#if kFormat == 0
+    float k = i * 4.0;
+    gl_FragColor = vec4(fetch(k, y), fetch(k + 1.0, y), fetch(k + 2.0, y), fetch(k + 3.0, y));
+#elif kFormat == 1
+    float k = i * 2.0;
+    gl_FragColor = vec4(encodeU16(fetch(k, y)), encodeU16(fetch(k + 1.0, y)));
+#else
+    gl_FragColor = encodeFloat(fetch(i, y));
+#endif
+})";
+
+static int getBytes(PackedReader::Format format)
+{
+    switch(format)
+    {
+        case PackedReader::kU8: return 1;
+        case PackedReader::kU16: return 2;
+        default: return 4;
+    }
+}
+
+int PackedReader::getType(Format format, int channels)
+{
+    switch(format)
+    {
+        case kU8: return CV_MAKETYPE(CV_8U, channels);
+        case kU16: return CV_MAKETYPE(CV_16U, channels);
+        default: return CV_MAKETYPE(CV_32F, channels);
+    }
+}
+
+PackedReader::PackedReader()
+{
+
+}
+
+PackedReader::~PackedReader()
+{
+    release();
+    GLStateCache::get().invalidate(); // our program and texture names can be reused
+}
+
+void PackedReader::release()
+{
+    if(m_fbo)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+    if(m_texture)
+    {
+        glDeleteTextures(1, &m_texture);
+    }
+    m_fbo = m_texture = 0;
+    m_capacity = cv::Size();
+}
+
+void PackedReader::allocate(const cv::Size &size)
+{
+    release();
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.width, size.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("PackedReader: incomplete framebuffer");
+    }
+
+    m_capacity = size;
+    GLStateCache::get().invalidate(); // texture and framebuffer bound outside the cache
+}
+
+shader_prog & PackedReader::getProgram(Format format, const std::vector<int> &channels)
+{
+    std::stringstream key;
+    key << int(format);
+    for(int c : channels)
+    {
+        key << c;
+    }
+
+    auto &program = m_programs[key.str()];
+    if(!program)
+    {
+        static const char *rgba = "rgba";
+        std::stringstream defines;
+        defines << "#define kFormat " << int(format) << "\n";
+        defines << "#define kChannels " << channels.size() << ".0\n";
+        for(int i = 0; i < 4; i++)
+        {
+            defines << "#define kSelect" << i << " " << rgba[channels[std::min(i, int(channels.size()) - 1)]] << "\n";
+        }
+        const std::string header = defines.str();
+
+        std::vector< std::pair<int, const char *> > attributes { { kAttribPosition, "position" } };
+        const GLchar * vShaderStr[] = { kVertexShader };
+        const GLchar * fShaderStr[] = { header.c_str(), kFragmentShader };
+        program = make_unique<shader_prog>(vShaderStr, fShaderStr, attributes);
+    }
+    return *program;
+}
+
+const cv::Mat & PackedReader::operator()(GLuint texture, const cv::Size &textureSize, const std::vector<int> &channels, Format format, const cv::Rect &roi_)
+{
+    if(channels.empty() || channels.size() > 4)
+    {
+        throw std::invalid_argument("PackedReader: 1 to 4 channels");
+    }
+    for(int c : channels)
+    {
+        if(c < 0 || c > 3)
+        {
+            throw std::invalid_argument("PackedReader: channels are RGBA indices");
+        }
+    }
+    const cv::Rect roi = roi_.area() ? roi_ : cv::Rect({0,0}, textureSize);
+    if((roi & cv::Rect({0,0}, textureSize)) != roi)
+    {
+        throw std::invalid_argument("PackedReader: ROI outside of the texture");
+    }
+
+    // Packed row: width * channels values, rounded up to whole RGBA8 texels
+    const int rowBytes = roi.width * int(channels.size()) * getBytes(format);
+    const cv::Size packed((rowBytes + 3) / 4, roi.height);
+
+    GLint viewport[4], framebuffer = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    if(packed.width > m_capacity.width || packed.height > m_capacity.height)
+    {
+        allocate(cv::Size(std::max(packed.width, m_capacity.width), std::max(packed.height, m_capacity.height)));
+    }
+
+    GLStateCache &gl = GLStateCache::get();
+    shader_prog &program = getProgram(format, channels);
+    gl.useProgram(program);
+    glUniform2f(program.GetUniformLocation("uOrigin"), float(roi.x), float(roi.y));
+    glUniform2f(program.GetUniformLocation("uTexelSize"), 1.f / float(textureSize.width), 1.f / float(textureSize.height));
+    glUniform1i(program.GetUniformLocation("uInputTex"), 0);
+    GATHERER_GL_READ(texture);
+    gl.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+
+    gl.bindFramebuffer(m_fbo);
+    gl.viewport(0, 0, packed.width, packed.height);
+
+    gl.bindArrayBuffer(gl.getQuadBuffer());
+    glVertexAttribPointer(kAttribPosition, 2, GL_FLOAT, 0, 0, (const GLvoid *)GLStateCache::getQuadOffset(GLStateCache::kClipQuad));
+    gl.enableVertexAttribArray(kAttribPosition);
+    gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    // ogles_gpgpu streams vertices from client memory
+    gl.bindArrayBuffer(0);
+
+    // Rows of RGBA8 are always 4 byte aligned, so the buffer is read in place
+    m_buffer.create(packed, CV_8UC4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, packed.width, packed.height, GL_RGBA, GL_UNSIGNED_BYTE, m_buffer.ptr());
+
+    gl.bindFramebuffer(framebuffer);
+    gl.viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    m_result = cv::Mat(roi.size(), getType(format, int(channels.size())), m_buffer.ptr(), m_buffer.step);
+    return m_result;
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,90 @@
+//
+//  PackedReader.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__PackedReader__
+#define __gatherer__gpgpu__PackedReader__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLSLShaderProgram.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class PackedReader
+ *
+ * \brief Readback of selected channels of a texture ROI in a compact type
+ *
+ * getResultData() always reads full frame RGBA8.  Here a packing pass
+ * first renders exactly the requested bytes into an RGBA8 target, so the
+ * transfer only carries the selected channels of the ROI:
+ *
+ * @code
+ *
+ * gatherer::graphics::PackedReader reader;
+ * const cv::Mat &lbp = reader(lbpProc.getOutputTexId(), size, { 0 });                          // CV_8UC1
+ * const cv::Mat &grad = reader(gradProc.getOutputTexId(), size, { 2, 3 }, PackedReader::kFloat); // CV_32FC2
+ *
+ * @endcode
+ *
+ * - kU8: one byte per value, as getResultData().
+ * - kU16: texture values in [0,1] scaled to [0,65535], for float textures
+ *   with more than 8 bits of precision.
+ * - kFloat: IEEE 754 single precision, bit packed into the four bytes of a
+ *   texel, so values outside [0,1] and the full precision of float textures
+ *   survive.  Denormals are flushed to zero.
+ *
+ * The result is a view into a reused buffer, valid until the next read.
+ * Rows may be padded to 4 bytes.  Texture row 0 is image row 0, as with
+ * getResultData().
+ */
+
+class PackedReader
+{
+public:
+
+    enum Format
+    {
+        kU8,
+        kU16,
+        kFloat
+    };
+
+    PackedReader();
+    ~PackedReader();
+
+    /// Read channels (indices into RGBA, 1 to 4 of them) of a texture region (whole texture if empty)
+    const cv::Mat & operator()(GLuint texture, const cv::Size &textureSize, const std::vector<int> &channels = { 0, 1, 2, 3 }, Format format = kU8, const cv::Rect &roi = cv::Rect());
+
+    /// Bytes read back by the last call
+    size_t getReadbackSize() const { return m_buffer.total() * m_buffer.elemSize(); }
+
+    static int getType(Format format, int channels);
+
+protected:
+
+    shader_prog & getProgram(Format format, const std::vector<int> &channels);
+    void allocate(const cv::Size &size);
+    void release();
+
+    std::map<std::string, std::unique_ptr<shader_prog>> m_programs; // by format and channels
+
+    cv::Size m_capacity;            // target size, only grows
+    GLuint m_texture = 0;
+    GLuint m_fbo = 0;
+
+    cv::Mat m_buffer;               // packed RGBA8 texels
+    cv::Mat m_result;               // view of m_buffer
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__PackedReader__) */
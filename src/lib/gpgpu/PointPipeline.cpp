@@ -0,0 +1,112 @@
+//
+//  PointPipeline.cpp
+//  gatherer
+//
+
+#include "gpgpu/PointPipeline.h"
+
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+void PointPipeline::add(PointStage *stage)
+{
+    m_entries.push_back({ stage, nullptr });
+}
+
+void PointPipeline::add(ogles_gpgpu::ProcInterface *proc)
+{
+    m_entries.push_back({ nullptr, proc });
+}
+
+void PointPipeline::build(bool fuse)
+{
+    if(!m_passes.empty())
+    {
+        throw std::logic_error("PointPipeline: build() was already called");
+    }
+
+    // Stages reading source sample the input of the first pass after the last regular proc
+    std::vector<PointStage *> run;
+    FusedPointProc *head = nullptr;
+    auto flush = [&]()
+    {
+        if(run.empty())
+        {
+            return;
+        }
+
+        FusedPointProc *proc = createFused(run, head);
+        if(proc)
+        {
+            m_passes.push_back(proc);
+            head = head ? head : proc;
+        }
+        else
+        {
+            // Fallback: one pass per stage
+            for(auto *stage : run)
+            {
+                FusedPointProc *single = createFused({ stage }, head);
+                if(!single)
+                {
+                    throw std::runtime_error("PointPipeline: invalid stage " + std::string(stage->getName()) + ":\n" + m_compileLog);
+                }
+                m_passes.push_back(single);
+                head = head ? head : single;
+            }
+        }
+        run.clear();
+    };
+
+    for(const auto &entry : m_entries)
+    {
+        if(entry.stage)
+        {
+            if(!fuse)
+            {
+                flush();
+            }
+            run.push_back(entry.stage);
+        }
+        else
+        {
+            flush();
+            m_passes.push_back(entry.proc);
+            head = nullptr;
+        }
+    }
+    flush();
+
+    for(size_t i = 1; i < m_passes.size(); i++)
+    {
+        m_passes[i - 1]->add(m_passes[i]);
+    }
+}
+
+FusedPointProc * PointPipeline::createFused(const std::vector<PointStage *> &stages, const FusedPointProc *head)
+{
+    std::unique_ptr<FusedPointProc> proc = make_unique<FusedPointProc>(stages, head);
+
+    std::string log;
+    if(!proc->validate(log))
+    {
+        m_compileLog += log;
+        return nullptr;
+    }
+
+    m_fused.push_back(std::move(proc));
+    return m_fused.back().get();
+}
+
+ogles_gpgpu::ProcInterface * PointPipeline::getFirst() const
+{
+    return m_passes.empty() ? nullptr : m_passes.front();
+}
+
+ogles_gpgpu::ProcInterface * PointPipeline::getLast() const
+{
+    return m_passes.empty() ? nullptr : m_passes.back();
+}
+
+_GATHERER_GRAPHICS_END
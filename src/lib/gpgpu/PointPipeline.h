@@ -0,0 +1,91 @@
+//
+//  PointPipeline.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__PointPipeline__
+#define __gatherer__gpgpu__PointPipeline__
+
+#include "graphics/gatherer_graphics.h"
+#include "gpgpu/PointStage.h"
+#include "gpgpu/FusedPointProc.h"
+
+#include "ogles_gpgpu/common/proc/base/procinterface.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class PointPipeline
+ *
+ * \brief Linear chain of point-wise stages and regular procs with pass fusion
+ *
+ * build() turns each run of consecutive PointStage entries into a single
+ * FusedPointProc and chains the result with the regular procs (which are
+ * never fused, typically because they sample a neighbourhood):
+ *
+ * @code
+ *
+ * gatherer::graphics::GrayscaleStage grayscale;
+ * gatherer::graphics::GainOffsetStage contrast(1.5f, -0.25f);
+ * ogles_gpgpu::GradProc gradProc;
+ *
+ * gatherer::graphics::PointPipeline pipeline;
+ * pipeline.add(&grayscale);
+ * pipeline.add(&contrast);
+ * pipeline.add(&gradProc);
+ * pipeline.build();          // 2 passes: FusedPointProc -> GradProc
+ *
+ * video.set(pipeline.getFirst());
+ *
+ * @endcode
+ *
+ * With fuse == false every stage gets its own pass, which is the reference
+ * the fused graph is validated against (stages reading source get the run
+ * input as a second texture, see FusedPointProc).  The same unfused graph is used
+ * when a fused shader fails to compile, so build() needs a current GL
+ * context; a stage that doesn't compile on its own makes build() throw
+ * std::runtime_error.  Stages and procs are owned by the caller.
+ */
+
+class PointPipeline
+{
+public:
+
+    void add(PointStage *stage);
+    void add(ogles_gpgpu::ProcInterface *proc);
+
+    /// Create and chain the passes (call once, before the procs are initialized)
+    void build(bool fuse = true);
+
+    ogles_gpgpu::ProcInterface * getFirst() const;
+    ogles_gpgpu::ProcInterface * getLast() const;
+
+    /// Render passes after build()
+    const std::vector<ogles_gpgpu::ProcInterface *> & getPasses() const { return m_passes; }
+
+    /// Compiler output of the fused shaders that fell back to separate passes (empty if none)
+    const std::string & getCompileLog() const { return m_compileLog; }
+
+protected:
+
+    struct Entry
+    {
+        PointStage *stage;
+        ogles_gpgpu::ProcInterface *proc;
+    };
+
+    FusedPointProc * createFused(const std::vector<PointStage *> &stages, const FusedPointProc *head);
+
+    std::vector<Entry> m_entries;
+    std::vector<ogles_gpgpu::ProcInterface *> m_passes;
+    std::vector<std::unique_ptr<FusedPointProc>> m_fused;
+    std::string m_compileLog;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__PointPipeline__) */
@@ -0,0 +1,121 @@
+//
+//  PointStage.cpp
+//  gatherer
+//
+
+#include "gpgpu/PointStage.h"
+
+_GATHERER_GRAPHICS_BEGIN
+
+// ########### GrayscaleStage ###########
+
+GrayscaleStage::GrayscaleStage(Order order)
+{
+    if(order == kRGB)
+    {
+        setWeights(0.299f, 0.587f, 0.114f);
+    }
+    else
+    {
+        setWeights(0.114f, 0.587f, 0.299f);
+    }
+}
+
+void GrayscaleStage::setWeights(float r, float g, float b)
+{
+    m_weights[0] = r;
+    m_weights[1] = g;
+    m_weights[2] = b;
+}
+
+std::string GrayscaleStage::getSource(const std::string &prefix) const
+{
+    return
+    "    float gray = dot(color.rgb, " + prefix + "weights);\n"
+    "    return vec4(gray, gray, gray, 1.0);\n";
+}
+
+std::vector<PointUniform> GrayscaleStage::getUniforms() const
+{
+    return { { "weights", PointUniform::kVec3, m_weights } };
+}
+
+// ########### GainOffsetStage ###########
+
+GainOffsetStage::GainOffsetStage(float gain, float offset)
+: m_gain(gain)
+, m_offset(offset)
+{
+
+}
+
+std::string GainOffsetStage::getSource(const std::string &prefix) const
+{
+    return "    return vec4(color.rgb * " + prefix + "gain + " + prefix + "offset, color.a);\n";
+}
+
+std::vector<PointUniform> GainOffsetStage::getUniforms() const
+{
+    return { { "gain", PointUniform::kFloat, &m_gain }, { "offset", PointUniform::kFloat, &m_offset } };
+}
+
+// ########### ColorMatrixStage ###########
+
+ColorMatrixStage::ColorMatrixStage(const cv::Matx44f &matrix, const cv::Vec4f &offset)
+: m_offset(offset)
+{
+    setMatrix(matrix);
+}
+
+void ColorMatrixStage::setMatrix(const cv::Matx44f &matrix)
+{
+    m_matrix = matrix.t();
+}
+
+std::string ColorMatrixStage::getSource(const std::string &prefix) const
+{
+    return "    return " + prefix + "matrix * color + " + prefix + "offset;\n";
+}
+
+std::vector<PointUniform> ColorMatrixStage::getUniforms() const
+{
+    return { { "matrix", PointUniform::kMat4, m_matrix.val }, { "offset", PointUniform::kVec4, m_offset.val } };
+}
+
+// ########### ThresholdStage ###########
+
+ThresholdStage::ThresholdStage(float threshold)
+: m_threshold(threshold)
+{
+
+}
+
+std::string ThresholdStage::getSource(const std::string &prefix) const
+{
+    return "    return vec4(step(vec3(" + prefix + "threshold), color.rgb), color.a);\n";
+}
+
+std::vector<PointUniform> ThresholdStage::getUniforms() const
+{
+    return { { "threshold", PointUniform::kFloat, &m_threshold } };
+}
+
+// ########### BlendStage ###########
+
+BlendStage::BlendStage(float alpha)
+: m_alpha(alpha)
+{
+
+}
+
+std::string BlendStage::getSource(const std::string &prefix) const
+{
+    return "    return mix(source, color, " + prefix + "alpha);\n";
+}
+
+std::vector<PointUniform> BlendStage::getUniforms() const
+{
+    return { { "alpha", PointUniform::kFloat, &m_alpha } };
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,163 @@
+//
+//  PointStage.h
+//  gatherer
+//
+//  Point-wise stages described as GLSL snippets.  A stage never samples a
+//  neighbourhood: its output texel depends only on the input texel at the
+//  same position, so any run of stages can be evaluated in one fragment
+//  shader (see FusedPointProc and PointPipeline).
+//
+
+#ifndef __gatherer__gpgpu__PointStage__
+#define __gatherer__gpgpu__PointStage__
+
+#include "graphics/gatherer_graphics.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <string>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/// A float uniform read by a stage snippet (value is owned by the stage)
+struct PointUniform
+{
+    enum Type { kFloat = 1, kVec2 = 2, kVec3 = 3, kVec4 = 4, kMat4 = 16 };
+
+    std::string name;
+    Type type;
+    const float *value;
+};
+
+/**
+ * \class PointStage
+ *
+ * \brief One point-wise operation of a fusable chain
+ *
+ * getSource() returns the body of
+ *
+ * @code
+ * vec4 <prefix>apply(vec4 color, vec4 source)
+ * @endcode
+ *
+ * where color is the output of the previous stage and source is the
+ * unmodified input texel of the chain.  Uniforms listed by getUniforms() are
+ * declared by the fused shader as <prefix><name>, and are re-uploaded on
+ * every render, so setters only need to update the stored values.
+ *
+ * Stages reading source must say so with readsSource(): in a pass that
+ * doesn't start the chain the input is bound as a second texture.
+ */
+
+class PointStage
+{
+public:
+
+    virtual ~PointStage() {}
+    virtual const char *getName() const = 0;
+    virtual std::string getSource(const std::string &prefix) const = 0;
+    virtual std::vector<PointUniform> getUniforms() const { return {}; }
+    virtual bool readsSource() const { return false; }
+};
+
+/// Luminance with the GrayscaleProc weights, replicated to rgb (alpha = 1)
+class GrayscaleStage : public PointStage
+{
+public:
+
+    enum Order { kRGB, kBGR };
+
+    explicit GrayscaleStage(Order order = kRGB);
+
+    virtual const char *getName() const { return "GrayscaleStage"; }
+    virtual std::string getSource(const std::string &prefix) const;
+    virtual std::vector<PointUniform> getUniforms() const;
+
+    void setWeights(float r, float g, float b);
+
+protected:
+
+    float m_weights[3];
+};
+
+/// rgb * gain + offset (alpha unchanged)
+class GainOffsetStage : public PointStage
+{
+public:
+
+    GainOffsetStage(float gain = 1.f, float offset = 0.f);
+
+    virtual const char *getName() const { return "GainOffsetStage"; }
+    virtual std::string getSource(const std::string &prefix) const;
+    virtual std::vector<PointUniform> getUniforms() const;
+
+    void setGain(float gain) { m_gain = gain; }
+    void setOffset(float offset) { m_offset = offset; }
+
+protected:
+
+    float m_gain;
+    float m_offset;
+};
+
+/// color = matrix * color + offset, for color space conversions and channel swizzles
+class ColorMatrixStage : public PointStage
+{
+public:
+
+    ColorMatrixStage(const cv::Matx44f &matrix = cv::Matx44f::eye(), const cv::Vec4f &offset = cv::Vec4f());
+
+    virtual const char *getName() const { return "ColorMatrixStage"; }
+    virtual std::string getSource(const std::string &prefix) const;
+    virtual std::vector<PointUniform> getUniforms() const;
+
+    void setMatrix(const cv::Matx44f &matrix);
+    void setOffset(const cv::Vec4f &offset) { m_offset = offset; }
+
+protected:
+
+    cv::Matx44f m_matrix; // column major, as glUniformMatrix4fv expects
+    cv::Vec4f m_offset;
+};
+
+/// rgb >= threshold ? 1 : 0 (alpha unchanged)
+class ThresholdStage : public PointStage
+{
+public:
+
+    explicit ThresholdStage(float threshold = 0.5f);
+
+    virtual const char *getName() const { return "ThresholdStage"; }
+    virtual std::string getSource(const std::string &prefix) const;
+    virtual std::vector<PointUniform> getUniforms() const;
+
+    void setThreshold(float threshold) { m_threshold = threshold; }
+
+protected:
+
+    float m_threshold;
+};
+
+/// mix(source, color, alpha): BlendProc with the chain input on position 0
+class BlendStage : public PointStage
+{
+public:
+
+    explicit BlendStage(float alpha = 1.f);
+
+    virtual const char *getName() const { return "BlendStage"; }
+    virtual std::string getSource(const std::string &prefix) const;
+    virtual std::vector<PointUniform> getUniforms() const;
+    virtual bool readsSource() const { return true; }
+
+    void setAlpha(float alpha) { m_alpha = alpha; }
+
+protected:
+
+    float m_alpha;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__PointStage__) */
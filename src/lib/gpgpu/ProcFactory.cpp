@@ -0,0 +1,115 @@
+//
+//  ProcFactory.cpp
+//  gatherer
+//
+
+#include "gpgpu/ProcFactory.h"
+
+#include "ogles_gpgpu/ogles_gpgpu.h"
+#include "ogles_gpgpu/common/proc/blend.h"
+#include "ogles_gpgpu/common/proc/grayscale.h"
+#include "ogles_gpgpu/common/proc/grad.h"
+#include "ogles_gpgpu/common/proc/lbp.h"
+#include "ogles_gpgpu/common/proc/nms.h"
+#include "ogles_gpgpu/common/proc/shitomasi.h"
+#include "ogles_gpgpu/common/proc/tensor.h"
+
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+static ogles_gpgpu::GrayscaleInputConvType getConversion(const NodeDescription &node)
+{
+    const std::string conversion = node.getString("conversion", "rgb");
+    if(conversion == "none")
+    {
+        return ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_NONE;
+    }
+    else if(conversion == "rgb")
+    {
+        return ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_RGB;
+    }
+    else if(conversion == "bgr")
+    {
+        return ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_BGR;
+    }
+    throw std::runtime_error("ProcFactory: unknown grayscale conversion " + conversion + " for node " + node.name);
+}
+
+ProcFactory::ProcFactory()
+{
+    add("grayscale", [](const NodeDescription &node) -> Proc
+    {
+        std::unique_ptr<ogles_gpgpu::GrayscaleProc> proc = make_unique<ogles_gpgpu::GrayscaleProc>();
+        proc->setGrayscaleConvType(getConversion(node));
+        return std::move(proc);
+    });
+    add("grad", [](const NodeDescription &) -> Proc
+    {
+        return make_unique<ogles_gpgpu::GradProc>();
+    });
+    add("gauss", [](const NodeDescription &) -> Proc
+    {
+        return make_unique<ogles_gpgpu::GaussProc>();
+    });
+    add("lbp", [](const NodeDescription &) -> Proc
+    {
+        return make_unique<ogles_gpgpu::LbpProc>();
+    });
+    add("tensor", [](const NodeDescription &node) -> Proc
+    {
+        std::unique_ptr<ogles_gpgpu::TensorProc> proc = make_unique<ogles_gpgpu::TensorProc>();
+        proc->setEdgeStrength(node.getFloat("edgeStrength", 1.f));
+        return std::move(proc);
+    });
+    add("shitomasi", [](const NodeDescription &node) -> Proc
+    {
+        std::unique_ptr<ogles_gpgpu::ShiTomasiProc> proc = make_unique<ogles_gpgpu::ShiTomasiProc>();
+        proc->setSensitivity(node.getFloat("sensitivity", 1.f));
+        return std::move(proc);
+    });
+    add("nms", [](const NodeDescription &node) -> Proc
+    {
+        std::unique_ptr<ogles_gpgpu::NmsProc> proc = make_unique<ogles_gpgpu::NmsProc>();
+        proc->setThreshold(node.getFloat("threshold", 0.1f));
+        return std::move(proc);
+    });
+    add("blend", [](const NodeDescription &node) -> Proc
+    {
+        std::unique_ptr<ogles_gpgpu::BlendProc> proc = make_unique<ogles_gpgpu::BlendProc>();
+        proc->setAlpha(node.getFloat("alpha", 0.5f));
+        return std::move(proc);
+    });
+}
+
+void ProcFactory::add(const std::string &type, const Creator &creator)
+{
+    m_creators[type] = creator;
+}
+
+bool ProcFactory::has(const std::string &type) const
+{
+    return m_creators.find(type) != m_creators.end();
+}
+
+std::vector<std::string> ProcFactory::getTypes() const
+{
+    std::vector<std::string> types;
+    for(const auto &creator : m_creators)
+    {
+        types.push_back(creator.first);
+    }
+    return types;
+}
+
+ProcFactory::Proc ProcFactory::create(const NodeDescription &node) const
+{
+    auto iter = m_creators.find(node.type);
+    if(iter == m_creators.end())
+    {
+        throw std::runtime_error("ProcFactory: unknown type " + node.type + " for node " + node.name);
+    }
+    return iter->second(node);
+}
+
+_GATHERER_GRAPHICS_END
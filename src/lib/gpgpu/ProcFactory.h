@@ -0,0 +1,63 @@
+//
+//  ProcFactory.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__ProcFactory__
+#define __gatherer__gpgpu__ProcFactory__
+
+#include "graphics/gatherer_graphics.h"
+#include "gpgpu/GraphDescription.h"
+
+#include "ogles_gpgpu/common/proc/base/procinterface.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class ProcFactory
+ *
+ * \brief Creates procs for the node types of a GraphDescription
+ *
+ * The default factory knows the ogles_gpgpu filters used by the gatherer
+ * pipelines:
+ *
+ *   grayscale  conversion = none | rgb | bgr (default rgb)
+ *   grad, gauss, lbp
+ *   tensor     edgeStrength
+ *   shitomasi  sensitivity
+ *   nms        threshold
+ *   blend      alpha (two inputs)
+ *
+ * Applications register their own types with add().
+ */
+
+class ProcFactory
+{
+public:
+
+    using Proc = std::unique_ptr<ogles_gpgpu::ProcInterface>;
+    using Creator = std::function<Proc(const NodeDescription &node)>;
+
+    ProcFactory();
+
+    void add(const std::string &type, const Creator &creator);
+    bool has(const std::string &type) const;
+    std::vector<std::string> getTypes() const;
+
+    /// Throws std::runtime_error for an unknown type
+    Proc create(const NodeDescription &node) const;
+
+protected:
+
+    std::map<std::string, Creator> m_creators;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__ProcFactory__) */
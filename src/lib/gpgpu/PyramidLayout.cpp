@@ -0,0 +1,70 @@
+//
+//  PyramidLayout.cpp
+//  gatherer
+//
+
+#include "gpgpu/PyramidLayout.h"
+
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+PyramidLayout::PyramidLayout(const std::vector<cv::Rect> &levels)
+: levels(levels)
+{
+    const cv::Rect bounds = getBounds();
+    textureSize = cv::Size(bounds.x + bounds.width, bounds.y + bounds.height);
+}
+
+PyramidLayout PyramidLayout::octaves(const cv::Size &size, int count)
+{
+    std::vector<cv::Rect> levels;
+    cv::Point tl(0, 0);
+    cv::Size level = size;
+    for(int i = 0; i < count && level.area() > 0; i++)
+    {
+        levels.emplace_back(tl, level);
+        if(i % 2)
+        {
+            tl.y += level.height;
+        }
+        else
+        {
+            tl.x += level.width;
+        }
+        level.width >>= 1;
+        level.height >>= 1;
+    }
+    return PyramidLayout(levels);
+}
+
+cv::Rect_<float> PyramidLayout::getTexCoords(int level) const
+{
+    const cv::Rect &roi = levels.at(level);
+    const float sx = 1.f / float(textureSize.width);
+    const float sy = 1.f / float(textureSize.height);
+    return cv::Rect_<float>(float(roi.x) * sx, float(roi.y) * sy, float(roi.width) * sx, float(roi.height) * sy);
+}
+
+cv::Rect PyramidLayout::getBounds(const std::vector<int> &selection) const
+{
+    cv::Rect bounds;
+    if(selection.empty())
+    {
+        for(const auto &roi : levels)
+        {
+            bounds = bounds.area() ? (bounds | roi) : roi;
+        }
+    }
+    else
+    {
+        for(int level : selection)
+        {
+            const cv::Rect &roi = levels.at(level);
+            bounds = bounds.area() ? (bounds | roi) : roi;
+        }
+    }
+    return bounds;
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,50 @@
+//
+//  PyramidLayout.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__PyramidLayout__
+#define __gatherer__gpgpu__PyramidLayout__
+
+#include "graphics/gatherer_graphics.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \struct PyramidLayout
+ *
+ * \brief Placement of the levels of a pyramid packed into one texture
+ *
+ * octaves() reproduces the PyramidProc packing: level 0 at the origin and the
+ * halved levels spiralling to its right, alternately stepping in x and y.
+ * Other packings (e.g. PyramidProc::setScales()) are described by listing
+ * their level rectangles.
+ */
+
+struct PyramidLayout
+{
+    PyramidLayout() {}
+    explicit PyramidLayout(const std::vector<cv::Rect> &levels);
+
+    /// Level 0 of the given size and count - 1 halved levels
+    static PyramidLayout octaves(const cv::Size &size, int count);
+
+    size_t size() const { return levels.size(); }
+
+    /// Normalized texture coordinates of a level, for GPU consumers sampling the packed texture
+    cv::Rect_<float> getTexCoords(int level) const;
+
+    /// Bounding box of some levels (all if empty)
+    cv::Rect getBounds(const std::vector<int> &selection = {}) const;
+
+    cv::Size textureSize;           // size of the packed texture
+    std::vector<cv::Rect> levels;   // pixel rectangle of each level within it
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__PyramidLayout__) */
@@ -0,0 +1,74 @@
+//
+//  PyramidReader.cpp
+//  gatherer
+//
+
+#include "gpgpu/PyramidReader.h"
+
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+PyramidReader::PyramidReader(const PyramidLayout &layout)
+: m_layout(layout)
+, m_views(layout.size())
+{
+
+}
+
+PyramidReader::~PyramidReader()
+{
+    if(m_fbo)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+}
+
+void PyramidReader::operator()(GLuint texture, const std::vector<int> &selection)
+{
+    const cv::Rect bounds = m_layout.getBounds(selection);
+
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    if(!m_fbo)
+    {
+        glGenFramebuffers(1, &m_fbo);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        throw std::runtime_error("PyramidReader: texture is not renderable");
+    }
+
+    // Rows of RGBA8 are always 4 byte aligned, so the buffer is read in place
+    m_buffer.create(bounds.size(), CV_8UC4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(bounds.x, bounds.y, bounds.width, bounds.height, GL_RGBA, GL_UNSIGNED_BYTE, m_buffer.ptr());
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    for(auto &view : m_views)
+    {
+        view.release();
+    }
+
+    std::vector<int> all;
+    const std::vector<int> *levels = &selection;
+    if(selection.empty())
+    {
+        for(int i = 0; i < int(m_layout.size()); i++)
+        {
+            all.push_back(i);
+        }
+        levels = &all;
+    }
+    for(int level : *levels)
+    {
+        m_views[level] = m_buffer(m_layout.levels[level] - bounds.tl());
+    }
+}
+
+_GATHERER_GRAPHICS_END
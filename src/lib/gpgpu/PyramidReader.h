@@ -0,0 +1,66 @@
+//
+//  PyramidReader.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__PyramidReader__
+#define __gatherer__gpgpu__PyramidReader__
+
+#include "graphics/gatherer_graphics.h"
+#include "gpgpu/PyramidLayout.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class PyramidReader
+ *
+ * \brief Per-level cv::Mat views of a packed pyramid texture
+ *
+ * One glReadPixels of the bounding box of the requested levels; every level
+ * is then a cv::Mat header into that buffer, so no level is copied:
+ *
+ * @code
+ *
+ * auto layout = gatherer::graphics::PyramidLayout::octaves(image.size(), 5);
+ * gatherer::graphics::PyramidReader reader(layout);
+ * reader(pyrProc.getOutputTexId(), { 3, 4 });  // coarse levels only
+ * const cv::Mat &level3 = reader.getLevel(3);  // CV_8UC4 view
+ *
+ * @endcode
+ *
+ * Views stay valid until the next read.  Levels that were not requested
+ * are empty.
+ */
+
+class PyramidReader
+{
+public:
+
+    explicit PyramidReader(const PyramidLayout &layout);
+    ~PyramidReader();
+
+    /// Read the selected levels (all if empty) of a texture packed as the layout
+    void operator()(GLuint texture, const std::vector<int> &selection = {});
+
+    const PyramidLayout & getLayout() const { return m_layout; }
+    const cv::Mat & getLevel(int level) const { return m_views.at(level); }
+    const std::vector<cv::Mat> & getLevels() const { return m_views; }
+
+    /// Bytes read back by the last call
+    size_t getReadbackSize() const { return m_buffer.total() * m_buffer.elemSize(); }
+
+protected:
+
+    PyramidLayout m_layout;
+    GLuint m_fbo = 0;
+    cv::Mat m_buffer;               // bounding box of the last selection
+    std::vector<cv::Mat> m_views;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__PyramidReader__) */
@@ -0,0 +1,259 @@
+//
+//  ScaleSpaceGenerator.cpp
+//  gatherer
+//
+
+#include "gpgpu/ScaleSpaceGenerator.h"
+#include "gpgpu/AtlasPacker.h"
+#include "graphics/GLExtra.h"
+#include "graphics/GLStateCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+enum { kAttribPosition, kAttribTexCoord, kAttribTaps };
+
+// Per vertex: atlas position (clip space), input texture coordinate, tap spacing and count
+enum { kVertexFloats = 7 };
+
+static const char *kVertexShader = R"(
+attribute vec4 position;
+attribute vec2 texCoord;
+attribute vec3 taps;
+varying vec2 vTexCoord;
+varying vec3 vTaps;
+void main()
+{
+    vTexCoord = texCoord;
+    vTaps = taps;
+    gl_Position = position;
+})";
+
+// The filter is constant over a level, so the branches are coherent
+static const char *kFragmentShader = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+uniform sampler2D uInputTex;
+varying vec2 vTexCoord;
+varying vec3 vTaps;
+void main()
+{
+    vec2 d = vTaps.xy;
+    if(vTaps.z > 2.5)
+    {
+        vec4 sum = vec4(0.0);
+        for(int j = 0; j < 4; j++)
+        {
+            for(int i = 0; i < 4; i++)
+            {
+                sum += texture2D(uInputTex, vTexCoord + (vec2(float(i), float(j)) - 1.5) * d);
+            }
+        }
+        gl_FragColor = sum * (1.0 / 16.0);
+    }
+    else if(vTaps.z > 1.5)
+    {
+        gl_FragColor = 0.25 * (texture2D(uInputTex, vTexCoord + vec2(-0.5, -0.5) * d) +
+                               texture2D(uInputTex, vTexCoord + vec2( 0.5, -0.5) * d) +
+                               texture2D(uInputTex, vTexCoord + vec2(-0.5,  0.5) * d) +
+                               texture2D(uInputTex, vTexCoord + vec2( 0.5,  0.5) * d));
+    }
+    else
+    {
+        gl_FragColor = texture2D(uInputTex, vTexCoord);
+    }
+})";
+
+ScaleSpaceGenerator::ScaleSpaceGenerator()
+{
+    compileShaders();
+}
+
+ScaleSpaceGenerator::~ScaleSpaceGenerator()
+{
+    release();
+}
+
+std::vector<float> ScaleSpaceGenerator::getGeometricScales(int count, float step)
+{
+    std::vector<float> scales;
+    float scale = 1.f;
+    for(int i = 0; i < count; i++, scale *= step)
+    {
+        scales.push_back(scale);
+    }
+    return scales;
+}
+
+void ScaleSpaceGenerator::setScales(const std::vector<float> &scales)
+{
+    for(float scale : scales)
+    {
+        if(!(scale > 0.f && scale <= 1.f))
+        {
+            throw std::invalid_argument("ScaleSpaceGenerator: scales must be in (0, 1]");
+        }
+    }
+    m_scales = scales;
+    m_dirty = true;
+}
+
+void ScaleSpaceGenerator::setPadding(int padding)
+{
+    m_padding = padding;
+    m_dirty = true;
+}
+
+void ScaleSpaceGenerator::compileShaders()
+{
+    std::vector< std::pair<int, const char *> > attributes
+    {
+        { kAttribPosition, "position" },
+        { kAttribTexCoord, "texCoord" },
+        { kAttribTaps, "taps" }
+    };
+    const GLchar * vShaderStr[] = { kVertexShader };
+    const GLchar * fShaderStr[] = { kFragmentShader };
+    m_program = make_unique<shader_prog>(vShaderStr, fShaderStr, attributes);
+}
+
+void ScaleSpaceGenerator::release()
+{
+    if(m_vbo)
+    {
+        glDeleteBuffers(1, &m_vbo);
+    }
+    if(m_fbo)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+    if(m_texture)
+    {
+        glDeleteTextures(1, &m_texture);
+    }
+    m_vbo = m_fbo = m_texture = 0;
+    m_vertices = 0;
+    GLStateCache::get().invalidate(); // the names can be reused
+}
+
+void ScaleSpaceGenerator::allocate(int width, int height)
+{
+    if(m_scales.empty())
+    {
+        throw std::logic_error("ScaleSpaceGenerator: no scales");
+    }
+    release();
+
+    std::vector<cv::Size> sizes;
+    for(float scale : m_scales)
+    {
+        sizes.emplace_back(std::max(int(float(width) * scale + 0.5f), 1), std::max(int(float(height) * scale + 0.5f), 1));
+    }
+
+    cv::Size atlasSize;
+    m_layout = PyramidLayout(AtlasPacker(m_padding).pack(sizes, atlasSize));
+
+    // Two triangles per level
+    std::vector<GLfloat> vertices;
+    vertices.reserve(m_scales.size() * 6 * kVertexFloats);
+    m_filters.clear();
+    for(const auto &roi : m_layout.levels)
+    {
+        const float footprintX = float(width) / float(roi.width);
+        const float footprintY = float(height) / float(roi.height);
+        const float footprint = std::max(footprintX, footprintY);
+        const Filter filter = (footprint <= 1.25f) ? kBilinear : ((footprint <= 2.5f) ? kBox2x2 : kBox4x4);
+        m_filters.push_back(filter);
+
+        // Tap spacing in texture coordinates, so the taps span the footprint
+        const float dx = (filter == kBilinear) ? 0.f : footprintX / float(filter) / float(width);
+        const float dy = (filter == kBilinear) ? 0.f : footprintY / float(filter) / float(height);
+
+        const float x0 = 2.f * float(roi.x) / float(atlasSize.width) - 1.f;
+        const float y0 = 2.f * float(roi.y) / float(atlasSize.height) - 1.f;
+        const float x1 = 2.f * float(roi.x + roi.width) / float(atlasSize.width) - 1.f;
+        const float y1 = 2.f * float(roi.y + roi.height) / float(atlasSize.height) - 1.f;
+        const GLfloat corners[4][4] = { { x0, y0, 0.f, 0.f }, { x1, y0, 1.f, 0.f }, { x0, y1, 0.f, 1.f }, { x1, y1, 1.f, 1.f } };
+        for(int corner : { 0, 1, 2, 2, 1, 3 })
+        {
+            vertices.insert(vertices.end(), corners[corner], corners[corner] + 4);
+            vertices.insert(vertices.end(), { dx, dy, float(filter) });
+        }
+    }
+    m_vertices = GLsizei(vertices.size() / kVertexFloats);
+
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlasSize.width, atlasSize.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("ScaleSpaceGenerator: incomplete framebuffer");
+    }
+
+    // Padding is never drawn, clear it once
+    glViewport(0, 0, atlasSize.width, atlasSize.height);
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    m_inputSize = cv::Size(width, height);
+    m_dirty = false;
+}
+
+void ScaleSpaceGenerator::operator()(GLuint texture, int width, int height)
+{
+    GLint viewport[4], framebuffer = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    if(m_dirty || m_inputSize != cv::Size(width, height))
+    {
+        allocate(width, height);
+    }
+
+    (*m_program)();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glUniform1i(m_program->GetUniformLocation("uInputTex"), 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_layout.textureSize.width, m_layout.textureSize.height);
+
+    const GLsizei stride = kVertexFloats * sizeof(GLfloat);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glVertexAttribPointer(kAttribPosition, 2, GL_FLOAT, GL_FALSE, stride, (const GLvoid *)0);
+    glVertexAttribPointer(kAttribTexCoord, 2, GL_FLOAT, GL_FALSE, stride, (const GLvoid *)(2 * sizeof(GLfloat)));
+    glVertexAttribPointer(kAttribTaps, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid *)(4 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(kAttribPosition);
+    glEnableVertexAttribArray(kAttribTexCoord);
+    glEnableVertexAttribArray(kAttribTaps);
+
+    glDrawArrays(GL_TRIANGLES, 0, m_vertices);
+
+    // ogles_gpgpu draws from client memory
+    glDisableVertexAttribArray(kAttribTexCoord);
+    glDisableVertexAttribArray(kAttribTaps);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLStateCache::get().invalidate(); // bound outside the cache
+}
+
+_GATHERER_GRAPHICS_END
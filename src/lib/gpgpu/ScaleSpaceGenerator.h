@@ -0,0 +1,103 @@
+//
+//  ScaleSpaceGenerator.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__ScaleSpaceGenerator__
+#define __gatherer__gpgpu__ScaleSpaceGenerator__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLSLShaderProgram.h"
+#include "gpgpu/PyramidLayout.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class ScaleSpaceGenerator
+ *
+ * \brief Many fractional scales of an image rendered into one atlas with one draw call
+ *
+ * A replacement for PyramidProc::setScales() when a sliding window detector
+ * needs dozens of levels: every level is a quad of one static vertex buffer,
+ * so a frame costs one FBO bind and one glDrawArrays whatever the scale count.
+ *
+ * @code
+ *
+ * gatherer::graphics::ScaleSpaceGenerator scaleSpace;
+ * scaleSpace.setScales(gatherer::graphics::ScaleSpaceGenerator::getGeometricScales(32, 0.95f));
+ * scaleSpace(video.getInputTexId(), width, height);
+ * gatherer::graphics::PyramidReader reader(scaleSpace.getLayout());
+ * reader(scaleSpace.getOutputTexId());
+ *
+ * @endcode
+ *
+ * Levels are shelf packed (AtlasPacker) with a texel of padding.  Each level
+ * gets its own anti-aliasing prefilter: a box over its footprint in the input,
+ * made of 1, 2x2 or 4x4 bilinear taps.  The input texture must use GL_LINEAR
+ * filtering.
+ */
+
+class ScaleSpaceGenerator
+{
+public:
+
+    /// Bilinear taps per level, by footprint (input texels per output texel)
+    enum Filter
+    {
+        kBilinear = 1,  // footprint <= 1.25
+        kBox2x2 = 2,    // footprint <= 2.5
+        kBox4x4 = 4
+    };
+
+    ScaleSpaceGenerator();
+    ~ScaleSpaceGenerator();
+
+    /// count scales 1, step, step^2, ...
+    static std::vector<float> getGeometricScales(int count, float step);
+
+    /// Scales of the input in (0, 1], one level each
+    void setScales(const std::vector<float> &scales);
+    const std::vector<float> & getScales() const { return m_scales; }
+
+    void setPadding(int padding);
+
+    /// Render all levels of a width x height GL_TEXTURE_2D
+    void operator()(GLuint texture, int width, int height);
+
+    GLuint getOutputTexId() const { return m_texture; }
+
+    /// Level rectangles within the output texture, for CPU consumers and PyramidReader
+    const PyramidLayout & getLayout() const { return m_layout; }
+
+    Filter getFilter(int level) const { return m_filters.at(level); }
+
+protected:
+
+    void compileShaders();
+    void allocate(int width, int height);
+    void release();
+
+    std::vector<float> m_scales;
+    int m_padding = 1;
+    bool m_dirty = true;
+
+    cv::Size m_inputSize;
+    PyramidLayout m_layout;
+    std::vector<Filter> m_filters;
+
+    GLuint m_texture = 0;
+    GLuint m_fbo = 0;
+    GLuint m_vbo = 0;
+    GLsizei m_vertices = 0;
+
+    std::unique_ptr<shader_prog> m_program;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__ScaleSpaceGenerator__) */
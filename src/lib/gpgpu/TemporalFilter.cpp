@@ -0,0 +1,192 @@
+//
+//  TemporalFilter.cpp
+//  gatherer
+//
+
+#include "gpgpu/TemporalFilter.h"
+#include "graphics/GLExtra.h"
+#include "graphics/GLStateCache.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+_GATHERER_GRAPHICS_BEGIN
+
+enum { kAttribPosition };
+
+static const char *kVertexShader = R"(
+attribute vec4 position;
+varying vec2 vTexCoord;
+void main()
+{
+    vTexCoord = position.xy * 0.5 + 0.5;
+    gl_Position = position;
+})";
+
+// Fragment shader for a given mode and frame count: s<k> = history[k]
+static std::string getFragmentShaderSource(TemporalFilter::Mode mode, int frames)
+{
+    std::stringstream ss;
+    ss << "#ifdef GL_ES\n";
+    ss << "precision mediump float;\n";
+    ss << "#endif\n";
+    ss << "varying vec2 vTexCoord;\n";
+    for(int k = 0; k < frames; k++)
+    {
+        ss << "uniform sampler2D uHistory" << k << ";\n";
+    }
+    ss << "void main()\n";
+    ss << "{\n";
+    for(int k = 0; k < frames; k++)
+    {
+        ss << "    vec4 s" << k << " = texture2D(uHistory" << k << ", vTexCoord);\n";
+    }
+
+    switch(mode)
+    {
+        case TemporalFilter::kMean:
+        {
+            ss << "    gl_FragColor = (s0";
+            for(int k = 1; k < frames; k++)
+            {
+                ss << " + s" << k;
+            }
+            ss << ") / " << frames << ".0;\n";
+            break;
+        }
+        case TemporalFilter::kMedian:
+        {
+            // Odd-even transposition sort, component wise
+            ss << "    vec4 t;\n";
+            for(int pass = 0; pass < frames; pass++)
+            {
+                for(int i = pass % 2; i + 1 < frames; i += 2)
+                {
+                    ss << "    t = min(s" << i << ", s" << (i + 1) << "); ";
+                    ss << "s" << (i + 1) << " = max(s" << i << ", s" << (i + 1) << "); ";
+                    ss << "s" << i << " = t;\n";
+                }
+            }
+            if(frames % 2)
+            {
+                ss << "    gl_FragColor = s" << (frames / 2) << ";\n";
+            }
+            else
+            {
+                ss << "    gl_FragColor = 0.5 * (s" << (frames / 2 - 1) << " + s" << (frames / 2) << ");\n";
+            }
+            break;
+        }
+        case TemporalFilter::kDifference:
+        {
+            ss << "    gl_FragColor = abs(s0 - s" << (frames - 1) << ");\n";
+            break;
+        }
+    }
+    ss << "}\n";
+    return ss.str();
+}
+
+TemporalFilter::TemporalFilter(Mode mode, int frames)
+: m_mode(mode)
+, m_frames(frames)
+{
+    if(frames < 1 || frames > kMaxFrames || (mode == kDifference && frames < 2))
+    {
+        throw std::invalid_argument("TemporalFilter: unsupported number of frames");
+    }
+    compileShaders();
+}
+
+TemporalFilter::~TemporalFilter()
+{
+    release();
+}
+
+void TemporalFilter::compileShaders()
+{
+    const std::string source = getFragmentShaderSource(m_mode, m_frames);
+    std::vector< std::pair<int, const char *> > attributes { { kAttribPosition, "position" } };
+    const GLchar * vShaderStr[] = { kVertexShader };
+    const GLchar * fShaderStr[] = { source.c_str() };
+    m_program = make_unique<shader_prog>(vShaderStr, fShaderStr, attributes);
+
+    (*m_program)();
+    for(int k = 0; k < m_frames; k++)
+    {
+        glUniform1i(m_program->GetUniformLocation(("uHistory" + std::to_string(k)).c_str()), k);
+    }
+    GLStateCache::get().invalidate(); // program used outside the cache
+}
+
+void TemporalFilter::setFormat(GLTextureFormat::Format format)
+{
+    format = GLTextureFormat::resolve(format);
+    if(format != m_format)
+    {
+        release(); // reallocated by the next call
+        m_format = format;
+    }
+}
+
+void TemporalFilter::release()
+{
+    if(m_fbo)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+    if(m_texture)
+    {
+        glDeleteTextures(1, &m_texture);
+    }
+    m_fbo = m_texture = 0;
+    m_size = cv::Size();
+    GLStateCache::get().invalidate(); // the names can be reused
+}
+
+void TemporalFilter::allocate(const cv::Size &size)
+{
+    release();
+
+    glGenTextures(1, &m_texture);
+    GLTextureFormat::allocate(m_texture, size, m_format);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("TemporalFilter: incomplete framebuffer");
+    }
+    m_size = size;
+}
+
+void TemporalFilter::operator()(const FrameHistory &history)
+{
+    static const GLfloat quad[] = { -1.f, -1.f, 1.f, -1.f, -1.f, 1.f, 1.f, 1.f };
+
+    GLint viewport[4], framebuffer = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+
+    if(history.getSize() != m_size)
+    {
+        allocate(history.getSize());
+    }
+
+    (*m_program)();
+    history.bind(GL_TEXTURE0, m_frames);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_size.width, m_size.height);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glVertexAttribPointer(kAttribPosition, 2, GL_FLOAT, GL_FALSE, 0, quad);
+    glEnableVertexAttribArray(kAttribPosition);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLStateCache::get().invalidate(); // bound outside the cache
+}
+
+_GATHERER_GRAPHICS_END
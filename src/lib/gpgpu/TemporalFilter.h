@@ -0,0 +1,91 @@
+//
+//  TemporalFilter.h
+//  gatherer
+//
+
+#ifndef __gatherer__gpgpu__TemporalFilter__
+#define __gatherer__gpgpu__TemporalFilter__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLSLShaderProgram.h"
+#include "graphics/GLTextureFormat.h"
+#include "gpgpu/FrameHistory.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class TemporalFilter
+ *
+ * \brief Per-pixel filter over the last frames of a FrameHistory
+ *
+ * Every frame is sampled in place from the ring (history[k] bound to unit k),
+ * so a filter over N frames reads N textures and writes one:
+ *
+ * @code
+ *
+ * gatherer::graphics::FrameHistory history(5);
+ * gatherer::graphics::TemporalFilter median(gatherer::graphics::TemporalFilter::kMedian, 5);
+ * history.push(grayscaleProc.getOutputTexId(), width, height);
+ * median(history);
+ * GLuint denoised = median.getOutputTexId();
+ *
+ * @endcode
+ *
+ * The median is per channel, by a sorting network.  The output is RGBA8
+ * unless setFormat() asks for another format: kRGBA16F keeps the fractions
+ * of a mean, kR8 suits the difference of gray frames.
+ */
+
+class TemporalFilter
+{
+public:
+
+    enum Mode
+    {
+        kMean,          // average of the frames
+        kMedian,        // per channel median of the frames
+        kDifference     // |history[0] - history[frames - 1]|
+    };
+
+    enum { kMaxFrames = 8 };
+
+    TemporalFilter(Mode mode, int frames);
+    ~TemporalFilter();
+
+    Mode getMode() const { return m_mode; }
+    int getFrames() const { return m_frames; }
+
+    /// Output format, applied by the next call (unsupported formats fall back to RGBA8)
+    void setFormat(GLTextureFormat::Format format);
+    GLTextureFormat::Format getFormat() const { return m_format; }
+
+    /// Filter the newest frames (the oldest available frame stands in while the ring fills)
+    void operator()(const FrameHistory &history);
+
+    GLuint getOutputTexId() const { return m_texture; }
+    const cv::Size & getOutputSize() const { return m_size; }
+
+protected:
+
+    void compileShaders();
+    void allocate(const cv::Size &size);
+    void release();
+
+    Mode m_mode;
+    int m_frames;
+    GLTextureFormat::Format m_format = GLTextureFormat::kRGBA8;
+
+    cv::Size m_size;
+    GLuint m_texture = 0;
+    GLuint m_fbo = 0;
+
+    std::unique_ptr<shader_prog> m_program;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__gpgpu__TemporalFilter__) */
@@ -0,0 +1,56 @@
+# This file generated automatically by:
+#   generate_sugar_files.py
+# see wiki for more info:
+#   https://github.com/ruslo/sugar/wiki/Collecting-sources
+
+if(DEFINED SRC_LIB_GPGPU_SUGAR_CMAKE_)
+  return()
+else()
+  set(SRC_LIB_GPGPU_SUGAR_CMAKE_ 1)
+endif()
+
+include(sugar_files)
+
+sugar_files(
+    GATHERER_GPGPU_SRC
+    AtlasPacker.cpp
+    BatchWarpShader.cpp
+    FrameHistory.cpp
+    FusedPointProc.cpp
+    GradientPlanes.cpp
+    Graph.cpp
+    GraphDescription.cpp
+    KeypointCompactor.cpp
+    LucasKanadeTracker.cpp
+    PackedLuma.cpp
+    PackedReader.cpp
+    PointPipeline.cpp
+    PointStage.cpp
+    ProcFactory.cpp
+    PyramidLayout.cpp
+    PyramidReader.cpp
+    ScaleSpaceGenerator.cpp
+    TemporalFilter.cpp
+)
+
+sugar_files(
+    GATHERER_GPGPU_HDRS
+    AtlasPacker.h
+    BatchWarpShader.h
+    FrameHistory.h
+    FusedPointProc.h
+    GradientPlanes.h
+    Graph.h
+    GraphDescription.h
+    KeypointCompactor.h
+    LucasKanadeTracker.h
+    PackedLuma.h
+    PackedReader.h
+    PointPipeline.h
+    PointStage.h
+    ProcFactory.h
+    PyramidLayout.h
+    PyramidReader.h
+    ScaleSpaceGenerator.h
+    TemporalFilter.h
+)
@@ -0,0 +1,134 @@
+//
+//  GLCapabilities.cpp
+//  gatherer
+//
+
+#include "graphics/GLCapabilities.h"
+#include "graphics/GLTextureFormat.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+_GATHERER_GRAPHICS_BEGIN
+
+// GLES 2.0 extension string (not used for desktop core profiles, where GL_EXTENSIONS is an error)
+static bool hasExtension(const char *name)
+{
+    const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+    return extensions && std::strstr(extensions, name);
+}
+
+// Headers and version numbers don't tell: float targets are extensions on GLES 3.0
+static bool isColorRenderable(GLTextureFormat::Format format)
+{
+    const GLTextureFormat desc = GLTextureFormat::get(format);
+    if(desc.internalFormat == GL_RGBA && format != GLTextureFormat::kRGBA8)
+    {
+        return false; // not declared by the GL headers
+    }
+
+    GLint texture = 0, framebuffer = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    while(glGetError() != GL_NO_ERROR);
+
+    GLuint probeTexture = 0, probeFbo = 0;
+    glGenTextures(1, &probeTexture);
+    GLTextureFormat::allocate(probeTexture, cv::Size(4, 4), format);
+    glGenFramebuffers(1, &probeFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, probeFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, probeTexture, 0);
+    const bool complete = (glGetError() == GL_NO_ERROR) && (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glDeleteFramebuffers(1, &probeFbo);
+    glDeleteTextures(1, &probeTexture);
+    return complete;
+}
+
+GLCapabilities GLCapabilities::detect()
+{
+    GLCapabilities caps;
+
+    // "OpenGL ES 3.1 Mesa ..." or "4.5 (Core Profile) Mesa ..."
+    const char *version = (const char *)glGetString(GL_VERSION);
+    if(version)
+    {
+        const char *prefix = "OpenGL ES ";
+        caps.es = (std::strncmp(version, prefix, std::strlen(prefix)) == 0);
+        if(std::sscanf(caps.es ? version + std::strlen(prefix) : version, "%d.%d", &caps.major, &caps.minor) != 2)
+        {
+            caps.major = 2;
+            caps.minor = 0;
+        }
+    }
+    if(const char *renderer = (const char *)glGetString(GL_RENDERER))
+    {
+        caps.renderer = renderer;
+    }
+
+    const int number = caps.major * 10 + caps.minor;
+#if defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+    caps.fenceSync = caps.es ? (number >= 30) : (number >= 32);
+#endif
+
+#if defined(GL_PIXEL_UNPACK_BUFFER) && defined(GL_MAP_WRITE_BIT)
+    // Buffer objects are mapped with glMapBufferRange(), pixel buffers alone are GL 2.1
+    caps.pixelBuffers = (number >= 30) || (!caps.es && hasExtension("GL_ARB_map_buffer_range"));
+#endif
+#if defined(GL_TEXTURE_IMMUTABLE_FORMAT)
+    caps.textureStorage = caps.es ? (number >= 30) : (number >= 42);
+#endif
+#if defined(GL_TEXTURE_SWIZZLE_R)
+    caps.textureSwizzle = caps.es ? (number >= 30) : (number >= 33);
+#endif
+    caps.unpackRowLength = !caps.es || (number >= 30) || hasExtension("GL_EXT_unpack_subimage");
+
+    if(number >= 30)
+    {
+        caps.renderR8 = isColorRenderable(GLTextureFormat::kR8);
+        caps.renderRG8 = isColorRenderable(GLTextureFormat::kRG8);
+        caps.renderRGBA16F = isColorRenderable(GLTextureFormat::kRGBA16F);
+        caps.renderR32F = isColorRenderable(GLTextureFormat::kR32F);
+    }
+
+#if defined(GL_MAX_DRAW_BUFFERS) && defined(GL_MAX_COLOR_ATTACHMENTS)
+    caps.drawBuffers = (number >= 30);
+    if(caps.drawBuffers)
+    {
+        GLint drawBuffers = 1, attachments = 1;
+        glGetIntegerv(GL_MAX_DRAW_BUFFERS, &drawBuffers);
+        glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &attachments);
+        caps.maxDrawBuffers = std::min(drawBuffers, attachments);
+    }
+#endif
+
+#if GATHERER_HAS_COMPUTE_SHADER
+    caps.computeShaders = caps.es ? (number >= 31) : (number >= 43);
+
+    const char *enabled = std::getenv("GATHERER_GL_COMPUTE");
+    if(enabled && std::strcmp(enabled, "0") == 0)
+    {
+        caps.computeShaders = false;
+    }
+
+    if(caps.computeShaders)
+    {
+        glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &caps.maxComputeWorkGroupInvocations);
+        glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &caps.maxComputeSharedMemorySize);
+    }
+#endif
+
+    return caps;
+}
+
+const GLCapabilities & GLCapabilities::get()
+{
+    static const GLCapabilities caps = detect();
+    return caps;
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,81 @@
+//
+//  GLCapabilities.h
+//  gatherer
+//
+
+#ifndef __gatherer__GLCapabilities__
+#define __gatherer__GLCapabilities__
+
+#include "graphics/gatherer_graphics.h"
+
+#include <string>
+
+// Compute shader entry points are only declared by GL 4.3 / GLES 3.1 headers
+#if defined(GL_COMPUTE_SHADER)
+#  define GATHERER_HAS_COMPUTE_SHADER 1
+#else
+#  define GATHERER_HAS_COMPUTE_SHADER 0
+#endif
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \struct GLCapabilities
+ *
+ * \brief Features of the current GL context that select optional code paths
+ *
+ * @code
+ *
+ * const auto &caps = gatherer::graphics::GLCapabilities::get(); // after context creation
+ * if(caps.computeShaders) { ... }
+ *
+ * @endcode
+ *
+ * Compute shaders need GL 4.3 or GLES 3.1 and fence sync objects GL 3.2 or
+ * GLES 3.0 at run time, and headers that declare them at build time.
+ * Setting the GATHERER_GL_COMPUTE environment variable to 0 disables
+ * compute shaders, to exercise the fallback paths.
+ */
+
+struct GLCapabilities
+{
+    int major = 2;
+    int minor = 0;
+    bool es = false;
+    std::string renderer;
+
+    bool fenceSync = false;                 // GLsync (GL 3.2 / GLES 3.0), see GLFence
+
+    // Texture upload paths, see GLTexture
+    bool pixelBuffers = false;              // GL_PIXEL_UNPACK_BUFFER and glMapBufferRange (GL 3.0 / GLES 3.0, GL_ARB_map_buffer_range)
+    bool textureStorage = false;            // glTexStorage2D (GL 4.2 / GLES 3.0)
+    bool textureSwizzle = false;            // GL_TEXTURE_SWIZZLE_* (GL 3.3 / GLES 3.0)
+    bool unpackRowLength = false;           // GL_UNPACK_ROW_LENGTH (GL, GLES 3.0, GL_EXT_unpack_subimage)
+
+    // Color renderable formats besides RGBA8, probed with a framebuffer, see GLTextureFormat
+    bool renderR8 = false;                  // GL 3.0 / GLES 3.0
+    bool renderRG8 = false;                 // GL 3.0 / GLES 3.0
+    bool renderRGBA16F = false;             // GL 3.0 / GLES 3.2, GL_EXT_color_buffer_half_float
+    bool renderR32F = false;                // GL 3.0 / GLES 3.2, GL_EXT_color_buffer_float
+
+    // Multiple render targets, see GradientPlanes
+    bool drawBuffers = false;               // glDrawBuffers (GL 3.0 / GLES 3.0)
+    int maxDrawBuffers = 1;                 // min(GL_MAX_DRAW_BUFFERS, GL_MAX_COLOR_ATTACHMENTS)
+
+    bool computeShaders = false;
+    int maxComputeWorkGroupInvocations = 0;
+    int maxComputeSharedMemorySize = 0;     // bytes
+
+    /// GLSL version line for compute shaders ("#version 430" or "#version 310 es")
+    const char * getComputeVersion() const { return es ? "#version 310 es\n" : "#version 430\n"; }
+
+    /// Query the current context
+    static GLCapabilities detect();
+
+    /// Capabilities of the processing context, detected by the first call (the context must be current)
+    static const GLCapabilities & get();
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__GLCapabilities__) */
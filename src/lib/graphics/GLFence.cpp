@@ -0,0 +1,180 @@
+//
+//  GLFence.cpp
+//  gatherer
+//
+
+#include "graphics/GLFence.h"
+#include "graphics/GLCapabilities.h"
+
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+static uint64_t nextSerial()
+{
+    static std::atomic<uint64_t> serial { 0 };
+    return ++serial;
+}
+
+GLFence::~GLFence()
+{
+    reset();
+}
+
+void GLFence::reset()
+{
+#if GATHERER_HAS_FENCE_SYNC
+    if(m_sync)
+    {
+        glDeleteSync(m_sync);
+        m_sync = 0;
+    }
+#endif
+    m_serial = 0;
+}
+
+void GLFence::signal(std::initializer_list<GLuint> textures)
+{
+    reset();
+    m_serial = nextSerial();
+#if GATHERER_HAS_FENCE_SYNC
+    if(GLCapabilities::get().fenceSync)
+    {
+        m_sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+#endif
+
+    // Other contexts can only wait on (or see the results of) submitted commands
+    glFlush();
+
+#if defined(GATHERER_ENABLE_OPENGL_DEBUG)
+    for(GLuint texture : textures)
+    {
+        GLFenceValidator::get().signaled(texture, m_serial);
+    }
+#else
+    (void)textures;
+#endif
+}
+
+void GLFence::wait()
+{
+#if GATHERER_HAS_FENCE_SYNC
+    if(m_sync)
+    {
+        glWaitSync(m_sync, 0, GL_TIMEOUT_IGNORED);
+    }
+#endif
+#if defined(GATHERER_ENABLE_OPENGL_DEBUG)
+    if(m_serial)
+    {
+        GLFenceValidator::get().waited(m_serial);
+    }
+#endif
+}
+
+bool GLFence::clientWait(uint64_t timeout)
+{
+    bool reached = true;
+#if GATHERER_HAS_FENCE_SYNC
+    if(m_sync)
+    {
+        const GLenum status = glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        reached = (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED);
+    }
+    else
+#endif
+    if(m_serial)
+    {
+        glFinish();
+    }
+#if defined(GATHERER_ENABLE_OPENGL_DEBUG)
+    if(reached && m_serial)
+    {
+        GLFenceValidator::get().waited(m_serial);
+    }
+#endif
+    return reached;
+}
+
+bool GLFence::isSignaled()
+{
+#if GATHERER_HAS_FENCE_SYNC
+    if(m_sync)
+    {
+        GLint status = GL_UNSIGNALED;
+        glGetSynciv(m_sync, GL_SYNC_STATUS, sizeof(status), nullptr, &status);
+        return status == GL_SIGNALED;
+    }
+#endif
+    return true;
+}
+
+// ########### Validator ###########
+
+GLFenceValidator & GLFenceValidator::get()
+{
+    static GLFenceValidator validator;
+    return validator;
+}
+
+void GLFenceValidator::written(GLuint texture)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry &entry = m_textures[texture];
+    entry.writer = std::this_thread::get_id();
+    entry.fence = 0;
+    entry.readers.clear();
+}
+
+void GLFenceValidator::signaled(GLuint texture, uint64_t fence)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto iter = m_textures.find(texture);
+    if(iter != m_textures.end() && iter->second.writer == std::this_thread::get_id())
+    {
+        iter->second.fence = fence;
+    }
+}
+
+void GLFenceValidator::waited(uint64_t fence)
+{
+    // Only the textures fenced by it remember the wait, so nothing accumulates per fence
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(auto &texture : m_textures)
+    {
+        if(texture.second.fence == fence)
+        {
+            texture.second.readers.insert(std::this_thread::get_id());
+        }
+    }
+}
+
+void GLFenceValidator::read(GLuint texture)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto iter = m_textures.find(texture);
+    if(iter == m_textures.end() || iter->second.writer == std::this_thread::get_id())
+    {
+        return;
+    }
+
+    const Entry &entry = iter->second;
+    if(!entry.fence || !entry.readers.count(std::this_thread::get_id()))
+    {
+        std::stringstream ss;
+        ss << "GLFenceValidator: texture " << texture << " is read in another thread than it was written in, ";
+        ss << (entry.fence ? "without waiting on its fence" : "and the write was never fenced");
+        throw std::logic_error(ss.str());
+    }
+}
+
+void GLFenceValidator::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_textures.clear();
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,138 @@
+//
+//  GLFence.h
+//  gatherer
+//
+
+#ifndef __gatherer__GLFence__
+#define __gatherer__GLFence__
+
+#include "graphics/gatherer_graphics.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// Sync objects are declared by GL 3.2 / GLES 3.0 headers
+#if defined(GL_SYNC_GPU_COMMANDS_COMPLETE)
+#  define GATHERER_HAS_FENCE_SYNC 1
+#else
+#  define GATHERER_HAS_FENCE_SYNC 0
+#endif
+
+// Debug builds check that textures crossing threads are fenced (see GLFenceValidator)
+#if defined(GATHERER_ENABLE_OPENGL_DEBUG)
+#  define GATHERER_GL_WRITTEN(texture) gatherer::graphics::GLFenceValidator::get().written(texture)
+#  define GATHERER_GL_READ(texture) gatherer::graphics::GLFenceValidator::get().read(texture)
+#else
+#  define GATHERER_GL_WRITTEN(texture)
+#  define GATHERER_GL_READ(texture)
+#endif
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class GLFence
+ *
+ * \brief Explicit dependency between a GL producer and its consumer
+ *
+ * GL commands of one context execute in order, so nothing is needed
+ * between stages of one context, and glReadPixels() already waits for its
+ * data.  A fence is only needed where a result crosses to another (shared)
+ * context or thread, or returns to the CPU through an asynchronous path:
+ *
+ * @code
+ *
+ * // Producer context
+ * render(texture);
+ * fence.signal({ texture });
+ *
+ * // Consumer context (another thread)
+ * fence.wait();          // GPU side wait, the CPU does not block
+ * draw(texture);
+ *
+ * @endcode
+ *
+ * Without sync objects (GLES 2.0) signal() flushes the producer and
+ * clientWait() falls back to glFinish().
+ */
+
+class GLFence
+{
+public:
+
+    static const uint64_t kForever = ~uint64_t(0);
+
+    GLFence() {}
+    ~GLFence();
+
+    GLFence(const GLFence &) = delete;
+    GLFence & operator=(const GLFence &) = delete;
+
+    /// Fence the commands issued so far by the current context; textures are the resources they produce
+    void signal(std::initializer_list<GLuint> textures = {});
+
+    /// Order the current context's later commands after the fence, without blocking the CPU
+    void wait();
+
+    /// Block the CPU until the fence is reached (timeout in ns), false on timeout
+    bool clientWait(uint64_t timeout = kForever);
+
+    /// True if the fence was reached (or never signaled)
+    bool isSignaled();
+
+    void reset();
+
+protected:
+
+#if GATHERER_HAS_FENCE_SYNC
+    GLsync m_sync = 0;
+#endif
+    uint64_t m_serial = 0;
+};
+
+/**
+ * \class GLFenceValidator
+ *
+ * \brief Debug check for textures sampled in one thread while produced in another without a fence
+ *
+ * Producers report writes and consumers report reads through the
+ * GATHERER_GL_WRITTEN() and GATHERER_GL_READ() macros, which only exist in
+ * builds with GATHERER_ENABLE_OPENGL_DEBUG.  A read throws std::logic_error
+ * if the last write came from another thread and the reading thread has not
+ * waited on a fence signaled after that write.
+ */
+
+class GLFenceValidator
+{
+public:
+
+    static GLFenceValidator & get();
+
+    void written(GLuint texture);
+    void read(GLuint texture);
+
+    // GLFence bookkeeping
+    void signaled(GLuint texture, uint64_t fence);
+    void waited(uint64_t fence);
+
+    void reset();
+
+protected:
+
+    struct Entry
+    {
+        std::thread::id writer;
+        uint64_t fence = 0;     // 0: last write not fenced
+        std::unordered_set<std::thread::id> readers; // threads that waited on the fence
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<GLuint, Entry> m_textures;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__GLFence__) */
@@ -0,0 +1,485 @@
+//
+//  GLReductions.cpp
+//  gatherer
+//
+
+#include "graphics/GLReductions.h"
+#include "graphics/GLSLShaderProgram.h"
+#include "graphics/GLStateCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+#if GATHERER_HAS_COMPUTE_SHADER
+
+enum { kGroupSize = 16, kScanBlock = 512 };
+
+// Grid stride loops: at most 8x8 groups for statistics, 16x16 for histograms
+enum { kStatisticsGroups = 8, kHistogramGroups = 16 };
+
+static const char *kStatisticsShader = R"(
+precision highp float;
+precision highp int;
+layout(local_size_x = 16, local_size_y = 16) in;
+uniform highp sampler2D uInput;
+uniform ivec2 uSize;
+layout(std430, binding = 0) writeonly buffer Partials { uvec4 partials[]; };
+shared uvec4 sSum[256];
+shared uvec4 sMin[256];
+shared uvec4 sMax[256];
+void main()
+{
+    uint i = gl_LocalInvocationIndex;
+    uvec4 sum = uvec4(0u), lo = uvec4(255u), hi = uvec4(0u);
+    ivec2 stride = ivec2(gl_NumWorkGroups.xy * gl_WorkGroupSize.xy);
+    for(int y = int(gl_GlobalInvocationID.y); y < uSize.y; y += stride.y)
+    {
+        for(int x = int(gl_GlobalInvocationID.x); x < uSize.x; x += stride.x)
+        {
+            uvec4 v = uvec4(texelFetch(uInput, ivec2(x, y), 0) * 255.0 + 0.5);
+            sum += v;
+            lo = min(lo, v);
+            hi = max(hi, v);
+        }
+    }
+    sSum[i] = sum;
+    sMin[i] = lo;
+    sMax[i] = hi;
+    barrier();
+    for(uint k = 128u; k > 0u; k >>= 1)
+    {
+        if(i < k)
+        {
+            sSum[i] += sSum[i + k];
+            sMin[i] = min(sMin[i], sMin[i + k]);
+            sMax[i] = max(sMax[i], sMax[i + k]);
+        }
+        barrier();
+    }
+    if(i == 0u)
+    {
+        uint group = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+        partials[3u * group + 0u] = sSum[0];
+        partials[3u * group + 1u] = sMin[0];
+        partials[3u * group + 2u] = sMax[0];
+    }
+})";
+
+static const char *kHistogramShader = R"(
+precision highp float;
+precision highp int;
+layout(local_size_x = 16, local_size_y = 16) in;
+uniform highp sampler2D uInput;
+uniform ivec2 uSize;
+uniform int uChannel;
+layout(std430, binding = 0) buffer Histogram { uint bins[256]; };
+shared uint sBins[256];
+void main()
+{
+    uint i = gl_LocalInvocationIndex;
+    sBins[i] = 0u;
+    barrier();
+    ivec2 stride = ivec2(gl_NumWorkGroups.xy * gl_WorkGroupSize.xy);
+    for(int y = int(gl_GlobalInvocationID.y); y < uSize.y; y += stride.y)
+    {
+        for(int x = int(gl_GlobalInvocationID.x); x < uSize.x; x += stride.x)
+        {
+            uint v = uint(texelFetch(uInput, ivec2(x, y), 0)[uChannel] * 255.0 + 0.5);
+            atomicAdd(sBins[v], 1u);
+        }
+    }
+    barrier();
+    if(sBins[i] != 0u)
+    {
+        atomicAdd(bins[i], sBins[i]);
+    }
+})";
+
+// Exclusive scan of each 512 element block in place, block totals to sums[]
+static const char *kScanBlocksShader = R"(
+precision highp int;
+layout(local_size_x = 256) in;
+uniform uint uCount;
+layout(std430, binding = 0) buffer Data { uint data[]; };
+layout(std430, binding = 1) writeonly buffer Sums { uint sums[]; };
+shared uint s[512];
+void main()
+{
+    uint i = gl_LocalInvocationID.x;
+    uint base = gl_WorkGroupID.x * 512u;
+    s[2u * i] = (base + 2u * i < uCount) ? data[base + 2u * i] : 0u;
+    s[2u * i + 1u] = (base + 2u * i + 1u < uCount) ? data[base + 2u * i + 1u] : 0u;
+
+    uint offset = 1u;
+    for(uint d = 256u; d > 0u; d >>= 1)
+    {
+        barrier();
+        if(i < d)
+        {
+            s[offset * (2u * i + 2u) - 1u] += s[offset * (2u * i + 1u) - 1u];
+        }
+        offset <<= 1;
+    }
+    barrier();
+    if(i == 0u)
+    {
+        sums[gl_WorkGroupID.x] = s[511];
+        s[511] = 0u;
+    }
+    for(uint d = 1u; d < 512u; d <<= 1)
+    {
+        offset >>= 1;
+        barrier();
+        if(i < d)
+        {
+            uint a = offset * (2u * i + 1u) - 1u;
+            uint b = offset * (2u * i + 2u) - 1u;
+            uint t = s[a];
+            s[a] = s[b];
+            s[b] += t;
+        }
+    }
+    barrier();
+    if(base + 2u * i < uCount)
+    {
+        data[base + 2u * i] = s[2u * i];
+    }
+    if(base + 2u * i + 1u < uCount)
+    {
+        data[base + 2u * i + 1u] = s[2u * i + 1u];
+    }
+})";
+
+// Add the scanned block sums to each block
+static const char *kScanAddShader = R"(
+precision highp int;
+layout(local_size_x = 256) in;
+uniform uint uCount;
+layout(std430, binding = 0) buffer Data { uint data[]; };
+layout(std430, binding = 1) readonly buffer Sums { uint sums[]; };
+void main()
+{
+    uint offset = sums[gl_WorkGroupID.x];
+    uint base = gl_WorkGroupID.x * 512u + gl_LocalInvocationID.x;
+    if(base < uCount)
+    {
+        data[base] += offset;
+    }
+    if(base + 256u < uCount)
+    {
+        data[base + 256u] += offset;
+    }
+})";
+
+#endif
+
+GLReductions::Backend GLReductions::getDefaultBackend()
+{
+    return GLCapabilities::get().computeShaders ? kCompute : kReadback;
+}
+
+GLReductions::GLReductions(Backend backend)
+: m_backend(backend)
+{
+    if(m_backend == kCompute)
+    {
+#if GATHERER_HAS_COMPUTE_SHADER
+        if(!GLCapabilities::get().computeShaders)
+        {
+            throw std::runtime_error("GLReductions: compute shaders are not supported by this context");
+        }
+        compileShaders();
+#else
+        throw std::runtime_error("GLReductions: built without compute shader support");
+#endif
+    }
+}
+
+GLReductions::~GLReductions()
+{
+    // The program names may be reused by the next ones, don't let the cache skip their glUseProgram()
+    GLStateCache::get().invalidate();
+    if(m_fbo)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+    }
+#if GATHERER_HAS_COMPUTE_SHADER
+    if(!m_buffers.empty())
+    {
+        glDeleteBuffers(GLsizei(m_buffers.size()), m_buffers.data());
+    }
+#endif
+}
+
+const cv::Mat & GLReductions::readPixels(GLuint texture, const cv::Size &size)
+{
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    if(!m_fbo)
+    {
+        glGenFramebuffers(1, &m_fbo);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        throw std::runtime_error("GLReductions: texture is not renderable");
+    }
+
+    m_pixels.create(size, CV_8UC4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, size.width, size.height, GL_RGBA, GL_UNSIGNED_BYTE, m_pixels.ptr());
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    return m_pixels;
+}
+
+GLReductions::Statistics GLReductions::statistics(GLuint texture, const cv::Size &size)
+{
+    Statistics result;
+    result.count = size_t(size.area());
+    result.min = cv::Scalar::all(255.0);
+
+#if GATHERER_HAS_COMPUTE_SHADER
+    if(m_backend == kCompute)
+    {
+        const int groupsX = std::min((size.width + kGroupSize - 1) / kGroupSize, int(kStatisticsGroups));
+        const int groupsY = std::min((size.height + kGroupSize - 1) / kGroupSize, int(kStatisticsGroups));
+        const int groups = groupsX * groupsY;
+
+        bindInput(texture, size, *m_statistics);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, getBuffer(0, groups * 3 * 4 * sizeof(GLuint)));
+        glDispatchCompute(groupsX, groupsY, 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        const GLuint *partials = (const GLuint *)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, groups * 3 * 4 * sizeof(GLuint), GL_MAP_READ_BIT);
+        if(!partials)
+        {
+            throw std::runtime_error("GLReductions: can't map the result buffer");
+        }
+        for(int group = 0; group < groups; group++, partials += 12)
+        {
+            for(int c = 0; c < 4; c++)
+            {
+                result.sum[c] += double(partials[c]);
+                result.min[c] = std::min(result.min[c], double(partials[4 + c]));
+                result.max[c] = std::max(result.max[c], double(partials[8 + c]));
+            }
+        }
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return result;
+    }
+#endif
+
+    const cv::Mat &pixels = readPixels(texture, size);
+    for(int y = 0; y < pixels.rows; y++)
+    {
+        const uint8_t *row = pixels.ptr<uint8_t>(y);
+        for(int c = 0; c < 4; c++)
+        {
+            uint64_t sum = 0;
+            uint8_t lo = 255, hi = 0;
+            for(int x = 0; x < pixels.cols; x++)
+            {
+                const uint8_t v = row[x * 4 + c];
+                sum += v;
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            }
+            result.sum[c] += double(sum);
+            result.min[c] = std::min(result.min[c], double(lo));
+            result.max[c] = std::max(result.max[c], double(hi));
+        }
+    }
+    return result;
+}
+
+void GLReductions::histogram(GLuint texture, const cv::Size &size, int channel, std::vector<int> &hist)
+{
+    if(channel < 0 || channel > 3)
+    {
+        throw std::invalid_argument("GLReductions: channel must be in [0,3]");
+    }
+    hist.assign(256, 0);
+
+#if GATHERER_HAS_COMPUTE_SHADER
+    if(m_backend == kCompute)
+    {
+        const int groupsX = std::min((size.width + kGroupSize - 1) / kGroupSize, int(kHistogramGroups));
+        const int groupsY = std::min((size.height + kGroupSize - 1) / kGroupSize, int(kHistogramGroups));
+
+        const GLuint buffer = getBuffer(0, 256 * sizeof(GLuint));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, 256 * sizeof(GLuint), hist.data());
+
+        bindInput(texture, size, *m_histogram);
+        glUniform1i(m_histogram->GetUniformLocation("uChannel"), channel);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+        glDispatchCompute(groupsX, groupsY, 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        const GLuint *bins = (const GLuint *)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, 256 * sizeof(GLuint), GL_MAP_READ_BIT);
+        if(!bins)
+        {
+            throw std::runtime_error("GLReductions: can't map the result buffer");
+        }
+        std::copy(bins, bins + 256, hist.begin());
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return;
+    }
+#endif
+
+    const cv::Mat &pixels = readPixels(texture, size);
+    for(int y = 0; y < pixels.rows; y++)
+    {
+        const uint8_t *row = pixels.ptr<uint8_t>(y) + channel;
+        for(int x = 0; x < pixels.cols; x++)
+        {
+            hist[row[x * 4]]++;
+        }
+    }
+}
+
+uint32_t GLReductions::exclusiveScan(std::vector<uint32_t> &values)
+{
+#if GATHERER_HAS_COMPUTE_SHADER
+    if(m_backend == kCompute && !values.empty())
+    {
+        const size_t bytes = values.size() * sizeof(uint32_t);
+        const GLuint buffer = getBuffer(1, bytes);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, values.data());
+
+        const uint32_t total = exclusiveScan(buffer, int(values.size()));
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        const uint32_t *result = (const uint32_t *)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+        if(!result)
+        {
+            throw std::runtime_error("GLReductions: can't map the scan buffer");
+        }
+        std::copy(result, result + values.size(), values.begin());
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return total;
+    }
+#endif
+
+    uint32_t total = 0;
+    for(auto &value : values)
+    {
+        const uint32_t v = value;
+        value = total;
+        total += v;
+    }
+    return total;
+}
+
+#if GATHERER_HAS_COMPUTE_SHADER
+
+void GLReductions::compileShaders()
+{
+    const char *version = GLCapabilities::get().getComputeVersion();
+    const GLchar *statistics[] = { version, kStatisticsShader };
+    const GLchar *histogram[] = { version, kHistogramShader };
+    const GLchar *scanBlocks[] = { version, kScanBlocksShader };
+    const GLchar *scanAdd[] = { version, kScanAddShader };
+    m_statistics = make_unique<compute_prog>(statistics);
+    m_histogram = make_unique<compute_prog>(histogram);
+    m_scanBlocks = make_unique<compute_prog>(scanBlocks);
+    m_scanAdd = make_unique<compute_prog>(scanAdd);
+}
+
+void GLReductions::bindInput(GLuint texture, const cv::Size &size, compute_prog &program)
+{
+    GLStateCache &gl = GLStateCache::get();
+    gl.useProgram(program);
+    gl.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+    glUniform1i(program.GetUniformLocation("uInput"), 0);
+    glUniform2i(program.GetUniformLocation("uSize"), size.width, size.height);
+}
+
+GLuint GLReductions::getBuffer(size_t index, size_t bytes)
+{
+    if(m_buffers.size() <= index)
+    {
+        m_buffers.resize(index + 1, 0);
+        m_bufferSizes.resize(index + 1, 0);
+    }
+    if(!m_buffers[index])
+    {
+        glGenBuffers(1, &m_buffers[index]);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[index]);
+    if(m_bufferSizes[index] < bytes)
+    {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_DYNAMIC_COPY);
+        m_bufferSizes[index] = bytes;
+    }
+    return m_buffers[index];
+}
+
+uint32_t GLReductions::exclusiveScan(GLuint buffer, int count)
+{
+    if(m_backend != kCompute)
+    {
+        throw std::logic_error("GLReductions: buffer scans need the compute backend");
+    }
+    if(count <= 0)
+    {
+        return 0;
+    }
+    return scanLevel(buffer, count, 0);
+}
+
+uint32_t GLReductions::scanLevel(GLuint buffer, int count, size_t level)
+{
+    const int blocks = (count + kScanBlock - 1) / kScanBlock;
+    const GLuint sums = getBuffer(2 + level, blocks * sizeof(GLuint));
+
+    GLStateCache &gl = GLStateCache::get();
+    gl.useProgram(*m_scanBlocks);
+    glUniform1ui(m_scanBlocks->GetUniformLocation("uCount"), GLuint(count));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sums);
+    glDispatchCompute(blocks, 1, 1);
+
+    uint32_t total = 0;
+    if(blocks == 1)
+    {
+        // The only block sum is the total
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sums);
+        const uint32_t *result = (const uint32_t *)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT);
+        if(!result)
+        {
+            throw std::runtime_error("GLReductions: can't map the scan buffer");
+        }
+        total = *result;
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    }
+    else
+    {
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        total = scanLevel(sums, blocks, level + 1);
+
+        gl.useProgram(*m_scanAdd);
+        glUniform1ui(m_scanAdd->GetUniformLocation("uCount"), GLuint(count));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, sums);
+        glDispatchCompute(blocks, 1, 1);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return total;
+}
+
+#endif
+
+_GATHERER_GRAPHICS_END
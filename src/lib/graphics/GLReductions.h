@@ -0,0 +1,122 @@
+//
+//  GLReductions.h
+//  gatherer
+//
+
+#ifndef __gatherer__GLReductions__
+#define __gatherer__GLReductions__
+
+#include "graphics/gatherer_graphics.h"
+#include "graphics/GLCapabilities.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+_GATHERER_GRAPHICS_BEGIN
+
+class compute_prog;
+
+/**
+ * \class GLReductions
+ *
+ * \brief Sum, min/max, histogram and prefix scan on the GPU
+ *
+ * With compute shaders (GL 4.3 / GLES 3.1, see GLCapabilities) each
+ * reduction is one dispatch and only the result is read back:
+ *
+ * @code
+ *
+ * gatherer::graphics::GLReductions reductions; // backend chosen from the context
+ * auto stats = reductions.statistics(proc.getOutputTexId(), size);
+ * std::vector<int> hist;
+ * reductions.histogram(proc.getOutputTexId(), size, 0, hist);
+ *
+ * @endcode
+ *
+ * - statistics: per group partials in shared memory, finished on the CPU
+ *   over at most 64 partials.
+ * - histogram: privatized 256 bin histogram in shared memory per group,
+ *   merged with one global atomic per non-empty bin.
+ * - exclusiveScan: work efficient (Blelloch) scan of 512 element blocks,
+ *   block sums scanned recursively.
+ *
+ * Without compute shaders (GLES 2.0, macOS) the textures are read back
+ * with glReadPixels and reduced on the CPU.  Texture inputs are RGBA8
+ * and the results are in [0,255] units.
+ */
+
+class GLReductions
+{
+public:
+
+    enum Backend
+    {
+        kCompute,
+        kReadback
+    };
+
+    /// Per channel results over all texels
+    struct Statistics
+    {
+        cv::Scalar sum;
+        cv::Scalar min;
+        cv::Scalar max;
+        size_t count = 0;
+
+        cv::Scalar mean() const { return count ? sum * (1.0 / double(count)) : cv::Scalar(); }
+    };
+
+    /// kCompute if the current context supports it
+    static Backend getDefaultBackend();
+
+    explicit GLReductions(Backend backend = getDefaultBackend());
+    ~GLReductions();
+
+    Backend getBackend() const { return m_backend; }
+
+    Statistics statistics(GLuint texture, const cv::Size &size);
+
+    /// 256 bin histogram of one channel of a texture
+    void histogram(GLuint texture, const cv::Size &size, int channel, std::vector<int> &hist);
+
+    /// In place exclusive prefix sum, returns the total
+    uint32_t exclusiveScan(std::vector<uint32_t> &values);
+
+#if GATHERER_HAS_COMPUTE_SHADER
+    /// In place exclusive prefix sum of count uints of a GL_SHADER_STORAGE_BUFFER (compute backend only)
+    uint32_t exclusiveScan(GLuint buffer, int count);
+#endif
+
+protected:
+
+    const cv::Mat & readPixels(GLuint texture, const cv::Size &size);
+
+    Backend m_backend;
+
+    // Readback backend
+    GLuint m_fbo = 0;
+    cv::Mat m_pixels;
+
+#if GATHERER_HAS_COMPUTE_SHADER
+    void compileShaders();
+    void bindInput(GLuint texture, const cv::Size &size, compute_prog &program);
+    GLuint getBuffer(size_t index, size_t bytes);
+    uint32_t scanLevel(GLuint buffer, int count, size_t level);
+
+    std::unique_ptr<compute_prog> m_statistics;
+    std::unique_ptr<compute_prog> m_histogram;
+    std::unique_ptr<compute_prog> m_scanBlocks;
+    std::unique_ptr<compute_prog> m_scanAdd;
+
+    // Storage buffers, reused between calls: 0: results, 1: scan input, 2...: scan block sums by level
+    std::vector<GLuint> m_buffers;
+    std::vector<size_t> m_bufferSizes;
+#endif
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__GLReductions__) */
@@ -10,6 +10,7 @@
 #define __gatherer__GLSLShaderProgram__
 
 #include "graphics/gatherer_graphics.h"
+#include "graphics/GLCapabilities.h"
 #include <iostream>
 #include <vector>
 #include <exception>
@@ -101,6 +102,71 @@ public:
     }
 };
 
+#if GATHERER_HAS_COMPUTE_SHADER
+
+// Compute shader counterpart of shader_prog (GL 4.3 / GLES 3.1), see GLCapabilities
+class compute_prog
+{
+    GLuint compute_shader, prog;
+
+public:
+
+    template <int N>
+    compute_prog(GLchar const *(&source)[N])
+    {
+        compute_shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute_shader, N, source, NULL);
+        glCompileShader(compute_shader);
+        GLint status = 0;
+        glGetShaderiv(compute_shader, GL_COMPILE_STATUS, &status);
+        if (!status)
+        {
+            GLint length;
+            glGetShaderiv(compute_shader, GL_INFO_LOG_LENGTH, &length);
+            std::string log(length, ' ');
+            glGetShaderInfoLog(compute_shader, length, &length, &log[0]);
+            glDeleteShader(compute_shader);
+            throw std::logic_error(log);
+        }
+
+        prog = glCreateProgram();
+        glAttachShader(prog, compute_shader);
+        glLinkProgram(prog);
+        glGetProgramiv(prog, GL_LINK_STATUS, &status);
+        if (status == 0)
+        {
+            GLint length;
+            glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &length);
+            std::string log(length, ' ');
+            if(length > 0)
+            {
+                glGetProgramInfoLog(prog, length, &length, &log[0]);
+            }
+            glDeleteProgram(prog);
+            glDeleteShader(compute_shader);
+            throw std::logic_error(log);
+        }
+    }
+
+    int GetUniformLocation(const char *name)
+    {
+        return glGetUniformLocation(prog, name);
+    }
+
+    operator GLuint()
+    {
+        return prog;
+    }
+
+    ~compute_prog()
+    {
+        glDeleteProgram(prog);
+        glDeleteShader(compute_shader);
+    }
+};
+
+#endif
+
 _GATHERER_GRAPHICS_END
 
 #endif /* defined(__gatherer__GLSLShaderProgram__) */
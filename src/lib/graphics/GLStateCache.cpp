@@ -0,0 +1,175 @@
+//
+//  GLStateCache.cpp
+//  gatherer
+//
+
+#include "graphics/GLStateCache.h"
+
+#include <algorithm>
+
+_GATHERER_GRAPHICS_BEGIN
+
+GLStateCache & GLStateCache::get()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+void GLStateCache::beginFrame()
+{
+    invalidate();
+    m_lastFrame = m_frame;
+    m_frame = Stats();
+}
+
+void GLStateCache::invalidate()
+{
+    m_hasProgram = m_hasActiveUnit = m_hasFramebuffer = m_hasArrayBuffer = m_hasViewport = m_hasClearColor = false;
+    for(auto &binding : m_textures)
+    {
+        binding = Binding();
+    }
+    std::fill(m_attributes, m_attributes + kMaxAttributes, -1);
+}
+
+void GLStateCache::release()
+{
+    if(m_quadBuffer)
+    {
+        glDeleteBuffers(1, &m_quadBuffer);
+        m_quadBuffer = 0;
+    }
+    invalidate();
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if(changed(m_hasProgram && m_program == program))
+    {
+        glUseProgram(program);
+        m_program = program;
+        m_hasProgram = true;
+    }
+}
+
+void GLStateCache::bindTexture(GLenum unit, GLenum target, GLuint texture)
+{
+    const int index = int(unit - GL_TEXTURE0);
+    if(index < 0 || index >= kMaxTextureUnits)
+    {
+        glActiveTexture(unit);
+        glBindTexture(target, texture);
+        m_hasActiveUnit = false;
+        m_frame.stateChanges += 2;
+        return;
+    }
+
+    Binding &binding = m_textures[index];
+    if(changed(binding.known && binding.target == target && binding.texture == texture))
+    {
+        if(changed(m_hasActiveUnit && m_activeUnit == unit))
+        {
+            glActiveTexture(unit);
+            m_activeUnit = unit;
+            m_hasActiveUnit = true;
+        }
+        glBindTexture(target, texture);
+        binding.known = true;
+        binding.target = target;
+        binding.texture = texture;
+    }
+}
+
+void GLStateCache::bindFramebuffer(GLuint framebuffer)
+{
+    if(changed(m_hasFramebuffer && m_framebuffer == framebuffer))
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        m_framebuffer = framebuffer;
+        m_hasFramebuffer = true;
+    }
+}
+
+void GLStateCache::bindArrayBuffer(GLuint buffer)
+{
+    if(changed(m_hasArrayBuffer && m_arrayBuffer == buffer))
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        m_arrayBuffer = buffer;
+        m_hasArrayBuffer = true;
+    }
+}
+
+void GLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    const GLint value[4] = { x, y, width, height };
+    if(changed(m_hasViewport && std::equal(value, value + 4, m_viewport)))
+    {
+        glViewport(x, y, width, height);
+        std::copy(value, value + 4, m_viewport);
+        m_hasViewport = true;
+    }
+}
+
+void GLStateCache::clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    const GLfloat value[4] = { r, g, b, a };
+    if(changed(m_hasClearColor && std::equal(value, value + 4, m_clearColor)))
+    {
+        glClearColor(r, g, b, a);
+        std::copy(value, value + 4, m_clearColor);
+        m_hasClearColor = true;
+    }
+}
+
+void GLStateCache::enableVertexAttribArray(GLuint index)
+{
+    if(index >= GLuint(kMaxAttributes))
+    {
+        glEnableVertexAttribArray(index);
+        m_frame.stateChanges++;
+    }
+    else if(changed(m_attributes[index] == 1))
+    {
+        glEnableVertexAttribArray(index);
+        m_attributes[index] = 1;
+    }
+}
+
+void GLStateCache::disableVertexAttribArray(GLuint index)
+{
+    if(index >= GLuint(kMaxAttributes))
+    {
+        glDisableVertexAttribArray(index);
+        m_frame.stateChanges++;
+    }
+    else if(changed(m_attributes[index] == 0))
+    {
+        glDisableVertexAttribArray(index);
+        m_attributes[index] = 0;
+    }
+}
+
+void GLStateCache::drawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    glDrawArrays(mode, first, count);
+    m_frame.draws++;
+}
+
+GLuint GLStateCache::getQuadBuffer()
+{
+    if(!m_quadBuffer)
+    {
+        static const GLfloat quads[] =
+        {
+            0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f,
+            -1.f, -1.f, 1.f, -1.f, -1.f, 1.f, 1.f, 1.f
+        };
+        glGenBuffers(1, &m_quadBuffer);
+        bindArrayBuffer(m_quadBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quads), quads, GL_STATIC_DRAW);
+    }
+    return m_quadBuffer;
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,135 @@
+//
+//  GLStateCache.h
+//  gatherer
+//
+
+#ifndef __gatherer__GLStateCache__
+#define __gatherer__GLStateCache__
+
+#include "graphics/gatherer_graphics.h"
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \class GLStateCache
+ *
+ * \brief Filter for redundant GL state changes on the gatherer draw paths
+ *
+ * Remembers the last program, texture bindings, framebuffer, array buffer,
+ * viewport, clear color and enabled vertex attributes set through it and
+ * drops calls that would not change anything.  It also owns the shared quad
+ * vertex buffer, so the draw paths never stream vertices from client memory:
+ *
+ * @code
+ *
+ * auto &gl = gatherer::graphics::GLStateCache::get();
+ * gl.beginFrame();                     // once per frame, after foreign GL code
+ * gl.useProgram(program);
+ * gl.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+ * gl.bindArrayBuffer(gl.getQuadBuffer());
+ * glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (const GLvoid *)gl.getQuadOffset(GLStateCache::kUnitQuad));
+ * gl.enableVertexAttribArray(0);
+ * gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+ *
+ * @endcode
+ *
+ * The cache only sees calls made through it, and keeps its state across
+ * consecutive cached stages (RenderTexture, PackedReader, PackedLuma,
+ * GradientPlanes, GLReductions, GLTexture uploads), which is where the
+ * redundant calls are dropped.  Code binding outside it invalidates at its
+ * boundary instead: the gatherer stages that still bind raw (FrameHistory,
+ * TemporalFilter, KeypointCompactor, ...) on return and all of them when
+ * they delete GL names, and the caller after Qt or ogles_gpgpu (VideoSource,
+ * process(), getResultData()) ran, with invalidate() or, once per frame,
+ * beginFrame().  One instance serves the GL context of the processing thread:
+ * call release() while that context is still current, before it is
+ * destroyed, so the next context doesn't bind a stale quad buffer name.
+ */
+
+class GLStateCache
+{
+public:
+
+    /// Per frame counters
+    struct Stats
+    {
+        int stateChanges = 0;   // calls forwarded to GL
+        int redundant = 0;      // calls dropped
+        int draws = 0;
+    };
+
+    /// GL_TRIANGLE_STRIP quads of the shared buffer, two floats per vertex
+    enum Quad
+    {
+        kUnitQuad,  // (0,0) (1,0) (0,1) (1,1): texture coordinates
+        kClipQuad   // (-1,-1) (1,-1) (-1,1) (1,1): full viewport
+    };
+
+    enum { kMaxTextureUnits = 8, kMaxAttributes = 16 };
+
+    static GLStateCache & get();
+
+    /// Forget the cached state and start counting a new frame
+    void beginFrame();
+
+    /// Forget the cached state (e.g. after code outside the cache changed it)
+    void invalidate();
+
+    /// Delete the shared buffers and forget their names (before the context goes away)
+    void release();
+
+    const Stats & getFrameStats() const { return m_frame; }
+    const Stats & getLastFrameStats() const { return m_lastFrame; }
+
+    void useProgram(GLuint program);
+    void bindTexture(GLenum unit, GLenum target, GLuint texture);
+    void bindFramebuffer(GLuint framebuffer);
+    void bindArrayBuffer(GLuint buffer);
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+    void enableVertexAttribArray(GLuint index);
+    void disableVertexAttribArray(GLuint index);
+    void drawArrays(GLenum mode, GLint first, GLsizei count);
+
+    /// Static buffer holding the quads above
+    GLuint getQuadBuffer();
+    static size_t getQuadOffset(Quad quad) { return size_t(quad) * 8 * sizeof(GLfloat); }
+
+protected:
+
+    GLStateCache() { invalidate(); }
+
+    bool changed(bool same)
+    {
+        same ? m_frame.redundant++ : m_frame.stateChanges++;
+        return !same;
+    }
+
+    // Each field is valid only when its flag is set
+    bool m_hasProgram, m_hasActiveUnit, m_hasFramebuffer, m_hasArrayBuffer, m_hasViewport, m_hasClearColor;
+    GLuint m_program = 0;
+    GLenum m_activeUnit = GL_TEXTURE0;
+    GLuint m_framebuffer = 0;
+    GLuint m_arrayBuffer = 0;
+    GLint m_viewport[4] = { 0, 0, 0, 0 };
+    GLfloat m_clearColor[4] = { 0.f, 0.f, 0.f, 0.f };
+
+    struct Binding
+    {
+        bool known = false;
+        GLenum target = 0;
+        GLuint texture = 0;
+    };
+    Binding m_textures[kMaxTextureUnits];
+
+    // 0: disabled, 1: enabled, -1: unknown
+    int m_attributes[kMaxAttributes];
+
+    GLuint m_quadBuffer = 0;
+
+    Stats m_frame, m_lastFrame;
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__GLStateCache__) */
@@ -0,0 +1,208 @@
+//
+//  GLTexture.cpp
+//  gatherer
+//
+
+#include "graphics/GLTexture.h"
+#include "graphics/GLCapabilities.h"
+#include "graphics/GLStateCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(GL_UNPACK_ROW_LENGTH)
+#  define GATHERER_UNPACK_ROW_LENGTH GL_UNPACK_ROW_LENGTH
+#elif defined(GL_UNPACK_ROW_LENGTH_EXT)
+#  define GATHERER_UNPACK_ROW_LENGTH GL_UNPACK_ROW_LENGTH_EXT
+#endif
+
+_GATHERER_GRAPHICS_BEGIN
+
+struct TextureFormat
+{
+    GLenum internalFormat;
+    GLenum format;
+    bool swapRedBlue;       // stored as RGB(A) from BGR(A) input
+};
+
+// Upload BGR(A) as is where GL accepts it, otherwise as RGB(A) with red and blue swapped
+static TextureFormat getFormat(int type, const GLCapabilities &caps)
+{
+    switch(type)
+    {
+        case CV_8UC1:
+#if defined(GL_R8)
+            if(caps.textureSwizzle)
+            {
+                return { GL_R8, GL_RED, false };
+            }
+#endif
+            return { GL_LUMINANCE, GL_LUMINANCE, false };
+
+#if defined(GATHERER_OPENGL_ES)
+        // GLES 2.0 only has unsized formats, glTexStorage2D only sized ones
+        case CV_8UC3: return { GLenum(caps.major >= 3 ? GL_RGB8 : GL_RGB), GL_RGB, true };
+        case CV_8UC4: return { GLenum(caps.major >= 3 ? GL_RGBA8 : GL_RGBA), GL_RGBA, true };
+#else
+        case CV_8UC3: return { GL_RGB8, GL_BGR, false };
+        case CV_8UC4: return { GL_RGBA8, GL_BGRA, false };
+#endif
+
+        default: throw std::invalid_argument("GLTexture: streaming supports CV_8UC1, CV_8UC3 and CV_8UC4");
+    }
+}
+
+GLTexture::GLTexture(const cv::Size &size, int type, int buffers)
+    : m_streaming(true)
+    , m_size(size)
+    , m_type(type)
+{
+    init(); // bound to unit 0
+
+    const auto &caps = GLCapabilities::get();
+    const TextureFormat format = getFormat(type, caps);
+    m_format = format.format;
+
+#if defined(GL_TEXTURE_IMMUTABLE_FORMAT)
+    if(caps.textureStorage)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, 1, format.internalFormat, size.width, size.height);
+    }
+    else
+#endif
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, format.internalFormat, size.width, size.height, 0, m_format, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+#if defined(GL_TEXTURE_SWIZZLE_R)
+    if(caps.textureSwizzle)
+    {
+        if(type == CV_8UC1)
+        {
+            // Sample GL_R8 like GL_LUMINANCE
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+        }
+        else if(format.swapRedBlue)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+        }
+    }
+    else
+#endif
+    {
+        m_swapRedBlue = format.swapRedBlue;
+    }
+
+#if defined(GL_PIXEL_UNPACK_BUFFER)
+    if(caps.pixelBuffers)
+    {
+        m_buffers.resize(std::max(buffers, 1));
+        glGenBuffers(GLsizei(m_buffers.size()), m_buffers.data());
+    }
+#endif
+}
+
+GLTexture::~GLTexture()
+{
+    if(m_buffers.size())
+    {
+        glDeleteBuffers(GLsizei(m_buffers.size()), m_buffers.data());
+    }
+    glDeleteTextures((GLsizei)1, (GLuint *)&m_texture);
+    GLStateCache::get().invalidate(); // the names can be reused
+}
+
+void GLTexture::update(const cv::Mat &image)
+{
+    CV_Assert(image.size() == m_size && image.type() == m_type);
+
+    const auto &caps = GLCapabilities::get();
+    const size_t elemSize = image.elemSize();
+    const size_t rowBytes = image.cols * elemSize;
+
+    // Strided rows are passed as they are, unless GL can't skip the padding
+    bool strided = !image.isContinuous() && (image.rows > 1);
+#if defined(GATHERER_UNPACK_ROW_LENGTH)
+    const bool rowLength = strided && caps.unpackRowLength && (image.step % elemSize) == 0;
+#else
+    const bool rowLength = false;
+#endif
+
+    GLStateCache::get().bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, m_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+#if defined(GATHERER_UNPACK_ROW_LENGTH)
+    if(rowLength)
+    {
+        glPixelStorei(GATHERER_UNPACK_ROW_LENGTH, GLint(image.step / elemSize));
+    }
+#endif
+
+    const GLvoid *pixels = image.ptr();
+#if defined(GL_PIXEL_UNPACK_BUFFER)
+    if(m_buffers.size())
+    {
+        // The previous upload from this buffer may still be in flight: orphan it instead of waiting
+        const size_t bytes = (strided && rowLength) ? (image.rows - 1) * image.step + rowBytes : image.rows * rowBytes;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[m_index]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(bytes), nullptr, GL_STREAM_DRAW);
+        uint8_t *dst = (uint8_t *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if(!dst)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            throw std::runtime_error("GLTexture: glMapBufferRange() failed");
+        }
+        if(!strided || rowLength)
+        {
+            std::memcpy(dst, image.ptr(), bytes);
+        }
+        else
+        {
+            for(int y = 0; y < image.rows; y++)
+            {
+                std::memcpy(dst + y * rowBytes, image.ptr(y), rowBytes);
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        pixels = nullptr; // offset into the bound buffer
+        strided = false;
+        m_index = (m_index + 1) % m_buffers.size();
+    }
+#endif
+
+    if(strided && !rowLength)
+    {
+        // GLES 2.0 without GL_EXT_unpack_subimage
+        for(int y = 0; y < image.rows; y++)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, image.cols, 1, m_format, GL_UNSIGNED_BYTE, image.ptr(y));
+        }
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.cols, image.rows, m_format, GL_UNSIGNED_BYTE, pixels);
+    }
+
+    // Leave the default unpack state for code that uploads from client memory (ogles_gpgpu)
+#if defined(GL_PIXEL_UNPACK_BUFFER)
+    if(m_buffers.size())
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+#endif
+#if defined(GATHERER_UNPACK_ROW_LENGTH)
+    if(rowLength)
+    {
+        glPixelStorei(GATHERER_UNPACK_ROW_LENGTH, 0);
+    }
+#endif
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glFlush();
+    GATHERER_GL_WRITTEN(m_texture);
+}
+
+_GATHERER_GRAPHICS_END
@@ -10,9 +10,13 @@
 #define gatherer_GLTexture_h
 
 #include "graphics/gatherer_graphics.h"
+#include "graphics/GLFence.h"
+#include "graphics/GLStateCache.h"
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include <vector>
+
 _GATHERER_GRAPHICS_BEGIN
 
 
@@ -29,6 +33,24 @@ _GATHERER_GRAPHICS_BEGIN
  * GLTexture texture(image);
  *
  * @endcode
+ *
+ * For per frame uploads use the streaming mode: storage is allocated once
+ * and frames are copied into a ring of mapped pixel buffers (GL 3.0 /
+ * GLES 3.0 or GL_ARB_map_buffer_range for glMapBufferRange) and
+ * transferred with glTexSubImage2D without waiting for the GPU.  Rows
+ * are passed with GL_UNPACK_ROW_LENGTH, so ROIs and padded buffers need no
+ * repacking, and 3 channel BGR is stored as RGB and swizzled on sampling
+ * instead of converted on the CPU:
+ *
+ * @code
+ *
+ * GLTexture texture(roi.size(), CV_8UC3, 3); // 3 pixel buffers
+ * texture.load(frame(roi));
+ *
+ * @endcode
+ *
+ * Without texture swizzle (GLES 2.0) hasSwappedRedBlue() is true and
+ * shaders sampling the texture swap red and blue themselves.
  */
 
 // TODO: comments
@@ -43,11 +65,14 @@ public:
     /// Constructor from OpenCV cv::Mat
     GLTexture(const cv::Mat &image) { init(); load(image); }
 
+    /// Streaming texture for images of one size and type (CV_8UC1, CV_8UC3 or CV_8UC4)
+    GLTexture(const cv::Size &size, int type, int buffers = 2);
+
     /// Initialization
     void init()
     {
         glGenTextures(1,&m_texture);
-        glBindTexture(GL_TEXTURE_2D, m_texture);
+        GLStateCache::get().bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, m_texture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -55,13 +80,21 @@ public:
         
         //std::cout << "make texture: " << int(glGetError()) << std::endl;
     }
-    virtual ~GLTexture() { glDeleteTextures((GLsizei)1, (GLuint *)&m_texture); }
+    virtual ~GLTexture();
     virtual operator unsigned int() const { return m_texture; }
     unsigned int & get() { return m_texture; }
+    bool isStreaming() const { return m_streaming; }
+    bool hasSwappedRedBlue() const { return m_swapRedBlue; }
     void load( const cv::Mat &image )
     {
+        if(m_streaming)
+        {
+            update(image);
+            return;
+        }
+        
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glBindTexture(GL_TEXTURE_2D, m_texture);
+        GLStateCache::get().bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, m_texture);
 #if defined(GATHERER_OPENGL_ES)
 #if __ANDROID__
         GLenum format = GL_RGBA;
@@ -82,16 +115,30 @@ public:
         cv::Mat image_ = image;
 #endif
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image_.cols, image_.rows, 0, format, GL_UNSIGNED_BYTE, image_.ptr());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         
         //std::cout << "glTexImage2D: " << int(glGetError()) << std::endl;
         
         glFlush();
+        GATHERER_GL_WRITTEN(m_texture);
     }
 
 protected:
 
+    /// Streaming upload of an image of the size and type given at construction
+    void update(const cv::Mat &image);
+
     /// OpenGL texture ID
     unsigned int m_texture;
+
+    // Streaming mode
+    bool m_streaming = false;
+    bool m_swapRedBlue = false;
+    cv::Size m_size;
+    int m_type = 0;
+    GLenum m_format = 0;
+    std::vector<GLuint> m_buffers;  // pixel buffer ring
+    size_t m_index = 0;
 };
 
 
@@ -0,0 +1,140 @@
+//
+//  GLTextureFormat.cpp
+//  gatherer
+//
+
+#include "graphics/GLTextureFormat.h"
+#include "graphics/GLCapabilities.h"
+
+#include <cstring>
+#include <stdexcept>
+
+_GATHERER_GRAPHICS_BEGIN
+
+static const char * kNames[] = { "rgba8", "r8", "rg8", "rgba16f", "r32f" };
+
+static GLTextureFormat makeFormat(GLint internalFormat, GLenum format, GLenum type, int channels, bool isFloat)
+{
+    GLTextureFormat result;
+    result.internalFormat = internalFormat;
+    result.format = format;
+    result.type = type;
+    result.channels = channels;
+    result.isFloat = isFloat;
+    return result;
+}
+
+GLTextureFormat GLTextureFormat::get(Format format)
+{
+    switch(format)
+    {
+#if defined(GL_R8) && defined(GL_RED)
+        case kR8: return makeFormat(GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1, false);
+#endif
+#if defined(GL_RG8) && defined(GL_RG)
+        case kRG8: return makeFormat(GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 2, false);
+#endif
+#if defined(GL_RGBA16F) && defined(GL_HALF_FLOAT)
+        case kRGBA16F: return makeFormat(GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 4, true);
+#endif
+#if defined(GL_R32F) && defined(GL_RED)
+        case kR32F: return makeFormat(GL_R32F, GL_RED, GL_FLOAT, 1, true);
+#endif
+        default: return GLTextureFormat();
+    }
+}
+
+bool GLTextureFormat::isRenderable(Format format)
+{
+    const GLCapabilities &caps = GLCapabilities::get();
+    switch(format)
+    {
+        case kR8: return caps.renderR8;
+        case kRG8: return caps.renderRG8;
+        case kRGBA16F: return caps.renderRGBA16F;
+        case kR32F: return caps.renderR32F;
+        default: return true;
+    }
+}
+
+GLTextureFormat::Format GLTextureFormat::resolve(Format format)
+{
+    return isRenderable(format) ? format : kRGBA8;
+}
+
+GLTextureFormat::Format GLTextureFormat::parse(const std::string &name)
+{
+    for(int i = 0; i <= int(kR32F); i++)
+    {
+        if(name == kNames[i])
+        {
+            return Format(i);
+        }
+    }
+    throw std::invalid_argument("GLTextureFormat: unknown format " + name);
+}
+
+const char * GLTextureFormat::getName(Format format)
+{
+    return kNames[int(format)];
+}
+
+void GLTextureFormat::allocate(GLuint texture, const cv::Size &size, Format format)
+{
+    const GLTextureFormat desc = get(format);
+    const GLint filter = (format == kR32F) ? GL_NEAREST : GL_LINEAR;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, size.width, size.height, 0, desc.format, desc.type, 0);
+}
+
+int GLTextureFormat::getType(Format format)
+{
+    const GLTextureFormat desc = get(format);
+    return CV_MAKETYPE(desc.isFloat ? CV_32F : CV_8U, desc.channels);
+}
+
+void GLTextureFormat::read(const cv::Size &size, Format format, cv::Mat &image)
+{
+    const GLTextureFormat desc = get(format);
+    const GLenum type = desc.isFloat ? GL_FLOAT : GL_UNSIGNED_BYTE;
+    image.create(size, getType(format));
+    if(!image.isContinuous())
+    {
+        image = cv::Mat(size, getType(format));
+    }
+
+    GLint alignment = 4;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    if(desc.channels == 4 || !GLCapabilities::get().es)
+    {
+        // Desktop GL reads any format directly
+        glReadPixels(0, 0, size.width, size.height, (desc.channels == 4) ? GL_RGBA : desc.format, type, image.ptr());
+    }
+    else
+    {
+        // GLES only guarantees RGBA reads: keep the leading channels of each texel
+        cv::Mat rgba(size, CV_MAKETYPE(image.depth(), 4));
+        glReadPixels(0, 0, size.width, size.height, GL_RGBA, type, rgba.ptr());
+
+        const size_t texel = rgba.elemSize(), pixel = image.elemSize();
+        for(int y = 0; y < size.height; y++)
+        {
+            const uint8_t *src = rgba.ptr<uint8_t>(y);
+            uint8_t *dst = image.ptr<uint8_t>(y);
+            for(int x = 0; x < size.width; x++, src += texel, dst += pixel)
+            {
+                std::memcpy(dst, src, pixel);
+            }
+        }
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+}
+
+_GATHERER_GRAPHICS_END
@@ -0,0 +1,86 @@
+//
+//  GLTextureFormat.h
+//  gatherer
+//
+
+#ifndef __gatherer__GLTextureFormat__
+#define __gatherer__GLTextureFormat__
+
+#include "graphics/gatherer_graphics.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <string>
+
+_GATHERER_GRAPHICS_BEGIN
+
+/**
+ * \struct GLTextureFormat
+ *
+ * \brief Internal format of a render target texture
+ *
+ * Stages that render into their own texture take one of these, so a mask
+ * or gray stage can store one byte per pixel and an accumulating stage can
+ * keep more than 8 bits:
+ *
+ * @code
+ *
+ * using gatherer::graphics::GLTextureFormat;
+ * gatherer::graphics::FrameHistory history(5, GLTextureFormat::kR8); // gray frames, 1/4 of the memory
+ * gatherer::graphics::TemporalFilter mean(gatherer::graphics::TemporalFilter::kMean, 5);
+ * mean.setFormat(GLTextureFormat::kRGBA16F);
+ *
+ * @endcode
+ *
+ * - kR8, kRG8: sampled as (r, 0, 0, 1) and (r, g, 0, 1).
+ * - kRGBA16F: half float, filterable.
+ * - kR32F: single float, GL_NEAREST filtering (linear filtering of float
+ *   textures is an extension on GLES).
+ *
+ * Formats the context can't render to (see GLCapabilities) resolve to
+ * kRGBA8, the only color renderable format of GLES 2.0.
+ */
+
+struct GLTextureFormat
+{
+    enum Format
+    {
+        kRGBA8,
+        kR8,
+        kRG8,
+        kRGBA16F,
+        kR32F
+    };
+
+    GLint internalFormat = GL_RGBA;
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    int channels = 4;
+    bool isFloat = false;
+
+    /// glTexImage2D arguments of a format (kRGBA8 for formats the GL headers don't declare)
+    static GLTextureFormat get(Format format);
+
+    /// True if the current context can render to the format
+    static bool isRenderable(Format format);
+
+    /// The format, or kRGBA8 if it isn't renderable
+    static Format resolve(Format format);
+
+    /// "rgba8", "r8", "rg8", "rgba16f" or "r32f", as in graph parameters
+    static Format parse(const std::string &name);
+    static const char * getName(Format format);
+
+    /// Bind the texture and allocate size storage with clamp to edge wrapping
+    static void allocate(GLuint texture, const cv::Size &size, Format format);
+
+    /// OpenCV type of read(): 8 bit formats as CV_8U, float formats as CV_32F
+    static int getType(Format format);
+
+    /// Read the bound framebuffer, keeping only the channels of the format
+    static void read(const cv::Size &size, Format format, cv::Mat &image);
+};
+
+_GATHERER_GRAPHICS_END
+
+#endif /* defined(__gatherer__GLTextureFormat__) */
@@ -8,8 +8,9 @@
 
 #include "graphics/GLWarpShader.h"
 #include "graphics/RenderTexture.h"
-#include "graphics/GLTexture.h"
 #include "graphics/GLExtra.h"
+#include "graphics/GLStateCache.h"
+#include "graphics/GLFence.h"
 
 _GATHERER_GRAPHICS_BEGIN
 
@@ -60,6 +61,9 @@ void WarpShader::compileShadersPlanar()
     m_pPlanarShaderProgram = make_unique<gatherer::graphics::shader_prog>(vShaderStr, fShaderStr, attributes);
     m_PlanarUniformMVP = m_pPlanarShaderProgram->GetUniformLocation("modelViewProjMatrix");
     m_PlanarUniformTexture =  m_pPlanarShaderProgram->GetUniformLocation("texture");
+
+    GLStateCache::get().useProgram(*m_pPlanarShaderProgram);
+    glUniform1i(m_PlanarUniformTexture, 0);
     
     gatherer::graphics::glErrorTest();
 }
@@ -90,43 +94,41 @@ GLuint WarpShader::operator()(int texture)
 void WarpShader::operator()(int texture, const cv::Matx33f &H)
 {
     using gatherer::graphics::RenderTexture;
-    using gatherer::graphics::GLTexRect;
-
-    cv::Matx44f MVPt;
-    R3x3To4x4(H.t(), MVPt);
 
-    GLTexRect roi(m_size);
+    GLStateCache &gl = GLStateCache::get();
 
-    // {-1,-1}, {1,-1}, {-1,1}, {1,1}
-    auto vertices = roi.GetVertices();
-    auto coords = GLTexRect::GetTextureCoordinates();
+    // The shared unit quad (u,v) is texture coordinate (u,v) at pixel (u * w, h - v * h),
+    // so the frame rectangle is folded into the matrix instead of per frame vertices
+    const float w = m_size.width;
+    const float h = m_size.height;
+    const cv::Matx33f P(w, 0, 0, 0, -h, h, 0, 0, 1);
 
-    std::vector<cv::Vec4f> vertices4d;
-    for(const auto &p : vertices)
-        vertices4d.emplace_back(p.x, (m_size.height - p.y), 0, 1);
+    cv::Matx44f MVPt;
+    R3x3To4x4((H * P).t(), MVPt);
 
     // Note: We'll assume this is configured by the calling functions
     // Note: for rendering to the display we need to factor in screen resolution
     //glViewport(0, 0, int(m_resolution.x * m_size.width + 0.5f), int(m_resolution.y * m_size.height + 0.5f));
 
-    (*m_pPlanarShaderProgram)();
+    gl.useProgram(*m_pPlanarShaderProgram);
     glUniformMatrix4fv(m_PlanarUniformMVP, 1, 0, (GLfloat *)&MVPt(0,0));
 
+    gl.clearColor(0, 0, 0, 0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glClearColor(0, 0, 0, 0);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    
-    //std::cout << "glBindTexture " << int(glGetError()) << std::endl;
+    GATHERER_GL_READ(texture);
+    gl.bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
 
-    glVertexAttribPointer(RenderTexture::ATTRIB_VERTEX, 4, GL_FLOAT, 0, 0, &vertices4d[0][0]);
-    glEnableVertexAttribArray(RenderTexture::ATTRIB_VERTEX);
-    glVertexAttribPointer(RenderTexture::ATTRIB_TEXTUREPOSITION, 2, GL_FLOAT, 0, 0, &coords[0]);
-    glEnableVertexAttribArray(RenderTexture::ATTRIB_TEXTUREPOSITION);
-    
-    //std::cout << "glVertex stuff " << int(glGetError()) << std::endl;
+    const GLvoid *quad = (const GLvoid *)GLStateCache::getQuadOffset(GLStateCache::kUnitQuad);
+    gl.bindArrayBuffer(gl.getQuadBuffer());
+    glVertexAttribPointer(RenderTexture::ATTRIB_VERTEX, 2, GL_FLOAT, 0, 0, quad);
+    gl.enableVertexAttribArray(RenderTexture::ATTRIB_VERTEX);
+    glVertexAttribPointer(RenderTexture::ATTRIB_TEXTUREPOSITION, 2, GL_FLOAT, 0, 0, quad);
+    gl.enableVertexAttribArray(RenderTexture::ATTRIB_TEXTUREPOSITION);
+
+    gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    // ogles_gpgpu streams vertices from client memory
+    gl.bindArrayBuffer(0);
 }
 
 _GATHERER_GRAPHICS_END
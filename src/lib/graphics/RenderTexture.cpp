@@ -9,6 +9,8 @@
 #include "graphics/gatherer_graphics.h"
 #include "graphics/RenderTexture.h"
 #include "graphics/GLExtra.h"
+#include "graphics/GLStateCache.h"
+#include "graphics/GLFence.h"
 #include <opencv2/imgproc/imgproc.hpp>
 #include <stdio.h>
 
@@ -33,13 +35,17 @@ void LoadFrameTexture( const cv::Mat &image, GLuint texture)
     glErrorTest();
 #endif
     glFlush();
+
+    GATHERER_GL_WRITTEN(texture);
+    GLStateCache::get().invalidate(); // bound outside the cache
 }
 
-RenderTexture::RenderTexture(GLuint p_width, GLuint p_height, float resX, float resY)
+RenderTexture::RenderTexture(GLuint p_width, GLuint p_height, float resX, float resY, GLTextureFormat::Format format)
 : m_width(p_width)
 , m_height(p_height)
 , m_resX(resX)
 , m_resY(resY)
+, m_format(GLTextureFormat::resolve(format))
 {
     glGenFramebuffers(1, &m_fbo);
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
@@ -49,16 +55,8 @@ RenderTexture::RenderTexture(GLuint p_width, GLuint p_height, float resX, float
 int RenderTexture::newTexture()
 {
     glGenTextures(1, &m_texID);
-    glBindTexture(GL_TEXTURE_2D, m_texID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    glBindTexture(GL_TEXTURE_2D, m_texID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    GLTextureFormat::allocate(m_texID, cv::Size(m_width, m_height), m_format);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texID, 0);
 
     //  you can check to see if the framebuffer is 'complete' with no errors
@@ -69,6 +67,7 @@ int RenderTexture::newTexture()
     }
     glBindTexture(GL_TEXTURE_2D, 0);    // unbind frame buffer and texture
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::get().invalidate(); // bound outside the cache
 
     return m_texID;
 }
@@ -77,6 +76,7 @@ RenderTexture::~RenderTexture()
 {
     glDeleteTextures( 1, &m_texID );
     glDeleteFramebuffers( 1, &m_fbo );
+    GLStateCache::get().invalidate(); // the names can be reused
 }
 
 GLuint RenderTexture::render()
@@ -89,18 +89,29 @@ GLuint RenderTexture::render()
 
 void RenderTexture::startRender()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-    glViewport(0,0, int(m_resX * m_width + 0.5f), int(m_resY * m_height + 0.5f));
+    GLStateCache &gl = GLStateCache::get();
+    gl.bindFramebuffer(m_fbo);
+    gl.viewport(0,0, int(m_resX * m_width + 0.5f), int(m_resY * m_height + 0.5f));
 }
 
 void RenderTexture::finishRender()
 {
     //  unbind our framebuffer, return to default state
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::get().bindFramebuffer(0);
+    GATHERER_GL_WRITTEN(m_texID);
 
     //  remember to restore the viewport when you are ready to render to the screen!
 }
 
+void RenderTexture::read(cv::Mat &image)
+{
+    GLStateCache &gl = GLStateCache::get();
+    GATHERER_GL_READ(m_texID);
+    gl.bindFramebuffer(m_fbo);
+    GLTextureFormat::read(cv::Size(m_width, m_height), m_format, image);
+    gl.bindFramebuffer(0);
+}
+
 void RenderTexture::bind()
 {
     glBindTexture( GL_TEXTURE_2D, m_texID );
@@ -10,6 +10,7 @@
 #define __gatherer__RenderTexture__
 
 #include "graphics/gatherer_graphics.h"
+#include "graphics/GLTextureFormat.h"
 #include <opencv2/core/core.hpp>
 #include <vector>
 
@@ -37,11 +38,14 @@ protected:
     float m_resX;
     float m_resY;
 
+    GLTextureFormat::Format m_format;
+
 public:
 
     enum {  ATTRIB_VERTEX, ATTRIB_TEXTUREPOSITION, NUM_ATTRIBUTES };
 
-    RenderTexture(GLuint p_width, GLuint p_height, float resX=1.f, float resY=1.f);
+    /// Unsupported formats fall back to RGBA8, see getFormat()
+    RenderTexture(GLuint p_width, GLuint p_height, float resX=1.f, float resY=1.f, GLTextureFormat::Format format=GLTextureFormat::kRGBA8);
     virtual ~RenderTexture();
     virtual void startRender();
     virtual void finishRender();
@@ -52,6 +56,10 @@ public:
     GLuint getTexture() const { return m_texID; }
     GLuint getWidth() const { return m_width; }
     GLuint getHeight() const { return m_height; }
+    GLTextureFormat::Format getFormat() const { return m_format; }
+
+    /// Read back in the layout of the format (CV_8UC1 for R8, CV_32FC4 for RGBA16F, ...)
+    void read(cv::Mat &image);
 };
 
 void LoadFrameTexture( const cv::Mat &image, GLuint texture );
@@ -8,14 +8,56 @@
 
 #include "graphics/RenderTextureCopy.h"
 #include "graphics/GLExtra.h"
+#include "graphics/GLStateCache.h"
+#include "graphics/GLFence.h"
+
+#include <algorithm>
 
 _GATHERER_GRAPHICS_BEGIN
 
-RenderTextureCopy::RenderTextureCopy(int width, int height) : Super(width, height)
+RenderTextureCopy::RenderTextureCopy(int width, int height, GLTextureFormat::Format format) : Super(width, height, 1.f, 1.f, format)
 {
     CompileShaders();
 }
 
+RenderTextureCopy::~RenderTextureCopy()
+{
+    GLStateCache::get().invalidate(); // our program and buffer names can be reused
+    if(m_vertexBuffer)
+    {
+        glDeleteBuffers(1, &m_vertexBuffer);
+    }
+}
+
+void RenderTextureCopy::SetFrameVertices(const GLfloat *frameVertices)
+{
+    std::copy(frameVertices, frameVertices + 16, m_vertices);
+    m_hasFrameVertices = m_verticesChanged = true;
+}
+
+void RenderTextureCopy::SetTextureCoordinates(const GLfloat *textureCoords)
+{
+    std::copy(textureCoords, textureCoords + 8, m_vertices + 16);
+    m_hasTextureCoordinates = m_verticesChanged = true;
+}
+
+void RenderTextureCopy::UploadVertices()
+{
+    GLStateCache &gl = GLStateCache::get();
+    if(!m_vertexBuffer)
+    {
+        glGenBuffers(1, &m_vertexBuffer);
+        gl.bindArrayBuffer(m_vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices), m_vertices, GL_STATIC_DRAW);
+    }
+    else
+    {
+        gl.bindArrayBuffer(m_vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(m_vertices), m_vertices);
+    }
+    m_verticesChanged = false;
+}
+
 void RenderTextureCopy::CompileShaders() //
 {
     const char *kVertexShaderString = R"(
@@ -29,7 +71,10 @@ void RenderTextureCopy::CompileShaders() //
         })";
 
     const char *kFragmentShaderString = R"(
-        varying highp vec2 textureCoordinate;
+        #ifdef GL_ES
+        precision highp float;
+        #endif
+        varying vec2 textureCoordinate;
         uniform sampler2D texture;
         void main()
         {
@@ -45,7 +90,7 @@ void RenderTextureCopy::CompileShaders() //
 
     try
     {
-        m_pShaderProgram = std::auto_ptr< shader_prog>( new shader_prog(vShaderStr, fShaderStr, attributes) );
+        m_pShaderProgram = make_unique<shader_prog>(vShaderStr, fShaderStr, attributes);
     }
     catch(std::logic_error &e)
     {
@@ -63,7 +108,7 @@ void RenderTextureCopy::SetTextureUnit( int unit, int texture )
 
 void RenderTextureCopy::startRender()
 {
-    (void) newTexture(); // create a new texture to render into
+    // Renders into the texture created with the framebuffer (no per frame allocation)
     RenderTexture::startRender(); // glBindFrameBuffer(...m_fBO);
 }
 void RenderTextureCopy::finishRender()
@@ -73,37 +118,57 @@ void RenderTextureCopy::finishRender()
 
 void RenderTextureCopy::draw()
 {
-    glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
-    glErrorTest();
+    GLStateCache::get().clearColor(1.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
     glErrorTest();
     draw(m_Texture, m_TextureUnit);
-    glFlush();
 }
 
 void RenderTextureCopy::draw(GLuint texture, GLuint unit )
 {
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glErrorTest();
-
-    (*m_pShaderProgram)();
+    GLStateCache &gl = GLStateCache::get();
 
+    GATHERER_GL_READ(texture);
+    gl.bindTexture(GL_TEXTURE0 + unit, GL_TEXTURE_2D, texture);
+    gl.useProgram(*m_pShaderProgram);
     glUniform1i(m_UniformTexture, unit);
-    glErrorTest(); // TODO: 4 should be texture unit input variable
 
-    glVertexAttribPointer(ATTRIB_VERTEX, 4, GL_FLOAT, 0, 0, m_frameVertices);
-    glErrorTest();
-    glEnableVertexAttribArray(ATTRIB_VERTEX);
-    glErrorTest();
-    glVertexAttribPointer(ATTRIB_TEXTUREPOSITION, 2, GL_FLOAT, 0, 0, m_textureCoordinates);
-    glErrorTest();
-    glEnableVertexAttribArray(ATTRIB_TEXTUREPOSITION);
+    if(m_verticesChanged)
+    {
+        UploadVertices();
+    }
+
+    // Custom geometry from our buffer, defaults from the shared quads
+    const GLuint quads = gl.getQuadBuffer();
+    gl.bindArrayBuffer(m_hasFrameVertices ? m_vertexBuffer : quads);
+    if(m_hasFrameVertices)
+    {
+        glVertexAttribPointer(ATTRIB_VERTEX, 4, GL_FLOAT, 0, 0, (const GLvoid *)0);
+    }
+    else
+    {
+        glVertexAttribPointer(ATTRIB_VERTEX, 2, GL_FLOAT, 0, 0, (const GLvoid *)GLStateCache::getQuadOffset(GLStateCache::kClipQuad));
+    }
+    gl.enableVertexAttribArray(ATTRIB_VERTEX);
+
+    gl.bindArrayBuffer(m_hasTextureCoordinates ? m_vertexBuffer : quads);
+    if(m_hasTextureCoordinates)
+    {
+        glVertexAttribPointer(ATTRIB_TEXTUREPOSITION, 2, GL_FLOAT, 0, 0, (const GLvoid *)(16 * sizeof(GLfloat)));
+    }
+    else
+    {
+        glVertexAttribPointer(ATTRIB_TEXTUREPOSITION, 2, GL_FLOAT, 0, 0, (const GLvoid *)GLStateCache::getQuadOffset(GLStateCache::kUnitQuad));
+    }
+    gl.enableVertexAttribArray(ATTRIB_TEXTUREPOSITION);
     glErrorTest();
 
     // Render to texture associated with currently bound RenderTexture::defaultFramebuffer
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
     glErrorTest();
+
+    // ogles_gpgpu streams vertices from client memory
+    gl.bindArrayBuffer(0);
 }
 
 _GATHERER_GRAPHICS_END
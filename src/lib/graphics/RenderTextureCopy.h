@@ -25,15 +25,15 @@ public:
 
     typedef RenderTexture Super;
 
-    RenderTextureCopy(int width, int height);
-    void SetTextureCoordinates(const GLfloat *textureCoords)
-    {
-        m_textureCoordinates = textureCoords;
-    }
-    void SetFrameVertices(const GLfloat *frameVertices)
-    {
-        m_frameVertices = frameVertices;
-    }
+    RenderTextureCopy(int width, int height, GLTextureFormat::Format format = GLTextureFormat::kRGBA8);
+    ~RenderTextureCopy();
+
+    /// 4 texture coordinates (vec2), copied; the unit quad by default
+    void SetTextureCoordinates(const GLfloat *textureCoords);
+
+    /// 4 vertices (vec4) of a triangle strip, copied; the full viewport by default
+    void SetFrameVertices(const GLfloat *frameVertices);
+
     void draw(GLuint texture, GLuint unit );
 
     virtual void draw();
@@ -44,12 +44,19 @@ public:
 protected:
 
     void CompileShaders();
-    const GLfloat *m_textureCoordinates;
-    const GLfloat *m_frameVertices;
-    std::auto_ptr<shader_prog> m_pShaderProgram;
+    void UploadVertices();
+
+    // Custom geometry lives in m_vertexBuffer: 16 vertex floats then 8 texture coordinates
+    GLfloat m_vertices[24];
+    bool m_hasFrameVertices = false;
+    bool m_hasTextureCoordinates = false;
+    bool m_verticesChanged = false;
+    GLuint m_vertexBuffer = 0;
+
+    std::unique_ptr<shader_prog> m_pShaderProgram;
     GLint m_UniformTexture;
-    GLint m_TextureUnit;
-    GLint m_Texture;
+    GLint m_TextureUnit = 0;
+    GLint m_Texture = 0;
     GLint m_UniformAlpha;
 };
 
@@ -25,12 +25,9 @@
 #  define GATHERER_IOS 1
 #  include <OpenGLES/ES2/gl.h>
 #  include <OpenGLES/ES2/glext.h>
-#  include <arm_neon.h>
-#  define DO_GRAPHICS_SIMD 1
 #else
 #  include <OpenGL/gl.h>
 #  include <OpenGL/glext.h>
-#  define DO_GRAPHICS_SIMD 0
 #endif
 #elif __ANDROID__ || ANDROID
 //#include <GLES3/gl3.h>
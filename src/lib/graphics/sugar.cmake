@@ -13,8 +13,14 @@ include(sugar_files)
 
 sugar_files(
     GATHERER_GRAPHICS_SRC
+    GLCapabilities.cpp
     GLExtra.cpp
+    GLFence.cpp
+    GLReductions.cpp
     GLSLShaderProgram.cpp
+    GLStateCache.cpp
+    GLTexture.cpp
+    GLTextureFormat.cpp
     GLWarpShader.cpp
     RenderTexture.cpp
     RenderTextureCopy.cpp
@@ -23,9 +29,14 @@ sugar_files(
 
 sugar_files(
     GATHERER_GRAPHICS_HDRS
+    GLCapabilities.h
     GLExtra.h
+    GLFence.h
+    GLReductions.h
     GLSLShaderProgram.h
+    GLStateCache.h
     GLTexture.h
+    GLTextureFormat.h
     GLWarpShader.h
     RenderTexture.h
     RenderTextureCopy.h
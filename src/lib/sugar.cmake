@@ -11,5 +11,7 @@ endif()
 
 include(sugar_include)
 
+sugar_include(cpu)
+sugar_include(gpgpu)
 sugar_include(graphics)
 
@@ -0,0 +1,141 @@
+// Exactness and per-variant speed of the dispatched CPU kernels.
+//
+// Every instruction set variant usable on the host is compared bit for bit
+// against the scalar reference and timed on 1080p rows.  Set
+// GATHERER_CPU_DISPATCH to pin the variant used by the processing stages.
+
+#include <gtest/gtest.h>
+
+#include "cpu/Kernels.h"
+#include "cpu/CpuFeatures.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#define BEGIN_EMPTY_NAMESPACE namespace {
+#define END_EMPTY_NAMESPACE }
+
+BEGIN_EMPTY_NAMESPACE
+
+using namespace gatherer::cpu::kernels;
+
+class CpuKernelsTest : public ::testing::Test
+{
+protected:
+
+    CpuKernelsTest()
+    {
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int> value(0, 255);
+        for(auto &row : rows)
+        {
+            row.resize(kPadding + kWidth * 4 + kPadding);
+            for(auto &v : row)
+            {
+                v = uint8_t(value(rng) & 0xf0); // lots of ties for the LBP comparisons
+            }
+        }
+        for(auto &row : shorts)
+        {
+            row.resize(kWidth * 4);
+            for(auto &v : row)
+            {
+                v = int16_t(value(rng) << 6);
+            }
+        }
+        for(int k = 0; k < 9; k++)
+        {
+            window[k] = shorts[k].data();
+        }
+    }
+
+    const uint8_t * row(int i) const { return rows[i].data() + kPadding; }
+
+    // Odd width so every variant runs its tail code
+    static const int kWidth = 1920 + 13;
+    static const int kPadding = 16;
+
+    std::vector<uint8_t> rows[3];
+    std::vector<int16_t> shorts[9];
+    const int16_t *window[9];
+};
+
+// Average nanoseconds per call of function
+template <typename Function>
+static double benchmark(const Function &function, int n = 200)
+{
+    function(); // warm up
+    const int64 start = cv::getTickCount();
+    for(int i = 0; i < n; i++)
+    {
+        function();
+    }
+    return double(cv::getTickCount() - start) * 1e9 / (cv::getTickFrequency() * double(n));
+}
+
+TEST_F(CpuKernelsTest, exactness)
+{
+    const KernelTable &reference = getScalarKernels();
+    const GrayWeights weights = getGrayWeightsBGR();
+
+    std::vector<uint8_t> expected(kWidth * 4), result(kWidth * 4);
+    std::vector<int16_t> expected16(kWidth * 4), result16(kWidth * 4);
+
+    for(const KernelTable *table : getAvailableKernels())
+    {
+        SCOPED_TRACE(table->name);
+        for(int channels = 1; channels <= 4; channels++)
+        {
+            reference.rowToGray(row(0), expected.data(), kWidth, channels, weights);
+            table->rowToGray(row(0), result.data(), kWidth, channels, weights);
+            EXPECT_EQ(expected, result) << "rowToGray channels=" << channels;
+
+            reference.rowGaussH(row(0), expected16.data(), kWidth, channels);
+            table->rowGaussH(row(0), result16.data(), kWidth, channels);
+            EXPECT_TRUE(std::equal(expected16.begin(), expected16.begin() + kWidth * channels, result16.begin())) << "rowGaussH channels=" << channels;
+        }
+
+        for(float strength : { 0.5f, 1.f, 4.f })
+        {
+            reference.rowGradient(row(0), row(1), row(2), expected.data(), kWidth, strength);
+            table->rowGradient(row(0), row(1), row(2), result.data(), kWidth, strength);
+            EXPECT_EQ(expected, result) << "rowGradient strength=" << strength;
+        }
+
+        reference.rowGaussV(window, expected.data(), kWidth * 4);
+        table->rowGaussV(window, result.data(), kWidth * 4);
+        EXPECT_EQ(expected, result) << "rowGaussV";
+
+        reference.rowLbp(row(0), row(1), row(2), expected.data(), kWidth);
+        table->rowLbp(row(0), row(1), row(2), result.data(), kWidth);
+        EXPECT_TRUE(std::equal(expected.begin(), expected.begin() + kWidth, result.begin())) << "rowLbp";
+    }
+}
+
+TEST_F(CpuKernelsTest, benchmark)
+{
+    const GrayWeights weights = getGrayWeightsBGR();
+    std::vector<uint8_t> dst(kWidth * 4);
+    std::vector<int16_t> dst16(kWidth * 4);
+
+    std::cout << "host: " << gatherer::cpu::CpuFeatures::get().toString() << ", selected: " << getKernels().name << std::endl;
+    std::cout << "ns/row (" << kWidth << " px)   gray3    gray4    grad     gaussH   gaussV   lbp" << std::endl;
+    for(const KernelTable *table : getAvailableKernels())
+    {
+        std::cout << std::setw(20) << std::left << table->name << std::right << std::fixed << std::setprecision(0);
+        std::cout << std::setw(9) << benchmark([&]() { table->rowToGray(row(0), dst.data(), kWidth, 3, weights); });
+        std::cout << std::setw(9) << benchmark([&]() { table->rowToGray(row(0), dst.data(), kWidth, 4, weights); });
+        std::cout << std::setw(9) << benchmark([&]() { table->rowGradient(row(0), row(1), row(2), dst.data(), kWidth, 1.f); });
+        std::cout << std::setw(9) << benchmark([&]() { table->rowGaussH(row(0), dst16.data(), kWidth, 4); });
+        std::cout << std::setw(9) << benchmark([&]() { table->rowGaussV(window, dst.data(), kWidth * 4); });
+        std::cout << std::setw(9) << benchmark([&]() { table->rowLbp(row(0), row(1), row(2), dst.data(), kWidth); });
+        std::cout << std::endl;
+    }
+}
+
+END_EMPTY_NAMESPACE
@@ -0,0 +1,131 @@
+// Fused point operation chains against the equivalent sequence of
+// materialized OpenCV-style steps.
+
+#include <gtest/gtest.h>
+
+#include "cpu/PointOps.h"
+#include "cpu/PointProc.h"
+#include "cpu/GrayscaleProc.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <cmath>
+#include <random>
+
+#define BEGIN_EMPTY_NAMESPACE namespace {
+#define END_EMPTY_NAMESPACE }
+
+BEGIN_EMPTY_NAMESPACE
+
+namespace ops = gatherer::cpu::ops;
+
+class CpuPointOpsTest : public ::testing::Test
+{
+protected:
+
+    CpuPointOpsTest() : image(241, 319, CV_8UC4)
+    {
+        std::mt19937 rng(7);
+        for(int y = 0; y < image.rows; y++)
+        {
+            uint8_t *row = image.ptr<uint8_t>(y);
+            for(int x = 0; x < image.cols * 4; x++)
+            {
+                row[x] = uint8_t(rng());
+            }
+        }
+    }
+
+    // Unfused reference: gray image, then gain/offset and threshold per pixel
+    cv::Mat reference(float gain, float offset, float thresh) const
+    {
+        gatherer::cpu::GrayscaleProc grayscaleProc;
+        grayscaleProc.process(image);
+        cv::Mat gray = grayscaleProc.getResult(), result(gray.size(), CV_8UC1);
+        for(int y = 0; y < gray.rows; y++)
+        {
+            for(int x = 0; x < gray.cols; x++)
+            {
+                const float v = float(gray.ptr<uint8_t>(y)[x]) * gain + offset;
+                result.ptr<uint8_t>(y)[x] = (v > thresh) ? 255 : 0;
+            }
+        }
+        return result;
+    }
+
+    cv::Mat image;
+};
+
+TEST_F(CpuPointOpsTest, transform)
+{
+    auto op = ops::grayBGR() | ops::gainOffset(1.5f, -20.f) | ops::threshold(128.f);
+
+    cv::Mat fused;
+    ops::transform(image, fused, op);
+
+    const cv::Mat expected = reference(1.5f, -20.f, 128.f);
+    for(int y = 0; y < image.rows; y++)
+    {
+        for(int x = 0; x < image.cols; x++)
+        {
+            ASSERT_EQ(fused.ptr<uint8_t>(y)[x], expected.ptr<uint8_t>(y)[x]) << x << "," << y;
+        }
+    }
+
+    // Same chain as a pipeline stage:
+    auto pointProc = gatherer::cpu::makePointProc(op);
+    pointProc.process(image);
+    EXPECT_EQ(pointProc.getResult().size(), image.size());
+    EXPECT_EQ(pointProc.getResult().ptr<uint8_t>(17)[23], fused.ptr<uint8_t>(17)[23]);
+}
+
+TEST_F(CpuPointOpsTest, lutAndChannel)
+{
+    uint8_t invert[256];
+    for(int i = 0; i < 256; i++)
+    {
+        invert[i] = uint8_t(255 - i);
+    }
+
+    cv::Mat result;
+    ops::transform(image, result, ops::channel<2>() | ops::lut(invert));
+    for(int y = 0; y < image.rows; y += 7)
+    {
+        for(int x = 0; x < image.cols; x += 5)
+        {
+            ASSERT_EQ(result.ptr<uint8_t>(y)[x], 255 - image.ptr<uint8_t>(y)[x * 4 + 2]);
+        }
+    }
+}
+
+TEST_F(CpuPointOpsTest, statistics)
+{
+    auto op = ops::channel<1>() | ops::gainOffset(0.5f, 3.f);
+
+    int hist[256] = { 0 };
+    ops::histogram(image, op, hist);
+    const ops::Statistics stats = ops::statistics(image, op);
+
+    int expectedHist[256] = { 0 };
+    double sum = 0.0;
+    float lo = 1e9f, hi = -1e9f;
+    for(int y = 0; y < image.rows; y++)
+    {
+        for(int x = 0; x < image.cols; x++)
+        {
+            const float v = float(image.ptr<uint8_t>(y)[x * 4 + 1]) * 0.5f + 3.f;
+            expectedHist[int(v + 0.5f)]++;
+            sum += v;
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+    }
+
+    EXPECT_TRUE(std::equal(hist, hist + 256, expectedHist));
+    EXPECT_EQ(stats.count, size_t(image.total()));
+    EXPECT_NEAR(stats.mean(), sum / double(image.total()), 1e-6);
+    EXPECT_EQ(stats.min, lo);
+    EXPECT_EQ(stats.max, hi);
+}
+
+END_EMPTY_NAMESPACE
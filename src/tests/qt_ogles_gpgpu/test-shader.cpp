@@ -8,12 +8,42 @@
 #include "graphics/Logger.h"
 #include "ogles_gpgpu/common/proc/blend.h"
 
+#include "cpu/GrayscaleProc.h"
+#include "cpu/GradProc.h"
+#include "cpu/GaussProc.h"
+#include "cpu/CornerDetector.h"
+#include "cpu/LbpProc.h"
+#include "cpu/LbpHistogramProc.h"
+
+#include "gpgpu/PointPipeline.h"
+#include "gpgpu/Graph.h"
+#include "gpgpu/KeypointCompactor.h"
+#include "gpgpu/PyramidReader.h"
+#include "gpgpu/ScaleSpaceGenerator.h"
+#include "gpgpu/FrameHistory.h"
+#include "gpgpu/GradientPlanes.h"
+#include "gpgpu/TemporalFilter.h"
+#include "gpgpu/LucasKanadeTracker.h"
+#include "gpgpu/BatchWarpShader.h"
+#include "gpgpu/PackedLuma.h"
+#include "gpgpu/PackedReader.h"
+#include "graphics/GLReductions.h"
+#include "graphics/GLStateCache.h"
+#include "graphics/GLFence.h"
+#include "graphics/GLTexture.h"
+#include "graphics/GLTextureFormat.h"
+#include "graphics/GLCapabilities.h"
+#include "graphics/RenderTextureCopy.h"
+
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
+#include <sstream>
+#include <thread>
 
 #define DISPLAY_OUTPUT 1
 
@@ -49,9 +79,19 @@ protected:
 	// Cleanup
 	virtual ~QOGLESGPGPUTest()
 	{
+        // The shared quad buffer goes away with this context
+        gatherer::graphics::GLStateCache::get().release();
         gatherer::graphics::Logger::drop("test-shader");
 	}
     
+    // Tear down the GL context as between two fixtures and continue in a new one
+    void recreateContext()
+    {
+        m_pipeline.reset();
+        gatherer::graphics::GLStateCache::get().release();
+        m_context = std::make_shared<QGLContext>();
+    }
+    
     void createPipelien(int number)
     {
         float resolution = 1.f; // only for retina display
@@ -116,26 +156,6 @@ struct SobelResult
 };
 
 
-static void extract(const cv::Mat &image, cv::Size size, std::vector<cv::Mat> &pyramid, int n = 8)
-{
-    cv::Point tl(0,0);
-    for (int i = 0; i <= n; ++i)
-    {
-        pyramid.push_back( image(cv::Rect(tl, size)) );
-        
-        if(i % 2)
-        {
-            tl.y += size.height;
-        }
-        else
-        {
-            tl.x += size.width;
-        }
-        size.width >>= 1;
-        size.height >>= 1;
-    }
-}
-
 static cv::Mat getImage(ogles_gpgpu::ProcInterface &proc)
 {
     cv::Mat result(proc.getOutFrameH(), proc.getOutFrameW(), CV_8UC4);
@@ -248,6 +268,33 @@ TEST_F(QOGLESGPGPUTest, pyramid)
     video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
     cv::Mat result = getImage(pyrProc);
     
+    // Level views must match the same rectangles of the full readback:
+    const auto layout = gatherer::graphics::PyramidLayout::octaves(image.size(), 9);
+    gatherer::graphics::PyramidReader reader(layout);
+    reader(pyrProc.getOutputTexId());
+    for(size_t i = 0; i < layout.size(); i++)
+    {
+        ASSERT_EQ(reader.getLevel(i).size(), layout.levels[i].size());
+        EXPECT_EQ(cv::countNonZero(reader.getLevel(i).reshape(1) != result(layout.levels[i]).reshape(1)), 0);
+    }
+    const size_t fullSize = reader.getReadbackSize();
+    
+    // Coarse levels only:
+    const std::vector<int> coarse { 4, 5, 6, 7, 8 };
+    reader(pyrProc.getOutputTexId(), coarse);
+    for(size_t i = 0; i < layout.size(); i++)
+    {
+        if(std::find(coarse.begin(), coarse.end(), int(i)) == coarse.end())
+        {
+            EXPECT_TRUE(reader.getLevel(i).empty());
+        }
+        else
+        {
+            EXPECT_EQ(cv::countNonZero(reader.getLevel(i).reshape(1) != result(layout.levels[i]).reshape(1)), 0);
+        }
+    }
+    EXPECT_LT(reader.getReadbackSize() * 16, fullSize);
+    
 #if DISPLAY_OUTPUT
     cv::imshow("pyramid", result);
 #endif
@@ -321,9 +368,9 @@ TEST_F(QOGLESGPGPUTest, pyredge)
     
 #define EXTRACT_PYRAMID 0
 #if EXTRACT_PYRAMID
-    std::vector<cv::Mat> pyramid;
-    extract(result, image.size(), pyramid, 8);
-    for(auto &l : pyramid)
+    gatherer::graphics::PyramidReader reader(gatherer::graphics::PyramidLayout::octaves(image.size(), 9));
+    reader(gaussProc.getOutputTexId());
+    for(auto &l : reader.getLevels())
     {
         cv::imshow("l", l);
     }
@@ -480,5 +527,1162 @@ TEST_F(QOGLESGPGPUTest, corner)
 #endif
 }
 
-END_EMPTY_NAMESPACE
+// Mean absolute difference of two single channel images
+static double meanAbsDiff(const cv::Mat &a, const cv::Mat &b, const cv::Mat &mask = cv::Mat())
+{
+    cv::Mat diff;
+    cv::absdiff(a, b, diff);
+    return cv::mean(diff, mask)[0];
+}
+
+TEST_F(QOGLESGPGPUTest, cpu_grad)
+{
+    // #### GPU ####
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc grayscaleProc;
+    ogles_gpgpu::GradProc gradProc;
+    ogles_gpgpu::GaussProc gaussProc;
+    
+    video.set(&grayscaleProc);
+    grayscaleProc.add(&gradProc);
+    gradProc.add(&gaussProc);
+    
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    cv::Mat gradGPU = getImage(gradProc);
+    cv::Mat gaussGPU = getImage(gaussProc);
+    
+    // #### CPU ####
+    gatherer::cpu::GrayscaleProc cpuGrayscaleProc;
+    gatherer::cpu::GradProc cpuGradProc;
+    gatherer::cpu::GaussProc cpuGaussProc;
+    
+    cpuGrayscaleProc.add(&cpuGradProc);
+    cpuGradProc.add(&cpuGaussProc);
+    
+    cpuGrayscaleProc.process(image);
+    cv::Mat gradCPU = cpuGradProc.getResult().clone();
+    cv::Mat gaussCPU = cpuGaussProc.getResult().clone();
+    
+    ASSERT_EQ(gradCPU.size(), gradGPU.size());
+    ASSERT_EQ(gaussCPU.size(), gaussGPU.size());
+    
+    std::vector<cv::Mat> cpu, gpu;
+    cv::split(gradCPU, cpu);
+    cv::split(gradGPU, gpu);
+    
+    // Orientation is only meaningful where there is some gradient energy:
+    cv::Mat edges = (gpu[0] > 16);
+    EXPECT_LE(meanAbsDiff(cpu[0], gpu[0]), 2.0);
+    EXPECT_LE(meanAbsDiff(cpu[1], gpu[1], edges), 4.0);
+    EXPECT_LE(meanAbsDiff(cpu[2], gpu[2]), 2.0);
+    EXPECT_LE(meanAbsDiff(cpu[3], gpu[3]), 2.0);
+    
+    cv::split(gaussCPU, cpu);
+    cv::split(gaussGPU, gpu);
+    for(int i = 0; i < 4; i++)
+    {
+        EXPECT_LE(meanAbsDiff(cpu[i], gpu[i]), 3.0);
+    }
+    
+    // The scalar single threaded path must match the SIMD path exactly:
+    gatherer::cpu::ProcBase::Options options;
+    options.simd = false;
+    options.parallel = false;
+    cpuGrayscaleProc.setOptions(options);
+    cpuGrayscaleProc.process(image);
+    EXPECT_EQ(cv::countNonZero(cpuGaussProc.getResult().reshape(1) != gaussCPU.reshape(1)), 0);
+    
+#if DISPLAY_OUTPUT
+    cv::Mat canvas;
+    cv::hconcat(gradCPU, gradGPU, canvas);
+    cv::imshow("cpu_grad", canvas);
+    cv::waitKey(0);
+#endif
+}
+
+TEST_F(QOGLESGPGPUTest, cpu_corner)
+{
+    // #### GPU ####
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc grayscaleProc;
+    ogles_gpgpu::TensorProc tensorProc;
+    ogles_gpgpu::GaussProc gaussProc;
+    ogles_gpgpu::ShiTomasiProc shiTomasiProc;
+    ogles_gpgpu::NmsProc nmsProc;
+    
+    video.set(&grayscaleProc);
+    grayscaleProc.add(&tensorProc);
+    tensorProc.add(&gaussProc);
+    gaussProc.add(&shiTomasiProc);
+    shiTomasiProc.add(&nmsProc);
+    
+    tensorProc.setEdgeStrength(1.0);
+    shiTomasiProc.setSensitivity(10.0);
+    nmsProc.setThreshold(0.1);
+    
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    cv::Mat result = getImage(nmsProc);
+    
+    cv::Mat mask;
+    cv::extractChannel(result, mask, 0);
+    
+    // #### CPU ####
+    gatherer::cpu::GrayscaleProc cpuGrayscaleProc;
+    gatherer::cpu::CornerDetector cornerDetector;
+    cpuGrayscaleProc.add(&cornerDetector);
+    
+    cornerDetector.setEdgeStrength(1.0);
+    cornerDetector.setSensitivity(10.0);
+    cornerDetector.setThreshold(0.1);
+    
+    cpuGrayscaleProc.process(image);
+    const auto &keypoints = cornerDetector.getKeypoints();
+    ASSERT_GT(keypoints.size(), 0);
+    
+    // Most CPU corners should have a GPU corner close by (the GPU path quantizes
+    // every intermediate to 8 bits, so an exact match is not expected):
+    cv::Mat near;
+    cv::dilate(mask, near, cv::getStructuringElement(cv::MORPH_RECT, {5,5}));
+    
+    int matched = 0;
+    cv::Mat canvas = image.clone();
+    for(size_t i = 0; i < keypoints.size(); i++)
+    {
+        cv::Point p(keypoints.x[i], keypoints.y[i]);
+        matched += (near.at<uint8_t>(p) > 0);
+        cv::circle(canvas, p, 2, {0,255,0}, -1, 8);
+    }
+    EXPECT_GE(double(matched) / double(keypoints.size()), 0.8);
+    
+#if DISPLAY_OUTPUT
+    cv::imshow("cpu_corner", canvas);
+    cv::waitKey(0);
+#endif
+}
+
+// Average milliseconds per call of function over n calls
+template <typename Function>
+static double benchmark(const Function &function, int n = 10)
+{
+    function(); // warm up
+    int64 start = cv::getTickCount();
+    for(int i = 0; i < n; i++)
+    {
+        function();
+    }
+    return double(cv::getTickCount() - start) * 1000.0 / (cv::getTickFrequency() * double(n));
+}
+
+TEST_F(QOGLESGPGPUTest, cpu_lbp)
+{
+    // #### GPU ####
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc grayProc;
+    ogles_gpgpu::LbpProc lbpProc;
+    
+    video.set(&grayProc);
+    grayProc.add(&lbpProc);
+    
+    cv::Mat result;
+    double gpuTime = benchmark([&]()
+    {
+        video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+        result = getImage(lbpProc);
+    });
+    
+    cv::Mat gray, lbpGPU;
+    cv::extractChannel(getImage(grayProc), gray, 0);
+    cv::extractChannel(result, lbpGPU, 0);
+    
+    // #### CPU (reference) ####
+    cv::Mat lbpReference;
+    double referenceTime = benchmark([&]() { olbp_<unsigned char>(gray, lbpReference); });
+    
+    // #### CPU ####
+    gatherer::cpu::LbpProc cpuLbpProc;
+    double cpuTime = benchmark([&]() { cpuLbpProc.process(gray); });
+    
+    // Same luminance input, so the codes must match the shader exactly:
+    cv::Mat lbpCPU = cpuLbpProc.getResult();
+    ASSERT_EQ(lbpCPU.size(), lbpGPU.size());
+    EXPECT_EQ(cv::countNonZero(lbpCPU != lbpGPU), 0);
+    
+    gatherer::cpu::LbpHistogramProc histogramProc;
+    double histogramTime = benchmark([&]() { histogramProc.process(gray); });
+    EXPECT_EQ(histogramProc.getResult().rows, (gray.cols / 16) * (gray.rows / 16));
+    EXPECT_EQ(histogramProc.getResult().cols, 59);
+    
+    m_logger->info() << "lbp (ms): olbp_ " << referenceTime << " cpu " << cpuTime << " gpu+readback " << gpuTime << " cpu histogram " << histogramTime;
+    
+#if DISPLAY_OUTPUT
+    cv::imshow("lbpCPU", lbpCPU);
+    cv::imshow("lbpGPU", lbpGPU);
+    cv::waitKey(0);
+#endif
+}
+
+TEST_F(QOGLESGPGPUTest, fusion)
+{
+    // grayscale -> contrast -> blend with the input, then a neighbourhood stage
+    // (the contrast stays in [0,1], so the unfused passes don't clip):
+    gatherer::graphics::GrayscaleStage grayscale;
+    gatherer::graphics::GainOffsetStage contrast(0.8f, 0.1f);
+    gatherer::graphics::BlendStage blend(0.5f);
+    
+    ogles_gpgpu::GaussProc fusedGaussProc, gaussProc;
+    
+    gatherer::graphics::PointPipeline fused, unfused;
+    for(auto *pipeline : { &fused, &unfused })
+    {
+        pipeline->add(&grayscale);
+        pipeline->add(&contrast);
+        pipeline->add(&blend);
+    }
+    fused.add(&fusedGaussProc);
+    unfused.add(&gaussProc);
+    
+    fused.build(true);
+    unfused.build(false);
+    EXPECT_TRUE(fused.getCompileLog().empty()) << fused.getCompileLog();
+    ASSERT_EQ(fused.getPasses().size(), 2u);
+    ASSERT_EQ(unfused.getPasses().size(), 4u);
+    
+    ogles_gpgpu::VideoSource videoFused, videoUnfused;
+    videoFused.set(fused.getFirst());
+    videoUnfused.set(unfused.getFirst());
+    
+    cv::Mat resultFused, resultUnfused;
+    double fusedTime = benchmark([&]()
+    {
+        videoFused({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+        resultFused = getImage(*fused.getLast());
+    });
+    double unfusedTime = benchmark([&]()
+    {
+        videoUnfused({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+        resultUnfused = getImage(*unfused.getLast());
+    });
+    
+    // CPU reference of the point stages, on the RGBA texels of the input:
+    cv::Mat rgba, expected(image.size(), CV_8UC4);
+    cv::cvtColor(image, rgba, cv::COLOR_BGRA2RGBA);
+    for(int y = 0; y < rgba.rows; y++)
+    {
+        for(int x = 0; x < rgba.cols; x++)
+        {
+            const cv::Vec4f source = cv::Vec4f(rgba.at<cv::Vec4b>(y, x)) / 255.f;
+            const float gray = 0.299f * source[0] + 0.587f * source[1] + 0.114f * source[2];
+            const float color = gray * 0.8f + 0.1f;
+            cv::Vec4b &pixel = expected.at<cv::Vec4b>(y, x);
+            for(int c = 0; c < 3; c++)
+            {
+                pixel[c] = cv::saturate_cast<uint8_t>((source[c] * 0.5f + color * 0.5f) * 255.f);
+            }
+            pixel[3] = 255;
+        }
+    }
+    
+    // The unfused graph also rounds the gray and contrast textures to 8 bits:
+    const cv::Mat pointFused = getImage(*fused.getPasses()[0]);
+    const cv::Mat pointUnfused = getImage(*unfused.getPasses()[2]);
+    ASSERT_EQ(pointFused.size(), expected.size());
+    ASSERT_EQ(pointUnfused.size(), expected.size());
+    EXPECT_LE(cv::norm(pointFused, expected, cv::NORM_INF), 1.0);
+    EXPECT_LE(cv::norm(pointUnfused, expected, cv::NORM_INF), 2.0);
+    
+    ASSERT_EQ(resultFused.size(), resultUnfused.size());
+    EXPECT_LE(cv::norm(resultFused, resultUnfused, cv::NORM_INF), 2.0);
+    
+    m_logger->info() << "fusion (ms): fused " << fusedTime << " unfused " << unfusedTime;
+    
+#if DISPLAY_OUTPUT
+    cv::Mat canvas;
+    cv::hconcat(resultFused, resultUnfused, canvas);
+    cv::imshow("fusion", canvas);
+    cv::waitKey(0);
+#endif
+}
+
+TEST_F(QOGLESGPGPUTest, graph)
+{
+    gatherer::graphics::GraphDescription description;
+    description.add("gray", "grayscale", { "input" })
+               .add("grad", "grad", { "gray" })
+               .add("lbp", "lbp", { "gray" })
+               .add("tensor", "tensor", { "gray" }, { { "edgeStrength", "1.0" } })
+               .add("gauss", "gauss", { "tensor" });
+    
+    // The description survives a JSON round trip:
+    std::stringstream json;
+    description.save(json);
+    gatherer::graphics::GraphDescription loaded;
+    loaded.load(json);
+    ASSERT_EQ(loaded.nodes.size(), description.nodes.size());
+    EXPECT_EQ(loaded.nodes[3].parameters["edgeStrength"], "1.0");
+    
+    gatherer::graphics::Graph graph(loaded);
+    
+    // Input texture from a pass through proc, as in the blend test:
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc inputProc;
+    inputProc.setGrayscaleConvType(ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_NONE);
+    video.set(&inputProc);
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    
+    auto process = [&]() { graph.process(inputProc.getOutputTexId(), image.cols, image.rows); };
+    
+    // Nothing consumed, nothing rendered:
+    process();
+    EXPECT_EQ(graph.getRenderCount(), 0u);
+    
+    graph.setDisplay("grad");
+    process();
+    EXPECT_EQ(graph.getRenderCount(), 2u);
+    EXPECT_TRUE(graph.isRendered("gray") && graph.isRendered("grad"));
+    EXPECT_FALSE(graph.isRendered("lbp") || graph.isRendered("tensor") || graph.isRendered("gauss"));
+    
+    int corners = 0;
+    graph.setHandler("gauss", [&](ogles_gpgpu::ProcInterface &) { corners++; });
+    process();
+    EXPECT_EQ(graph.getRenderCount(), 4u);
+    EXPECT_EQ(corners, 1);
+    
+    // Switch the analysis branch off again and read lbp once:
+    graph.setHandler("gauss", nullptr);
+    graph.request("lbp");
+    process();
+    EXPECT_EQ(graph.getRenderCount(), 3u);
+    EXPECT_TRUE(graph.isRendered("lbp"));
+    cv::Mat lbp = getImage(*graph.getProc("lbp"));
+    
+    process();
+    EXPECT_EQ(graph.getRenderCount(), 2u);
+    
+    // Same output as the imperatively wired chain:
+    ogles_gpgpu::VideoSource reference;
+    ogles_gpgpu::GrayscaleProc grayProc;
+    ogles_gpgpu::LbpProc lbpProc;
+    reference.set(&grayProc);
+    grayProc.add(&lbpProc);
+    reference({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    EXPECT_EQ(cv::countNonZero(getImage(lbpProc).reshape(1) != lbp.reshape(1)), 0);
+}
+
+TEST_F(QOGLESGPGPUTest, corner_compact)
+{
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc grayscaleProc;
+    ogles_gpgpu::TensorProc tensorProc;
+    ogles_gpgpu::GaussProc gaussProc;
+    ogles_gpgpu::ShiTomasiProc shiTomasiProc;
+    ogles_gpgpu::NmsProc nmsProc;
+    
+    video.set(&grayscaleProc);
+    grayscaleProc.add(&tensorProc);
+    tensorProc.add(&gaussProc);
+    gaussProc.add(&shiTomasiProc);
+    shiTomasiProc.add(&nmsProc);
+    
+    tensorProc.setEdgeStrength(1.0);
+    shiTomasiProc.setSensitivity(10.0);
+    nmsProc.setThreshold(0.1);
+    
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    
+    // ### Full readback ###
+    cv::Mat mask;
+    std::vector<cv::Point> points;
+    double fullTime = benchmark([&]()
+    {
+        cv::extractChannel(getImage(nmsProc), mask, 0);
+        points.clear();
+        try { cv::findNonZero(mask, points); } catch(...) {}
+    });
+    
+    // ### Compacted list only ###
+    gatherer::graphics::KeypointCompactor compactor(4096);
+    double compactTime = benchmark([&]()
+    {
+        compactor(nmsProc.getOutputTexId(), nmsProc.getOutFrameW(), nmsProc.getOutFrameH());
+    });
+    
+    const auto &keypoints = compactor.getKeypoints();
+    ASSERT_EQ(compactor.getTotalCount(), int(points.size()));
+    ASSERT_EQ(keypoints.size(), points.size());
+    for(size_t i = 0; i < keypoints.size(); i++)
+    {
+        const cv::Point p(keypoints.x[i], keypoints.y[i]);
+        EXPECT_EQ(int(keypoints.score[i] * 255.f + 0.5f), int(mask.at<uint8_t>(p)));
+    }
+    
+    // Top-K keeps the strongest responses:
+    const int k = std::min(16, int(points.size()));
+    std::vector<int> scores;
+    for(const auto &p : points)
+    {
+        scores.push_back(mask.at<uint8_t>(p));
+    }
+    std::sort(scores.rbegin(), scores.rend());
+    compactor.setTopK(k);
+    compactor(nmsProc.getOutputTexId(), nmsProc.getOutFrameW(), nmsProc.getOutFrameH());
+    ASSERT_EQ(int(compactor.getKeypoints().size()), k);
+    for(int i = 0; i < k; i++)
+    {
+        EXPECT_EQ(int(compactor.getKeypoints().score[i] * 255.f + 0.5f), scores[i]);
+    }
+    
+    m_logger->info() << "corner readback (ms): full " << fullTime << " compact " << compactTime << " (" << compactor.getReadbackSize() << " bytes)";
+}
+
+TEST_F(QOGLESGPGPUTest, compact_odd_size)
+{
+    // Odd sizes leave half empty 2x2 blocks on the last row and column,
+    // which must not pick up the clamped edge texels:
+    cv::Mat mask(67, 101, CV_8UC1, cv::Scalar::all(0));
+    cv::RNG rng(7);
+    for(int i = 0; i < 200; i++)
+    {
+        mask.at<uint8_t>(rng.uniform(0, mask.rows), rng.uniform(0, mask.cols)) = uint8_t(rng.uniform(1, 256));
+    }
+    mask.col(mask.cols - 1).setTo(200);
+    mask.row(mask.rows - 1).setTo(100);
+    
+    cv::Mat channels[3] = { mask, mask, mask }, bgr;
+    cv::merge(channels, 3, bgr);
+    gatherer::graphics::GLTexture texture(bgr);
+    
+    gatherer::graphics::KeypointCompactor compactor(4096);
+    compactor(texture, mask.cols, mask.rows);
+    
+    std::vector<cv::Point> points;
+    cv::findNonZero(mask, points);
+    ASSERT_EQ(compactor.getTotalCount(), int(points.size()));
+    
+    const auto &keypoints = compactor.getKeypoints();
+    ASSERT_EQ(keypoints.size(), points.size());
+    std::vector<cv::Point> compacted;
+    for(size_t i = 0; i < keypoints.size(); i++)
+    {
+        const cv::Point p(keypoints.x[i], keypoints.y[i]);
+        ASSERT_TRUE(cv::Rect(0, 0, mask.cols, mask.rows).contains(p));
+        EXPECT_EQ(int(keypoints.score[i] * 255.f + 0.5f), int(mask.at<uint8_t>(p)));
+        compacted.push_back(p);
+    }
+    
+    // Same set of texels, in quadtree instead of raster order:
+    auto less = [](const cv::Point &a, const cv::Point &b) { return (a.y < b.y) || (a.y == b.y && a.x < b.x); };
+    std::sort(compacted.begin(), compacted.end(), less);
+    EXPECT_TRUE(compacted == points);
+}
+
+TEST_F(QOGLESGPGPUTest, scale_space)
+{
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc inputProc;
+    inputProc.setGrayscaleConvType(ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_NONE);
+    video.set(&inputProc);
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    const cv::Mat input = getImage(inputProc);
+    
+    const auto scales = gatherer::graphics::ScaleSpaceGenerator::getGeometricScales(32, 0.95f);
+    gatherer::graphics::ScaleSpaceGenerator scaleSpace;
+    scaleSpace.setScales(scales);
+    double atlasTime = benchmark([&]()
+    {
+        scaleSpace(inputProc.getOutputTexId(), input.cols, input.rows);
+        glFinish();
+    });
+    
+    const auto &layout = scaleSpace.getLayout();
+    ASSERT_EQ(layout.size(), scales.size());
+    double levelArea = 0.0;
+    for(const auto &roi : layout.levels)
+    {
+        levelArea += roi.area();
+    }
+    EXPECT_GT(levelArea / double(layout.textureSize.area()), 0.75);
     
+    gatherer::graphics::PyramidReader reader(layout);
+    reader(scaleSpace.getOutputTexId());
+    
+    // Level 0 is a copy, smaller levels are close to an area average:
+    EXPECT_EQ(cv::countNonZero(reader.getLevel(0).reshape(1) != input.reshape(1)), 0);
+    for(size_t i = 1; i < layout.size(); i++)
+    {
+        cv::Mat level;
+        cv::resize(input, level, layout.levels[i].size(), 0, 0, cv::INTER_AREA);
+        cv::Mat diff;
+        cv::absdiff(level, reader.getLevel(i), diff);
+        EXPECT_LT(cv::mean(diff.reshape(1))[0], 8.0);
+    }
+    
+    // Same scales with one pass per level:
+    ogles_gpgpu::PyramidProc pyrProc;
+    std::vector<ogles_gpgpu::Size2d> sizes;
+    for(const auto &roi : layout.levels)
+    {
+        sizes.emplace_back(roi.width, roi.height);
+    }
+    pyrProc.setScales(sizes);
+    inputProc.add(&pyrProc);
+    double pyramidTime = benchmark([&]()
+    {
+        video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+        glFinish();
+    });
+    
+    m_logger->info() << scales.size() << " scales (ms): one draw " << atlasTime << " PyramidProc (with upload) " << pyramidTime;
+}
+
+TEST_F(QOGLESGPGPUTest, history)
+{
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc inputProc;
+    inputProc.setGrayscaleConvType(ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_NONE);
+    video.set(&inputProc);
+    
+    gatherer::graphics::FrameHistory history(3);
+    gatherer::graphics::TemporalFilter median(gatherer::graphics::TemporalFilter::kMedian, 3);
+    gatherer::graphics::TemporalFilter difference(gatherer::graphics::TemporalFilter::kDifference, 2);
+    
+    // Three distinct frames: the image, shifted and inverted
+    std::vector<cv::Mat> frames(3), inputs;
+    frames[0] = image;
+    cv::warpAffine(image, frames[1], (cv::Mat_<double>(2, 3) << 1, 0, 3, 0, 1, 2), image.size(), cv::INTER_NEAREST, cv::BORDER_REPLICATE);
+    cv::bitwise_not(image, frames[2]);
+    for(auto &frame : frames)
+    {
+        video({frame.cols, frame.rows}, frame.ptr(), true, 0, GL_BGRA);
+        inputs.push_back(getImage(inputProc));
+        history.push(inputProc.getOutputTexId(), frame.cols, frame.rows);
+    }
+    ASSERT_EQ(history.getCount(), 3);
+    
+    median(history);
+    difference(history);
+    
+    cv::Mat expectedMedian = cv::max(cv::min(inputs[0], inputs[1]), cv::min(cv::max(inputs[0], inputs[1]), inputs[2]));
+    cv::Mat expectedDifference;
+    cv::absdiff(inputs[2], inputs[1], expectedDifference);
+    
+    gatherer::graphics::PyramidReader reader(gatherer::graphics::PyramidLayout::octaves(image.size(), 1));
+    reader(median.getOutputTexId());
+    EXPECT_EQ(cv::countNonZero(reader.getLevel(0).reshape(1) != expectedMedian.reshape(1)), 0);
+    reader(difference.getOutputTexId());
+    cv::Mat error;
+    cv::absdiff(reader.getLevel(0), expectedDifference, error);
+    EXPECT_EQ(cv::countNonZero(error.reshape(1) > 1), 0); // mediump
+    
+    // history[k] is the frame pushed k frames ago, without copies of past frames:
+    for(int k = 0; k < 3; k++)
+    {
+        reader(history.getTexture(k));
+        EXPECT_EQ(cv::countNonZero(reader.getLevel(0).reshape(1) != inputs[2 - k].reshape(1)), 0);
+    }
+}
+
+TEST_F(QOGLESGPGPUTest, lk_tracker)
+{
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc grayscaleProc;
+    ogles_gpgpu::PyramidProc pyrProc;
+    video.set(&grayscaleProc);
+    grayscaleProc.add(&pyrProc);
+    
+    // Second frame: the image moved by a known sub-pixel shift
+    const cv::Point2f shift(2.5f, -1.25f);
+    cv::Mat moved;
+    cv::warpAffine(image, moved, (cv::Mat_<double>(2, 3) << 1, 0, shift.x, 0, 1, shift.y), image.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    
+    gatherer::graphics::FrameHistory pyramids(2);
+    for(const cv::Mat &frame : { image, moved })
+    {
+        video({frame.cols, frame.rows}, frame.ptr(), true, 0, GL_BGRA);
+        pyramids.push(pyrProc.getOutputTexId(), pyrProc.getOutFrameW(), pyrProc.getOutFrameH());
+    }
+    
+    cv::Mat gray;
+    std::vector<cv::Point2f> points;
+    cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+    cv::goodFeaturesToTrack(gray, points, 300, 0.01, 8.0);
+    ASSERT_GT(points.size(), 0u);
+    
+    auto layout = gatherer::graphics::PyramidLayout::octaves(image.size(), 4);
+    layout.textureSize = cv::Size(pyrProc.getOutFrameW(), pyrProc.getOutFrameH());
+    gatherer::graphics::LucasKanadeTracker tracker(layout);
+    double trackTime = benchmark([&]()
+    {
+        tracker(pyramids.getTexture(1), pyramids.getTexture(0), points);
+    });
+    
+    const auto &tracked = tracker.getKeypoints();
+    const auto &status = tracker.getStatus();
+    ASSERT_EQ(tracked.size(), points.size());
+    
+    std::vector<float> errors;
+    for(size_t i = 0; i < points.size(); i++)
+    {
+        if(status[i])
+        {
+            errors.push_back(cv::norm(cv::Point2f(tracked.x[i], tracked.y[i]) - (points[i] + shift)));
+        }
+    }
+    ASSERT_GT(errors.size(), points.size() * 9 / 10);
+    std::nth_element(errors.begin(), errors.begin() + errors.size() / 2, errors.end());
+    EXPECT_LT(errors[errors.size() / 2], 0.1f);
+    EXPECT_EQ(tracker.getReadbackSize() / points.size(), 4u);
+    
+    m_logger->info() << points.size() << " points tracked (ms): " << trackTime << " (" << tracker.getReadbackSize() << " bytes)";
+}
+
+TEST_F(QOGLESGPGPUTest, batch_warp)
+{
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc inputProc;
+    inputProc.setGrayscaleConvType(ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_NONE);
+    video.set(&inputProc);
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    const cv::Mat input = getImage(inputProc);
+    
+    // Rotated and scaled patches on a grid, as for faces warped to a canonical pose:
+    using Patch = gatherer::graphics::BatchWarpShader::Patch;
+    std::vector<Patch> patches;
+    const cv::Size patchSize(48, 48);
+    const int step = std::min(input.cols, input.rows) / 6;
+    for(int y = step; y + 2 * step < input.rows; y += step)
+    {
+        for(int x = step; x + 2 * step < input.cols; x += step)
+        {
+            const cv::Rect roi(x, y, step, step);
+            const cv::Point2f center(step * 0.5f, step * 0.5f);
+            const float angle = float(patches.size() * 10 % 360);
+            const float scale = float(patchSize.width) / float(step);
+            cv::Mat A = cv::getRotationMatrix2D(center, angle, scale);
+            A.at<double>(0, 2) += patchSize.width * 0.5 - center.x;
+            A.at<double>(1, 2) += patchSize.height * 0.5 - center.y;
+            patches.emplace_back(roi, cv::Matx23f(A), patchSize);
+        }
+    }
+    
+    gatherer::graphics::BatchWarpShader warper;
+    const std::vector<cv::Mat> *crops = nullptr;
+    double batchTime = benchmark([&]()
+    {
+        warper(inputProc.getOutputTexId(), input.size(), patches);
+        crops = &warper.read();
+    });
+    ASSERT_EQ(crops->size(), patches.size());
+    
+    // cv::warpPerspective of the whole image with the ROI origin folded into H:
+    for(size_t i = 0; i < patches.size(); i++)
+    {
+        const auto &roi = patches[i].roi;
+        const cv::Matx33f T(1, 0, -roi.x, 0, 1, -roi.y, 0, 0, 1);
+        cv::Mat expected, diff;
+        cv::warpPerspective(input, expected, patches[i].H * T, patchSize, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+        cv::absdiff(expected, (*crops)[i], diff);
+        EXPECT_LT(cv::mean(diff.reshape(1))[0], 1.0);
+    }
+    
+    m_logger->info() << patches.size() << " patches (ms): one draw and readback " << batchTime << " atlas " << warper.getLayout().textureSize.width << "x" << warper.getLayout().textureSize.height;
+    
+    // A smaller batch packs into the texture allocated for the larger one:
+    const cv::Size capacity = warper.getLayout().textureSize;
+    patches.resize(patches.size() / 2);
+    warper(inputProc.getOutputTexId(), input.size(), patches);
+    EXPECT_EQ(warper.getLayout().textureSize, capacity);
+    EXPECT_EQ(warper.read().size(), patches.size());
+}
+
+TEST_F(QOGLESGPGPUTest, reductions)
+{
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc inputProc;
+    inputProc.setGrayscaleConvType(ogles_gpgpu::GRAYSCALE_INPUT_CONVERSION_NONE);
+    video.set(&inputProc);
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    const cv::Mat input = getImage(inputProc);
+    gatherer::graphics::GLStateCache::get().invalidate(); // ogles_gpgpu binds outside the cache
+    
+    std::vector<cv::Mat> channels;
+    cv::split(input, channels);
+    std::vector<int> expected(256, 0);
+    for(int y = 0; y < input.rows; y++)
+    {
+        for(int x = 0; x < input.cols; x++)
+        {
+            expected[channels[1].at<uint8_t>(y, x)]++;
+        }
+    }
+    std::vector<uint32_t> values(100000);
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        values[i] = uint32_t(i % 7);
+    }
+    
+    using Reductions = gatherer::graphics::GLReductions;
+    std::vector<Reductions::Backend> backends { Reductions::kReadback };
+    if(gatherer::graphics::GLCapabilities::get().computeShaders)
+    {
+        backends.push_back(Reductions::kCompute);
+    }
+    for(auto backend : backends)
+    {
+        Reductions reductions(backend);
+        Reductions::Statistics stats;
+        std::vector<int> hist;
+        double reductionTime = benchmark([&]()
+        {
+            stats = reductions.statistics(inputProc.getOutputTexId(), input.size());
+            reductions.histogram(inputProc.getOutputTexId(), input.size(), 1, hist);
+        });
+        
+        for(int c = 0; c < 4; c++)
+        {
+            double lo = 0.0, hi = 0.0;
+            cv::minMaxLoc(channels[c], &lo, &hi);
+            EXPECT_EQ(stats.sum[c], cv::sum(channels[c])[0]);
+            EXPECT_EQ(stats.min[c], lo);
+            EXPECT_EQ(stats.max[c], hi);
+        }
+        EXPECT_EQ(hist, expected);
+        
+        std::vector<uint32_t> scan = values;
+        const uint32_t total = reductions.exclusiveScan(scan);
+        uint32_t sum = 0;
+        for(size_t i = 0; i < values.size(); sum += values[i++])
+        {
+            ASSERT_EQ(scan[i], sum);
+        }
+        EXPECT_EQ(total, sum);
+        
+        m_logger->info() << (backend == Reductions::kCompute ? "compute" : "readback") << " statistics and histogram (ms): " << reductionTime;
+    }
+}
+
+TEST_F(QOGLESGPGPUTest, nv12_luma)
+{
+    // NV12 frame: full resolution Y plane, then interleaved half resolution UV
+    cv::Mat gray;
+    cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+    cv::Mat nv12(image.rows + image.rows / 2, image.cols, CV_8UC1, cv::Scalar::all(128));
+    gray.copyTo(nv12.rowRange(0, image.rows));
+    
+    createPipelien(1);
+    ASSERT_TRUE(m_pipeline->usesLuminanceInput());
+    double lumaTime = benchmark([&]()
+    {
+        m_pipeline->captureOutput(image.size(), nv12.ptr(), true, 0, 0);
+        glFinish();
+    });
+    
+    // The Y plane passes through the grayscale stage unchanged
+    cv::Mat result(m_pipeline->getOutputSize(), CV_8UC4), channels[4];
+    m_pipeline->getOutputData(result.ptr());
+    cv::split(result, channels);
+    ASSERT_EQ(channels[0].size(), gray.size());
+    EXPECT_EQ(cv::countNonZero(channels[0] != gray), 0);
+    
+    // Camera buffers pad the rows of the Y plane
+    const int stride = image.cols + 64;
+    cv::Mat padded(nv12.rows, stride, CV_8UC1, cv::Scalar::all(255));
+    nv12.copyTo(padded.colRange(0, image.cols));
+    m_pipeline->setLuminanceStride(padded.step1());
+    m_pipeline->captureOutput(image.size(), padded.ptr(), true, 0, 0);
+    m_pipeline->getOutputData(result.ptr());
+    cv::split(result, channels);
+    EXPECT_EQ(cv::countNonZero(channels[0] != gray), 0);
+    m_pipeline->setLuminanceStride(0);
+    
+    // Switching to the YUV to RGB path after the first frame (gray chroma, video range at most)
+    m_pipeline->setLuminanceFastPath(false);
+    ASSERT_FALSE(m_pipeline->usesLuminanceInput());
+    m_pipeline->captureOutput(image.size(), nv12.ptr(), true, 0, 0);
+    m_pipeline->getOutputData(result.ptr());
+    cv::split(result, channels);
+    EXPECT_LE(cv::norm(channels[0], gray, cv::NORM_L1) / gray.total(), 24.0);
+    
+    m_logger->info() << "NV12 luminance only frame (ms): " << lumaTime;
+}
+
+TEST_F(QOGLESGPGPUTest, fence)
+{
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc grayProc;
+    video.set(&grayProc);
+    
+    gatherer::graphics::GLFence fence;
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    fence.signal({ grayProc.getOutputTexId() });
+    EXPECT_TRUE(fence.clientWait());
+    EXPECT_TRUE(fence.isSignaled());
+    
+    // Frames waited on with a full pipeline drain and with a fence:
+    double finishTime = benchmark([&]()
+    {
+        video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+        glFinish();
+    });
+    double fenceTime = benchmark([&]()
+    {
+        video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+        fence.signal();
+        fence.clientWait();
+    });
+    m_logger->info() << "frame (ms): glFinish " << finishTime << " fence " << fenceTime;
+    
+    // A texture written in another thread must be fenced and waited on before it is read:
+    auto &validator = gatherer::graphics::GLFenceValidator::get();
+    const GLuint texture = grayProc.getOutputTexId();
+    std::thread([&]() { validator.written(texture); }).join();
+    EXPECT_THROW(validator.read(texture), std::logic_error);
+    
+    const uint64_t serial = 1000;
+    std::thread([&]()
+    {
+        validator.written(texture);
+        validator.signaled(texture, serial);
+    }).join();
+    EXPECT_THROW(validator.read(texture), std::logic_error);
+    validator.waited(serial);
+    EXPECT_NO_THROW(validator.read(texture));
+    validator.reset();
+}
+
+TEST_F(QOGLESGPGPUTest, texture_streaming)
+{
+    // Padded BGR frame, uploaded through an ROI without repacking
+    cv::Mat bgr, padded;
+    cv::cvtColor(image, bgr, cv::COLOR_BGRA2BGR);
+    cv::copyMakeBorder(bgr, padded, 0, 0, 3, 5, cv::BORDER_CONSTANT);
+    const cv::Mat roi = padded(cv::Rect(3, 0, bgr.cols, bgr.rows));
+    ASSERT_FALSE(roi.isContinuous());
+    
+    gatherer::graphics::GLTexture texture(roi.size(), CV_8UC3, 3);
+    ASSERT_TRUE(texture.isStreaming());
+    double streamingTime = benchmark([&]() { texture.load(roi); });
+    
+    gatherer::graphics::GLTexture reference;
+    double loadTime = benchmark([&]() { reference.load(roi.clone()); });
+    
+    // The texture storage is RGB
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    cv::Mat result(roi.size(), CV_8UC4), rgba;
+    glReadPixels(0, 0, result.cols, result.rows, GL_RGBA, GL_UNSIGNED_BYTE, result.ptr());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    
+    cv::cvtColor(roi, rgba, cv::COLOR_BGR2RGBA);
+    EXPECT_EQ(cv::norm(result, rgba, cv::NORM_INF), 0.0);
+    
+    m_logger->info() << "upload (ms): streaming " << streamingTime << " glTexImage2D " << loadTime;
+}
+
+TEST_F(QOGLESGPGPUTest, output_view)
+{
+    cv::Mat expected;
+    processFrame(image, expected);
+    
+    {
+        auto view = m_pipeline->lockOutput();
+        ASSERT_EQ(view.getImage().size(), expected.size());
+        EXPECT_EQ(cv::norm(view.getImage(), expected, cv::NORM_INF), 0.0);
+        m_logger->info() << "output view without copy: " << view.isZeroCopy();
+    }
+    
+    // Handlers read the locked output of each frame
+    cv::Mat handled;
+    gatherer::graphics::OEGLGPGPUTest::FrameHandler handler = [&](const cv::Mat &frame)
+    {
+        handled = frame.clone();
+    };
+    m_pipeline->setFrameHandler(handler);
+    m_pipeline->captureOutput(image.size(), image.ptr(), true, 0, GL_BGRA);
+    EXPECT_EQ(cv::norm(handled, expected, cv::NORM_INF), 0.0);
+    
+    cv::Mat copy(expected.size(), CV_8UC4);
+    double copyTime = benchmark([&]() { m_pipeline->getOutputData(copy.ptr()); });
+    double viewTime = benchmark([&]() { auto view = m_pipeline->lockOutput(); });
+    m_logger->info() << "output (ms): getOutputData " << copyTime << " lockOutput " << viewTime;
+}
+
+TEST_F(QOGLESGPGPUTest, packed_readback)
+{
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc grayscaleProc;
+    ogles_gpgpu::GradProc gradProc;
+    
+    video.set(&grayscaleProc);
+    grayscaleProc.add(&gradProc);
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    
+    const cv::Mat result = getImage(gradProc);
+    gatherer::graphics::GLStateCache::get().invalidate(); // ogles_gpgpu binds outside the cache
+    std::vector<cv::Mat> channels;
+    cv::split(result, channels);
+    
+    using gatherer::graphics::PackedReader;
+    PackedReader reader;
+    const GLuint texture = gradProc.getOutputTexId();
+    
+    // One channel: a quarter of the transfer
+    cv::Mat mag;
+    double u8Time = benchmark([&]() { mag = reader(texture, result.size(), { 0 }).clone(); });
+    ASSERT_EQ(mag.type(), CV_8UC1);
+    EXPECT_EQ(cv::norm(mag, channels[0], cv::NORM_INF), 0.0);
+    EXPECT_EQ(reader.getReadbackSize(), size_t((result.cols + 3) / 4 * 4 * result.rows));
+    
+    // Swapped channels of an ROI
+    const cv::Rect roi(result.cols / 4, result.rows / 4, result.cols / 2 + 1, result.rows / 2);
+    cv::Mat dydx, expected;
+    cv::merge(std::vector<cv::Mat> { channels[3](roi), channels[2](roi) }, expected);
+    dydx = reader(texture, result.size(), { 3, 2 }, PackedReader::kU8, roi);
+    EXPECT_EQ(cv::norm(dydx, expected, cv::NORM_INF), 0.0);
+    
+    // 16 bit and float values of 8 bit texels
+    cv::Mat dx16, dxf;
+    channels[2].convertTo(expected, CV_16U, 257.0);
+    dx16 = reader(texture, result.size(), { 2 }, PackedReader::kU16);
+    EXPECT_EQ(cv::norm(dx16, expected, cv::NORM_INF), 0.0);
+    
+    double floatTime = benchmark([&]() { dxf = reader(texture, result.size(), { 2 }, PackedReader::kFloat).clone(); });
+    channels[2].convertTo(expected, CV_32F, 1.0 / 255.0);
+    EXPECT_LE(cv::norm(dxf, expected, cv::NORM_INF), 1e-6);
+    
+    double rgbaTime = benchmark([&]() { getImage(gradProc); });
+    m_logger->info() << "readback (ms): RGBA " << rgbaTime << " one channel " << u8Time << " float " << floatTime;
+}
+
+TEST_F(QOGLESGPGPUTest, packed_luma)
+{
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc grayProc;
+    video.set(&grayProc);
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    
+    cv::Mat gray;
+    cv::extractChannel(getImage(grayProc), gray, 0);
+    gatherer::graphics::GLStateCache::get().invalidate(); // ogles_gpgpu binds outside the cache
+    
+    // The input texture is RGBA (uploaded from BGRA), as for GrayscaleProc
+    using namespace gatherer::graphics;
+    PackedLumaProc proc;
+    PackedLumaTexture packed, smooth, dx, dy, binary;
+    double packTime = benchmark([&]() { proc.pack(video.getInputTexId(), image.size(), packed); });
+    ASSERT_EQ(packed.getPackedSize().width, (image.cols + 3) / 4);
+    EXPECT_LE(cv::norm(packed.read(), gray, cv::NORM_INF), 1.0);
+    
+    // Continue from the packed gray image, so only the stages are compared
+    gray = packed.read().clone();
+    
+    double gaussTime = benchmark([&]() { proc.gaussian(packed, smooth, 1.5f); });
+    cv::Mat expected;
+    cv::GaussianBlur(gray, expected, cv::Size(11, 11), 1.5, 1.5, cv::BORDER_REPLICATE);
+    EXPECT_LE(cv::norm(smooth.read(), expected, cv::NORM_INF), 2.0);
+    
+    proc.gradient(packed, dx, dy);
+    cv::Mat gx, gy;
+    cv::Sobel(gray, gx, CV_32F, 1, 0, 1, 0.5, 0.0, cv::BORDER_REPLICATE);
+    cv::Sobel(gray, gy, CV_32F, 0, 1, 1, 0.5, 0.0, cv::BORDER_REPLICATE);
+    gx.convertTo(expected, CV_8U, 1.0, 127.5);
+    EXPECT_LE(cv::norm(dx.read(), expected, cv::NORM_INF), 1.0);
+    gy.convertTo(expected, CV_8U, 1.0, 127.5);
+    EXPECT_LE(cv::norm(dy.read(), expected, cv::NORM_INF), 1.0);
+    
+    proc.threshold(packed, binary, 0.5f);
+    EXPECT_EQ(cv::countNonZero(binary.read() != (gray >= 128)), 0);
+    
+    m_logger->info() << "packed luma (ms): pack " << packTime << " gaussian " << gaussTime;
+}
+
+TEST_F(QOGLESGPGPUTest, texture_formats)
+{
+    using gatherer::graphics::GLTextureFormat;
+    
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc inputProc;
+    video.set(&inputProc);
+    
+    const auto &caps = gatherer::graphics::GLCapabilities::get();
+    m_logger->info() << "renderable: r8 " << caps.renderR8 << " rg8 " << caps.renderRG8 << " rgba16f " << caps.renderRGBA16F << " r32f " << caps.renderR32F;
+    EXPECT_EQ(GLTextureFormat::parse("rgba16f"), GLTextureFormat::kRGBA16F);
+    EXPECT_EQ(GLTextureFormat::resolve(GLTextureFormat::kRGBA8), GLTextureFormat::kRGBA8);
+    
+    // Gray frames in a one byte per pixel history, averaged in half float
+    gatherer::graphics::FrameHistory history(3, GLTextureFormat::kR8);
+    gatherer::graphics::TemporalFilter mean(gatherer::graphics::TemporalFilter::kMean, 3);
+    mean.setFormat(GLTextureFormat::kRGBA16F);
+    
+    std::vector<cv::Mat> grays;
+    for(int k = 0; k < 3; k++)
+    {
+        cv::Mat frame = image + cv::Scalar::all(k * 40);
+        video({frame.cols, frame.rows}, frame.ptr(), true, 0, GL_BGRA);
+        grays.push_back(getImage(inputProc));
+        history.push(inputProc.getOutputTexId(), frame.cols, frame.rows);
+    }
+    mean(history);
+    
+    cv::Mat gray, expectedMean(image.size(), CV_32FC1, cv::Scalar(0));
+    cv::extractChannel(grays.back(), gray, 0);
+    for(const auto &g : grays)
+    {
+        cv::Mat channel;
+        cv::extractChannel(g, channel, 0);
+        channel.convertTo(channel, CV_32F, 1.0 / (255.0 * 3.0));
+        expectedMean += channel;
+    }
+    
+    gatherer::graphics::PackedReader reader;
+    EXPECT_EQ(cv::countNonZero(reader(history.getTexture(0), image.size(), { 0 }) != gray), 0);
+    
+    // An RGBA8 mean would be off by up to half a step of 1/255
+    const cv::Mat &result = reader(mean.getOutputTexId(), image.size(), { 0 }, gatherer::graphics::PackedReader::kFloat);
+    const double tolerance = (mean.getFormat() == GLTextureFormat::kRGBA16F) ? 1.0 / 1024.0 : 1.0 / 255.0;
+    EXPECT_LE(cv::norm(result, expectedMean, cv::NORM_INF), tolerance);
+    
+    // Format aware readback: one channel, no RGBA expansion
+    gatherer::graphics::RenderTextureCopy copy(image.cols, image.rows, GLTextureFormat::kR8);
+    copy.SetTextureUnit(0, history.getTexture(0));
+    copy.render();
+    cv::Mat copied;
+    copy.read(copied);
+    ASSERT_EQ(copied.type(), GLTextureFormat::getType(copy.getFormat()));
+    if(caps.renderR8)
+    {
+        ASSERT_EQ(copy.getFormat(), GLTextureFormat::kR8);
+        ASSERT_EQ(copied.channels(), 1);
+    }
+    else
+    {
+        m_logger->info() << "R8 is not renderable, checking the RGBA8 fallback";
+        ASSERT_EQ(copy.getFormat(), GLTextureFormat::kRGBA8);
+        ASSERT_EQ(copied.channels(), 4);
+        cv::extractChannel(copied, copied, 0);
+    }
+    EXPECT_EQ(cv::countNonZero(copied != gray), 0);
+    
+    m_logger->info() << "history bytes per frame: " << image.total() * CV_ELEM_SIZE(GLTextureFormat::getType(history.getFormat()));
+}
+
+TEST_F(QOGLESGPGPUTest, gradient_planes)
+{
+    using gatherer::graphics::GradientPlanes;
+    
+    ogles_gpgpu::VideoSource video;
+    ogles_gpgpu::GrayscaleProc grayscaleProc;
+    video.set(&grayscaleProc);
+    video({image.cols, image.rows}, image.ptr(), true, 0, GL_BGRA);
+    
+    cv::Mat gray;
+    cv::extractChannel(getImage(grayscaleProc), gray, 0);
+    gatherer::graphics::GLStateCache::get().invalidate(); // ogles_gpgpu binds outside the cache
+    
+    // Ground truth with intensities in [0,1] (GL_CLAMP_TO_EDGE is BORDER_REPLICATE)
+    cv::Mat dx, dy, magnitude, theta;
+    cv::Sobel(gray, dx, CV_32F, 1, 0, 3, 1.0 / 255.0, 0, cv::BORDER_REPLICATE);
+    cv::Sobel(gray, dy, CV_32F, 0, 1, 3, 1.0 / 255.0, 0, cv::BORDER_REPLICATE);
+    cv::magnitude(dx, dy, magnitude);
+    
+    GradientPlanes grad;
+    double mrtTime = benchmark([&]() { grad(grayscaleProc.getOutputTexId(), image.size()); glFinish(); });
+    m_logger->info() << "gradient planes: " << grad.getPasses() << " pass(es), " << mrtTime << " ms";
+    
+    // Without R32F the planes fall back to RGBA8 with the GradProc encoding, decoded here
+    const bool floats = gatherer::graphics::GLCapabilities::get().renderR32F;
+    if(!floats)
+    {
+        m_logger->info() << "R32F is not renderable, checking the 8 bit planes";
+    }
+    auto readPlane = [&](GradientPlanes::Plane plane)
+    {
+        cv::Mat result;
+        grad.read(plane, result);
+        if(floats)
+        {
+            EXPECT_EQ(grad.getFormat(plane), gatherer::graphics::GLTextureFormat::kR32F);
+            EXPECT_EQ(result.type(), CV_32FC1);
+            return result;
+        }
+        EXPECT_EQ(grad.getFormat(plane), gatherer::graphics::GLTextureFormat::kRGBA8);
+        EXPECT_EQ(result.type(), CV_8UC4);
+        cv::extractChannel(result, result, 0);
+        switch(plane)
+        {
+            case GradientPlanes::kDx:
+            case GradientPlanes::kDy: result.convertTo(result, CV_32F, 2.0 / 255.0, -1.0); break;
+            case GradientPlanes::kMagnitude: result.convertTo(result, CV_32F, 1.0 / 255.0); break;
+            default: result.convertTo(result, CV_32F, 2.0 * CV_PI / 255.0, -CV_PI); break;
+        }
+        return result;
+    };
+    
+    // 8 bit: one quantization step (2/255 for dx, dy), with dx, dy in [-1,1] and the magnitude in [0,1]
+    const double tolerance = floats ? 1e-4 : 2.0 / 255.0;
+    std::vector<cv::Mat> expected { dx, dy, magnitude };
+    if(!floats)
+    {
+        for(auto &e : expected)
+        {
+            e = cv::max(cv::min(e, 1.0), -1.0);
+        }
+    }
+    for(int plane = 0; plane < 3; plane++)
+    {
+        const cv::Mat result = readPlane(GradientPlanes::Plane(plane));
+        EXPECT_LE(cv::norm(result, expected[plane], cv::NORM_INF), tolerance);
+        if(plane != GradientPlanes::kMagnitude)
+        {
+            const cv::Mat wrongSign = (result > 0) != (expected[plane] > 0);
+            EXPECT_EQ(cv::countNonZero(wrongSign & (cv::abs(expected[plane]) > tolerance)), 0);
+        }
+    }
+    
+    // Orientation against the CPU gradient where it is defined
+    cv::phase(dx, dy, theta);
+    cv::Mat error = cv::abs(readPlane(GradientPlanes::kOrientation) - theta); // phase() is in [0, 2pi), atan2 in [-pi, pi]
+    error = cv::min(error, cv::abs(error - cv::Scalar::all(2.0 * CV_PI)));
+    EXPECT_EQ(cv::countNonZero((error > (floats ? 1e-3 : 2.0 * CV_PI / 255.0)) & (magnitude > 1e-2)), 0);
+    
+    // One pass per plane, as without multiple render targets
+    grad.setMultipleRenderTargets(false);
+    double passTime = benchmark([&]() { grad(grayscaleProc.getOutputTexId(), image.size()); glFinish(); });
+    EXPECT_EQ(grad.getPasses(), int(GradientPlanes::kPlanes));
+    EXPECT_LE(cv::norm(readPlane(GradientPlanes::kMagnitude), expected[GradientPlanes::kMagnitude], cv::NORM_INF), tolerance);
+    m_logger->info() << "gradient planes: " << grad.getPasses() << " passes, " << passTime << " ms";
+}
+
+
+TEST_F(QOGLESGPGPUTest, context_recreation)
+{
+    // Quad draws in two contexts back to back, as in consecutive fixtures:
+    // the second one must not bind the quad buffer name of the first
+    cv::Mat gray, bgr;
+    cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+    cv::Mat channels[3] = { gray, gray, gray };
+    cv::merge(channels, 3, bgr);
+    
+    for(int k = 0; k < 2; k++)
+    {
+        if(k > 0)
+        {
+            recreateContext();
+        }
+        
+        gatherer::graphics::GLTexture texture(bgr);
+        gatherer::graphics::RenderTextureCopy copy(image.cols, image.rows);
+        copy.SetTextureUnit(0, texture);
+        copy.render();
+        
+        cv::Mat copied;
+        copy.read(copied);
+        ASSERT_EQ(copied.channels(), 4);
+        cv::extractChannel(copied, copied, 0);
+        EXPECT_EQ(cv::countNonZero(copied != gray), 0) << "context " << k;
+    }
+}
+
+END_EMPTY_NAMESPACE